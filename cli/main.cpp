@@ -0,0 +1,400 @@
+/***************************************************************************
+
+Copyright (C) 2016  stefan.berke @ modular-audio-graphics.com
+
+This source is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either
+version 3.0 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this software; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+****************************************************************************/
+
+#include <iostream>
+#include <algorithm>
+
+#include <QGuiApplication>
+#include <QCommandLineParser>
+#include <QEventLoop>
+#include <QFile>
+#include <QDir>
+#include <QTextStream>
+#include <QImage>
+#include <QElapsedTimer>
+
+#include "core/ShadertoyApi.h"
+#include "core/ShadertoyShader.h"
+#include "core/ShaderQuery.h"
+#include "core/ShadertoyOffscreenRenderer.h"
+#include "core/ShaderValidator.h"
+#include "core/RenderProcessPool.h"
+#include "core/log.h"
+
+/*  Headless front-end to the core library.
+    Creates no widgets, so it runs with QT_QPA_PLATFORM=offscreen
+    or under Xvfb with a software OpenGL. */
+
+namespace {
+
+    struct Options
+    {
+        QString command, query, output;
+        QStringList ids;
+        bool all, verbose, force;
+        QSize size;
+        int frames;
+        double fps, start;
+    };
+
+    /** Prints collected warnings and errors to stderr.
+        Debug builds print all messages already. */
+    void flushLog(bool verbose)
+    {
+        QString s;
+        Log::Level l;
+        while (Log::pullMessage(&s, &l))
+        {
+#ifdef NDEBUG
+            if (verbose || l == Log::L_WARN || l == Log::L_ERROR)
+                std::cerr << s.toStdString();
+#else
+            Q_UNUSED(verbose);
+#endif
+        }
+    }
+
+    /** Reads the info of all shaders, lazily, without the passes */
+    bool loadAll(ShadertoyApi* api)
+    {
+        api->setLazyLoading(true);
+        if (!api->loadShaderList())
+        {
+            std::cerr << "no shaders in '"
+                      << QDir::currentPath().toStdString() << "'\n";
+            return false;
+        }
+        QEventLoop loop;
+        QObject::connect(api, &ShadertoyApi::loadFinished,
+                         &loop, &QEventLoop::quit);
+        api->loadAllShaders();
+        if (api->isLoading())
+            loop.exec();
+        return true;
+    }
+
+    /** Collects the ids given by --all, --query and the arguments */
+    bool selectShaders(ShadertoyApi* api, const Options& o, QStringList& ids)
+    {
+        ids = o.ids;
+        if (!o.all && o.query.isNull())
+        {
+            // opens the catalog for loadShaderBody()
+            api->loadShaderList();
+            return true;
+        }
+
+        if (!loadAll(api))
+            return false;
+
+        const ShaderQuery query(o.query);
+        for (const QString& id : api->shaderIds())
+        {
+            if (query.isEmpty())
+            {
+                ids << id;
+                continue;
+            }
+            const ShadertoyShader info = api->getShader(id, false);
+            switch (query.matchInfo(info.info()))
+            {
+                case ShaderQuery::M_YES: ids << id; break;
+                case ShaderQuery::M_NO: break;
+                case ShaderQuery::M_NEEDS_SOURCE:
+                    if (query.matches(api->loadShaderBody(id)))
+                        ids << id;
+                break;
+            }
+        }
+        ids.removeDuplicates();
+        return true;
+    }
+
+    int listShaders(ShadertoyApi* api, const Options& o)
+    {
+        Options lo = o;
+        if (lo.query.isNull() && lo.ids.isEmpty())
+            lo.all = true;
+
+        QStringList ids;
+        if (!selectShaders(api, lo, ids))
+            return 1;
+
+        QTextStream out(stdout);
+        for (const QString& id : ids)
+        {
+            const ShadertoyShader shader = api->getShader(id, false);
+            out << id << "\t" << shader.info().name
+                << "\t" << shader.info().username << "\n";
+        }
+        return 0;
+    }
+
+    QString frameFilename(const Options& o, const QString& id, int frame)
+    {
+        QString fn = ShadertoyApi::shaderIdToFilename(id);
+        if (o.frames > 1)
+            fn += QString("_%1").arg(frame, 5, 10, QChar('0'));
+        return QDir(o.output).filePath(fn + ".png");
+    }
+
+    int renderShaders(ShadertoyApi* api, const Options& o)
+    {
+        QStringList ids;
+        if (!selectShaders(api, o, ids))
+            return 1;
+        if (ids.isEmpty())
+        {
+            std::cerr << "no shaders selected\n";
+            return 2;
+        }
+        if (!QDir(".").mkpath(o.output))
+        {
+            std::cerr << "can't create '" << o.output.toStdString() << "'\n";
+            return 1;
+        }
+
+        QTextStream out(stdout);
+        ShadertoyOffscreenRenderer renderer;
+        int numFailed = 0;
+        QElapsedTimer timer;
+        timer.start();
+
+        for (const QString& id : ids)
+        {
+            const ShadertoyShader shader = api->loadShaderBody(id);
+            bool ok = false;
+            QString error;
+            if (!shader.isValid())
+                error = "shader not found";
+            else
+            {
+                renderer.setShader(shader);
+                ok = true;
+                for (int f = 0; f < o.frames && ok; ++f)
+                {
+                    renderer.setGlobalTime(float(o.start + f / o.fps));
+                    renderer.setFrameNumber(f);
+                    const QImage img = renderer.renderToImage(o.size);
+                    const QString fn = frameFilename(o, id, f);
+                    if (img.isNull())
+                    {
+                        ok = false;
+                        error = renderer.errorString();
+                    }
+                    else if (!img.save(fn))
+                    {
+                        ok = false;
+                        error = "can't write " + fn;
+                    }
+                }
+            }
+
+            if (!ok)
+            {
+                ++numFailed;
+                out << id << "\tFAILED\t" << error.simplified() << "\n";
+            }
+            else if (o.verbose)
+                out << id << "\tok\n";
+            out.flush();
+            flushLog(o.verbose);
+        }
+
+        std::cerr << (ids.size() - numFailed) << " of " << ids.size()
+                  << " shaders rendered in "
+                  << (timer.elapsed() / 1000.) << " sec\n";
+        return numFailed ? 1 : 0;
+    }
+
+    /** Compiles the shaders in parallel and updates shader.validation */
+    int validateShaders(ShadertoyApi* api, const Options& o)
+    {
+        QStringList ids;
+        if (!selectShaders(api, o, ids))
+            return 1;
+        if (ids.isEmpty())
+        {
+            std::cerr << "no shaders selected\n";
+            return 2;
+        }
+
+        ShaderValidator validator;
+        validator.setForce(o.force);
+        // finished() may be sent from within validate()
+        bool done = false;
+        QEventLoop loop;
+        QObject::connect(&validator, &ShaderValidator::finished,
+                         [&](){ done = true; loop.quit(); });
+        validator.validate(ids);
+        if (!done)
+            loop.exec();
+        flushLog(o.verbose);
+
+        // skipped shaders report their stored result
+        QTextStream out(stdout);
+        const ShaderValidationResults& results = api->validationResults();
+        int numOk = 0;
+        for (const QString& id : ids)
+        {
+            auto e = results.find(id);
+            if (e && e->status == ShaderValidationResults::S_OK)
+            {
+                ++numOk;
+                if (o.verbose)
+                    out << id << "\tok\t" << e->compileMs << "\t"
+                        << e->linkMs << "\n";
+            }
+            else
+                out << id << "\tFAILED\t"
+                    << (e ? ShaderValidationResults::statusName(e->status)
+                            + " " + e->log.simplified()
+                          : QString("no result")) << "\n";
+        }
+
+        const auto& stats = validator.stats();
+        std::cerr << numOk << " of " << ids.size() << " shaders compile, "
+                  << stats.numSkipped << " unchanged, "
+                  << stats.seconds << " sec (compile "
+                  << stats.compileMs << " ms, link "
+                  << stats.linkMs << " ms)\n";
+        return numOk == ids.size() ? 0 : 1;
+    }
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QGuiApplication app(argc, argv);
+    QGuiApplication::setApplicationName("shadertoy-cli");
+
+    // child process of the validator's RenderProcessPool
+    if (app.arguments().contains(RenderProcessPool::workerArgument()))
+        return RenderProcessPool::runWorker(app.arguments());
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        "Renders and validates shaders of the local shadertoy cache.\n\n"
+        "commands:\n"
+        "  list      print id, name and user of the selected shaders\n"
+        "            (all, if no query is given)\n"
+        "  render    render the selected shaders to png files\n"
+        "  validate  compile the selected shaders in parallel, print the\n"
+        "            errors and store the results in shader.validation");
+    parser.addHelpOption();
+    parser.addPositionalArgument("command", "list, render or validate");
+    parser.addPositionalArgument("ids", "shader ids", "[ids...]");
+
+    QCommandLineOption
+        optData(QStringList() << "d" << "data",
+                "Directory containing shader/, shader.catalog and assets/.",
+                "dir", "."),
+        optQuery(QStringList() << "q" << "query",
+                 "Select the shaders matching the query, e.g. "
+                 "\"user:iq likes>100\".", "query"),
+        optList(QStringList() << "l" << "list",
+                "Read shader ids from a file, one per line.", "file"),
+        optAll(QStringList() << "a" << "all", "Select all shaders."),
+        optOutput(QStringList() << "o" << "output",
+                  "Directory for the rendered images.", "dir", "."),
+        optSize(QStringList() << "s" << "size",
+                "Resolution of the images.", "WxH", "256x256"),
+        optFrames(QStringList() << "f" << "frames",
+                  "Number of frames, written as <id>_<frame>.png.",
+                  "num", "1"),
+        optFps("fps", "Frames per second of a sequence.", "fps", "60"),
+        optStart("start", "iGlobalTime of the first frame in seconds.",
+                 "sec", "0"),
+        optForce("force", "validate: compile unchanged shaders again."),
+        optVerbose(QStringList() << "v" << "verbose",
+                   "Print every shader and all log messages.");
+    parser.addOptions(QList<QCommandLineOption>()
+                      << optData << optQuery << optList << optAll
+                      << optOutput << optSize << optFrames << optFps
+                      << optStart << optForce << optVerbose);
+    parser.process(app);
+
+    Options o;
+    QStringList args = parser.positionalArguments();
+    if (args.isEmpty())
+        parser.showHelp(2);
+    o.command = args.takeFirst();
+    o.ids = args;
+    o.query = parser.value(optQuery);
+    o.all = parser.isSet(optAll);
+    o.verbose = parser.isSet(optVerbose);
+    o.force = parser.isSet(optForce);
+    o.output = QDir(parser.value(optOutput)).absolutePath();
+    o.frames = std::max(1, parser.value(optFrames).toInt());
+    o.fps = std::max(1., parser.value(optFps).toDouble());
+    o.start = parser.value(optStart).toDouble();
+
+    const QStringList wh = parser.value(optSize).split('x');
+    o.size = wh.size() == 2 ? QSize(wh[0].toInt(), wh[1].toInt()) : QSize();
+    if (o.size.width() < 1 || o.size.height() < 1)
+    {
+        std::cerr << "invalid size '"
+                  << parser.value(optSize).toStdString() << "'\n";
+        return 2;
+    }
+
+    if (parser.isSet(optList))
+    {
+        QFile f(parser.value(optList));
+        if (!f.open(QFile::ReadOnly | QFile::Text))
+        {
+            std::cerr << "can't read '" << f.fileName().toStdString()
+                      << "'\n";
+            return 2;
+        }
+        QTextStream s(&f);
+        while (!s.atEnd())
+        {
+            const QString id = s.readLine().trimmed();
+            if (!id.isEmpty() && !id.startsWith('#'))
+                o.ids << id;
+        }
+    }
+
+    if (!QDir::setCurrent(parser.value(optData)))
+    {
+        std::cerr << "can't change to '"
+                  << parser.value(optData).toStdString() << "'\n";
+        return 2;
+    }
+
+    auto api = ShadertoyApi::acquire();
+    int ret;
+    if (o.command == "list")
+        ret = listShaders(api, o);
+    else if (o.command == "render")
+        ret = renderShaders(api, o);
+    else if (o.command == "validate")
+        ret = validateShaders(api, o);
+    else
+    {
+        std::cerr << "unknown command '" << o.command.toStdString() << "'\n";
+        ret = 2;
+    }
+    flushLog(o.verbose);
+    api->release();
+
+    return ret;
+}
@@ -0,0 +1,22 @@
+#-------------------------------------------------
+#
+# Headless command-line tool, uses only the core library
+#
+#-------------------------------------------------
+
+QT       += core gui network multimedia concurrent
+
+TARGET = shadertoy-cli
+TEMPLATE = app
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+CONFIG(release, debug|release) {
+    DEFINES += NDEBUG
+}
+
+include(../core.pri)
+
+SOURCES += \
+    $$PWD/main.cpp
@@ -1,21 +1,51 @@
+INCLUDEPATH += $$PWD
+
 HEADERS += \
-    core/log.h \
-    core/FramebufferObject.h \
-    core/ShaderListModel.h \
-    core/ShaderSortModel.h \
-    core/ShadertoyApi.h \
-    core/ShadertoyRenderer.h \
-    core/ShadertoyShader.h \
-    $$PWD/core/ShadertoyOffscreenRenderer.h
+    $$PWD/core/log.h \
+    $$PWD/core/FramebufferObject.h \
+    $$PWD/core/ShaderListModel.h \
+    $$PWD/core/ShaderSortModel.h \
+    $$PWD/core/ShadertoyApi.h \
+    $$PWD/core/ShadertoyRenderer.h \
+    $$PWD/core/ShadertoyShader.h \
+    $$PWD/core/ShadertoyOffscreenRenderer.h \
+    $$PWD/core/ShaderCatalogFile.h \
+    $$PWD/core/ShaderCacheManifest.h \
+    $$PWD/core/Benchmark.h \
+    $$PWD/core/DownloadScheduler.h \
+    $$PWD/core/ShaderSearchIndex.h \
+    $$PWD/core/ShaderQuery.h \
+    $$PWD/core/ThumbnailLoader.h \
+    $$PWD/core/ThumbnailStore.h \
+    $$PWD/core/SnapshotJob.h \
+    $$PWD/core/RenderProcessPool.h \
+    $$PWD/core/ShaderValidationResults.h \
+    $$PWD/core/ShaderValidator.h \
+    $$PWD/core/ProgramBinaryCache.h \
+    $$PWD/core/ShaderRenderGraph.h
 
 SOURCES += \
-    core/log.cpp \
-    core/FramebufferObject.cpp \
-    core/ShaderListModel.cpp \
-    core/ShaderSortModel.cpp \
-    core/ShadertoyApi.cpp \
-    core/ShadertoyRenderer.cpp \
-    core/ShadertoyShader.cpp \
-    core/ShadertoyShaderInput.cpp \
-    core/ShadertoyRenderPass.cpp \
-    $$PWD/core/ShadertoyOffscreenRenderer.cpp
+    $$PWD/core/log.cpp \
+    $$PWD/core/FramebufferObject.cpp \
+    $$PWD/core/ShaderListModel.cpp \
+    $$PWD/core/ShaderSortModel.cpp \
+    $$PWD/core/ShadertoyApi.cpp \
+    $$PWD/core/ShadertoyRenderer.cpp \
+    $$PWD/core/ShadertoyShader.cpp \
+    $$PWD/core/ShadertoyShaderInput.cpp \
+    $$PWD/core/ShadertoyRenderPass.cpp \
+    $$PWD/core/ShadertoyOffscreenRenderer.cpp \
+    $$PWD/core/ShaderCatalogFile.cpp \
+    $$PWD/core/ShaderCacheManifest.cpp \
+    $$PWD/core/Benchmark.cpp \
+    $$PWD/core/DownloadScheduler.cpp \
+    $$PWD/core/ShaderSearchIndex.cpp \
+    $$PWD/core/ShaderQuery.cpp \
+    $$PWD/core/ThumbnailLoader.cpp \
+    $$PWD/core/ThumbnailStore.cpp \
+    $$PWD/core/SnapshotJob.cpp \
+    $$PWD/core/RenderProcessPool.cpp \
+    $$PWD/core/ShaderValidationResults.cpp \
+    $$PWD/core/ShaderValidator.cpp \
+    $$PWD/core/ProgramBinaryCache.cpp \
+    $$PWD/core/ShaderRenderGraph.cpp
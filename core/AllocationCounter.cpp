@@ -0,0 +1,108 @@
+/***************************************************************************
+
+Copyright (C) 2016  stefan.berke @ modular-audio-graphics.com
+
+This source is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either
+version 3.0 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this software; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+****************************************************************************/
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "AllocationCounter.h"
+
+namespace {
+
+    std::atomic<quint64> numAllocations(0), numBytes(0);
+
+    inline void countAllocation(std::size_t size)
+    {
+        numAllocations.fetch_add(1, std::memory_order_relaxed);
+        numBytes.fetch_add(size, std::memory_order_relaxed);
+    }
+
+} // namespace
+
+#if defined(__GLIBC__)
+
+// The definitions in the executable take precedence over the
+// ones in libc for all libraries, including Qt.
+// memalign() and friends are not wrapped and not counted,
+// they come from the same glibc heap and are freed by free().
+
+extern "C" {
+
+void* __libc_malloc(std::size_t);
+void* __libc_calloc(std::size_t, std::size_t);
+void* __libc_realloc(void*, std::size_t);
+void __libc_free(void*);
+
+void* malloc(std::size_t size) noexcept
+{
+    countAllocation(size);
+    return __libc_malloc(size);
+}
+
+void* calloc(std::size_t num, std::size_t size) noexcept
+{
+    countAllocation(num * size);
+    return __libc_calloc(num, size);
+}
+
+void* realloc(void* ptr, std::size_t size) noexcept
+{
+    countAllocation(size);
+    return __libc_realloc(ptr, size);
+}
+
+void free(void* ptr) noexcept
+{
+    __libc_free(ptr);
+}
+
+} // extern "C"
+
+const char* AllocationCounter::countedFunction() { return "malloc"; }
+
+#else
+
+namespace {
+
+    void* allocate(std::size_t size)
+    {
+        countAllocation(size);
+        if (void* ptr = std::malloc(size ? size : 1))
+            return ptr;
+        throw std::bad_alloc();
+    }
+
+} // namespace
+
+void* operator new(std::size_t size) { return allocate(size); }
+void* operator new[](std::size_t size) { return allocate(size); }
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+#if defined(__cpp_sized_deallocation)
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { std::free(ptr); }
+#endif
+
+const char* AllocationCounter::countedFunction() { return "operator new"; }
+
+#endif
+
+quint64 AllocationCounter::count() { return numAllocations.load(); }
+quint64 AllocationCounter::bytes() { return numBytes.load(); }
@@ -0,0 +1,60 @@
+/***************************************************************************
+
+Copyright (C) 2016  stefan.berke @ modular-audio-graphics.com
+
+This source is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either
+version 3.0 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this software; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+****************************************************************************/
+
+#ifndef ALLOCATIONCOUNTER_H
+#define ALLOCATIONCOUNTER_H
+
+#include <QtGlobal>
+
+/** Counts heap allocations of the whole process.
+
+    Not part of core.pri, since it replaces the allocator of the whole
+    executable. It is compiled into the gui only when requested with
+    @code
+    qmake CONFIG+=alloc_counter
+    @endcode
+    which defines ST_ALLOC_COUNTER. With glibc, malloc(), calloc()
+    and realloc() are replaced by counting wrappers around the glibc
+    functions, so the payloads of QString, QByteArray, QVector,
+    QVariant and the like are counted, as is operator new, which
+    allocates through malloc(). Other platforms only count calls of
+    the global operator new, see countedFunction().
+
+    For a complete profile including call stacks use heaptrack on a
+    build without alloc_counter. The wrappers in the executable take
+    precedence over LD_PRELOAD, so heaptrack and the sanitizers would
+    not see the allocations:
+    @code
+    heaptrack ./shadertoy
+    heaptrack_print heaptrack.shadertoy.*.gz | less
+    @endcode
+*/
+struct AllocationCounter
+{
+    /** What is counted, "malloc", "operator new" or an empty string */
+    static const char* countedFunction();
+
+    /** Number of allocations since program start, threadsafe */
+    static quint64 count();
+    /** Requested bytes of all allocations since program start */
+    static quint64 bytes();
+};
+
+#endif // ALLOCATIONCOUNTER_H
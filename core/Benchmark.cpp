@@ -0,0 +1,544 @@
+/***************************************************************************
+
+Copyright (C) 2016  stefan.berke @ modular-audio-graphics.com
+
+This source is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either
+version 3.0 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this software; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+****************************************************************************/
+
+#include <algorithm>
+
+#include <QElapsedTimer>
+#include <QDir>
+#include <QFileInfo>
+#include <QTextStream>
+#include <QVector>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QVariant>
+#include <QHash>
+#include <QJsonDocument>
+#include <QEventLoop>
+#include <QTimer>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QHostAddress>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+
+#include "Benchmark.h"
+#include "ShadertoyApi.h"
+#include "ShadertoyShader.h"
+#include "ShaderCatalogFile.h"
+#include "ShaderQuery.h"
+#include "DownloadScheduler.h"
+#include "log.h"
+
+namespace {
+
+    double elapsedMs(const QElapsedTimer& t)
+    {
+        return double(t.nsecsElapsed()) / 1.e6;
+    }
+
+    /** All valid shaders from catalog or json directory */
+    QVector<ShadertoyShader> loadShaders(
+            const QString& shaderPath, const QString& catalogFile)
+    {
+        QVector<ShadertoyShader> shaders;
+
+        ShaderCatalogFile cat;
+        if (QFileInfo(catalogFile).exists() && cat.open(catalogFile))
+        {
+            for (int i=0; i<cat.count(); ++i)
+            {
+                ShadertoyShader shader;
+                if (shader.setJsonData(cat.jsonData(i)) && shader.isValid())
+                    shaders << shader;
+            }
+            return shaders;
+        }
+
+        QDir dir(shaderPath);
+        dir.setFilter(QDir::Files | QDir::NoDotAndDotDot | QDir::Readable);
+        dir.setNameFilters(QStringList() << "*.json");
+        for (const QString& fn : dir.entryList())
+        {
+            auto shader = ShadertoyApi::loadShaderFile(dir.filePath(fn));
+            if (shader.isValid())
+                shaders << shader;
+        }
+        return shaders;
+    }
+
+    /** Reads the descriptors of a pass the way it was done
+        before they were parsed into typed fields */
+    int scanPassJson(const QJsonObject& pass)
+    {
+        int sum = 0;
+        const QString t = pass.value("type").toString();
+        sum += t == "buffer" ? 1 : t == "sound" ? 3 : t == "image" ? 2 : 0;
+
+        auto outputs = pass.value("outputs").toArray();
+        sum += outputs.isEmpty() ? -1 : outputs[0].toObject()
+                                            .value("id").toInt();
+
+        for (const QJsonValue& v : pass.value("inputs").toArray())
+        {
+            const QJsonObject inp = v.toObject();
+            const QString ctype = inp.value("ctype").toString();
+            sum += ctype == "keyboard" ? 6 : ctype == "musicstream" ? 9
+                 : ctype == "music" ? 8 : ctype == "microphone" ? 7
+                 : ctype == "webcam" ? 4 : ctype == "buffer" ? 5
+                 : ctype == "video" ? 3 : ctype == "cubemap" ? 2
+                 : ctype == "texture" ? 1 : 0;
+            sum += inp.value("channel").toInt() + inp.value("id").toInt();
+
+            const QString filter = inp.value("sampler").toObject()
+                                        .value("filter").toString();
+            sum += filter == "linear" ? 1 : filter == "mipmap" ? 2 : 0;
+            if (inp.value("sampler").toObject()
+                    .value("wrap").toString() == "repeat")
+                ++sum;
+            if (inp.value("sampler").toObject()
+                    .value("vflip").toString() == "true")
+                ++sum;
+        }
+        return sum;
+    }
+
+    int scanPassTyped(const ShadertoyRenderPass& pass)
+    {
+        int sum = int(pass.type()) + pass.outputId();
+        for (size_t i=0; i<pass.numInputs(); ++i)
+        {
+            const ShadertoyInput& inp = pass.input(i);
+            if (!inp.isValid())
+                continue;
+            sum += int(inp.type()) + inp.channel() + inp.id()
+                 + int(inp.filterType()) + int(inp.wrapMode())
+                 + (inp.vFlip() ? 1 : 0);
+        }
+        return sum;
+    }
+
+    /** Recorded answer of api/v1/shaders */
+    const char* recordedShaderList =
+        "{\"Shaders\":3,\"Results\":[\"XsX3RB\",\"Ms2SD1\",\"4dXGR4\"]}";
+
+    /** Recorded answer of api/v1/shaders/<id>, shortened,
+        %1 is replaced by the id */
+    const char* recordedShader =
+        "{\"Shader\":{\"ver\":\"0.1\",\"info\":{\"id\":\"%1\","
+        "\"date\":\"1467227400\",\"viewed\":1234,\"name\":\"stub %1\","
+        "\"username\":\"stub\",\"description\":\"recorded response\","
+        "\"likes\":12,\"published\":3,\"flags\":0,"
+        "\"tags\":[\"test\"],\"hasliked\":0},"
+        "\"renderpass\":[{\"inputs\":[],"
+        "\"outputs\":[{\"id\":37,\"channel\":0}],"
+        "\"code\":\"void mainImage(out vec4 fragColor, in vec2 fragCoord)"
+        " { fragColor = vec4(fragCoord / iResolution.xy, 0., 1.); }\","
+        "\"name\":\"Image\",\"description\":\"\",\"type\":\"image\"}]}}";
+
+    /** Minimal http server on localhost with the recorded responses.
+
+        Each request is answered after @c delay msecs, so parallel
+        requests overlap. Paths starting with @c /flaky/ answer 503
+        for the first @c numFlaky attempts, @c /fail/ always answers
+        503 and unknown paths answer 404. */
+    struct StubServer
+    {
+        StubServer() : delay(20), numFlaky(2), numOpen(0), maxOpen(0) { }
+
+        bool listen()
+        {
+            QObject::connect(&server, &QTcpServer::newConnection, [=]()
+            {
+                while (QTcpSocket* sock = server.nextPendingConnection())
+                    accept(sock);
+            });
+            return server.listen(QHostAddress::LocalHost);
+        }
+
+        QString url() const
+        {
+            return QString("http://127.0.0.1:%1").arg(server.serverPort());
+        }
+
+        void accept(QTcpSocket* sock)
+        {
+            QObject::connect(sock, &QTcpSocket::disconnected,
+                             sock, &QObject::deleteLater);
+            QObject::connect(sock, &QTcpSocket::readyRead, sock, [=]()
+            {
+                const QByteArray req = sock->property("request").toByteArray()
+                                     + sock->readAll();
+                sock->setProperty("request", req);
+                if (!req.contains("\r\n\r\n")
+                        || sock->property("answered").toBool())
+                    return;
+                sock->setProperty("answered", true);
+
+                const QByteArray path = req.split(' ').value(1).split('?')[0];
+                log << QString::fromLatin1(path);
+                maxOpen = std::max(maxOpen, ++numOpen);
+
+                QTimer::singleShot(delay, sock, [=]()
+                {
+                    --numOpen;
+                    respond(sock, path);
+                });
+            });
+        }
+
+        void respond(QTcpSocket* sock, const QByteArray& path)
+        {
+            int status = 200;
+            QByteArray body;
+            if (path.startsWith("/fail/")
+                || (path.startsWith("/flaky/") && ++attempts[path] <= numFlaky))
+                status = 503;
+            else if (path == "/api/v1/shaders")
+                body = recordedShaderList;
+            else if (path.startsWith("/api/v1/shaders/"))
+                body = QString(recordedShader)
+                        .arg(QString::fromLatin1(path.mid(16))).toUtf8();
+            else if (!path.startsWith("/flaky/"))
+                status = 404;
+
+            sock->write("HTTP/1.1 " + QByteArray::number(status)
+                        + (status == 200 ? " OK" : " Error")
+                        + "\r\nContent-Type: application/json"
+                        + "\r\nContent-Length: "
+                        + QByteArray::number(body.size())
+                        + "\r\nConnection: close\r\n\r\n" + body);
+            sock->disconnectFromHost();
+        }
+
+        QTcpServer server;
+        int delay, numFlaky, numOpen, maxOpen;
+        QHash<QByteArray, int> attempts;
+        /** Requested paths in order of arrival */
+        QStringList log;
+    };
+
+} // namespace
+
+QString Benchmark::catalogStartup(
+        const QString& shaderPath, const QString& catalogFile)
+{
+    QString report;
+    QTextStream s(&report);
+    QElapsedTimer timer;
+
+    // --- json directory (scan + open + parse each file) ---
+
+    timer.start();
+    int numJson = 0;
+    {
+        QDir dir(shaderPath);
+        dir.setFilter(QDir::Files | QDir::NoDotAndDotDot | QDir::Readable);
+        dir.setNameFilters(QStringList() << "*.json");
+        for (const QString& fn : dir.entryList())
+            if (ShadertoyApi::loadShaderFile(dir.filePath(fn)).isValid())
+                ++numJson;
+    }
+    const double jsonMs = elapsedMs(timer);
+
+    // --- packed catalog (map + parse each record) ---
+
+    timer.start();
+    int numCat = 0;
+    {
+        ShaderCatalogFile cat;
+        if (cat.open(catalogFile))
+        {
+            for (int i=0; i<cat.count(); ++i)
+            {
+                ShadertoyShader shader;
+                if (shader.setJsonData(cat.jsonData(i)) && shader.isValid())
+                    ++numCat;
+            }
+        }
+    }
+    const double catMs = elapsedMs(timer);
+
+    s << "json directory '" << shaderPath << "': "
+      << numJson << " shaders in " << jsonMs << " ms\n"
+      << "packed catalog '" << catalogFile << "': "
+      << numCat << " shaders in " << catMs << " ms\n";
+    if (numJson && numCat && catMs > 0.)
+        s << "speed-up: " << (jsonMs / numJson) / (catMs / numCat)
+          << "x per shader\n";
+
+    ST_INFO("Benchmark::catalogStartup()\n" << report);
+    return report;
+}
+
+QString Benchmark::descriptorScan(
+        const QString& shaderPath, const QString& catalogFile, int iterations)
+{
+    QString report;
+    QTextStream s(&report);
+    QElapsedTimer timer;
+
+    const auto shaders = loadShaders(shaderPath, catalogFile);
+
+    QVector<QJsonObject> passJson;
+    for (const ShadertoyShader& shader : shaders)
+        for (size_t i=0; i<shader.numRenderPasses(); ++i)
+            passJson << shader.renderPass(i).jsonData();
+
+    // checksums keep the compiler from skipping the work
+    qint64 sumJson = 0, sumTyped = 0;
+
+    timer.start();
+    for (int it=0; it<iterations; ++it)
+        for (const QJsonObject& pass : passJson)
+            sumJson += scanPassJson(pass);
+    const double jsonMs = elapsedMs(timer);
+
+    timer.start();
+    for (int it=0; it<iterations; ++it)
+        for (const ShadertoyShader& shader : shaders)
+            for (size_t i=0; i<shader.numRenderPasses(); ++i)
+                sumTyped += scanPassTyped(shader.renderPass(i));
+    const double typedMs = elapsedMs(timer);
+
+    s << shaders.size() << " shaders, " << passJson.size() << " passes, "
+      << iterations << " iterations\n"
+      << "json lookups:  " << jsonMs << " ms (checksum " << sumJson << ")\n"
+      << "typed fields:  " << typedMs << " ms (checksum " << sumTyped << ")\n";
+    if (typedMs > 0.)
+        s << "speed-up: " << jsonMs / typedMs << "x\n";
+
+    ST_INFO("Benchmark::descriptorScan()\n" << report);
+    return report;
+}
+
+QString Benchmark::queryEvaluation(
+        const QString& shaderPath, const QString& catalogFile,
+        const QString& queryText, int iterations)
+{
+    QString report;
+    QTextStream s(&report);
+    QElapsedTimer timer;
+
+    const auto shaders = loadShaders(shaderPath, catalogFile);
+    const ShaderQuery query(queryText);
+
+    // the terms of the previous ShaderSortModel::setFulltextFilter()
+    QStringList filters;
+    for (QString t : queryText.split(";"))
+    {
+        t = t.simplified();
+        if (!t.isEmpty())
+            filters << t;
+    }
+
+    int numPrevious = 0, numCompiled = 0;
+
+    // previous ShaderSortModel::filterAcceptsRow()
+    timer.start();
+    for (int it=0; it<iterations; ++it)
+        for (const ShadertoyShader& shader : shaders)
+            for (const QString& f : filters)
+                if (shader.containsString(f))
+                {
+                    ++numPrevious;
+                    break;
+                }
+    const double previousMs = elapsedMs(timer);
+
+    timer.start();
+    for (int it=0; it<iterations; ++it)
+        for (const ShadertoyShader& shader : shaders)
+        {
+            const auto m = query.matchInfo(shader.info());
+            if (m == ShaderQuery::M_YES
+                || (m == ShaderQuery::M_NEEDS_SOURCE && query.matches(shader)))
+                ++numCompiled;
+        }
+    const double compiledMs = elapsedMs(timer);
+
+    s << "query '" << queryText << "' compiled to '" << query.toString()
+      << "'\n" << shaders.size() << " shaders, " << iterations
+      << " iterations, " << numCompiled / std::max(1, iterations)
+      << " matches\n"
+      << "previous substring filter: " << previousMs << " ms ("
+      << numPrevious << ")\n"
+      << "compiled query:            " << compiledMs << " ms ("
+      << numCompiled << ")\n";
+    if (compiledMs > 0.)
+        s << "speed-up: " << previousMs / compiledMs << "x\n";
+    if (!query.isPlainText())
+        s << "the previous filter searches the fields as substrings\n";
+    else if (numPrevious != numCompiled)
+        s << "MISMATCH between previous and compiled results\n";
+
+    ST_INFO("Benchmark::queryEvaluation()\n" << report);
+    return report;
+}
+
+QString Benchmark::downloadScheduler()
+{
+    QString report;
+    QTextStream s(&report);
+    int numFailedChecks = 0;
+    auto check = [&](bool ok, const QString& what)
+    {
+        s << (ok ? "ok      " : "FAILED  ") << what << "\n";
+        if (!ok)
+            ++numFailedChecks;
+    };
+
+    StubServer server;
+    if (!server.listen())
+    {
+        s << "could not start the stub server, "
+          << server.server.errorString() << "\n";
+        return report;
+    }
+    const QString url = server.url();
+    s << "stub server at " << url << "\n";
+
+    QNetworkAccessManager net;
+    DownloadScheduler sched(&net);
+    sched.setMaxInFlight(3);
+    sched.setMaxRetries(3);
+    sched.setRetryDelay(10);
+
+    QStringList received, failed;
+    int numShaders = 0, numListed = 0;
+    QObject::connect(&sched, &DownloadScheduler::replyReceived,
+                     [&](QNetworkReply* reply)
+    {
+        const QString path = reply->url().path();
+        received << path;
+        const auto json = QJsonDocument::fromJson(reply->readAll()).object();
+        if (path == "/api/v1/shaders")
+            numListed = json.value("Results").toArray().size();
+        else
+        {
+            ShadertoyShader shader;
+            if (shader.setJsonData(json.value("Shader").toObject())
+                    && shader.isValid())
+                ++numShaders;
+        }
+    });
+    QObject::connect(&sched, &DownloadScheduler::requestFailed,
+                     [&](const QUrl& u, const QVariant&, const QString&)
+    {
+        failed << u.path();
+    });
+
+    auto run = [&]()
+    {
+        QEventLoop loop;
+        QObject::connect(&sched, &DownloadScheduler::idle,
+                         &loop, &QEventLoop::quit);
+        QTimer::singleShot(10000, &loop, &QEventLoop::quit);
+        if (!sched.isIdle())
+            loop.exec();
+    };
+    QElapsedTimer timer;
+    timer.start();
+
+    // --- concurrency limit ---
+
+    sched.enqueue(QUrl(url + "/api/v1/shaders?key=stub"), "list", 2);
+    for (int i=0; i<24; ++i)
+        sched.enqueue(QUrl(url + QString("/api/v1/shaders/stub%1?key=stub")
+                           .arg(i, 2, 10, QChar('0'))), i, 0);
+    run();
+    check(server.maxOpen == sched.maxInFlight(),
+          QString("at most %1 parallel requests (%2)")
+            .arg(sched.maxInFlight()).arg(server.maxOpen));
+    check(received.size() == 25 && numShaders == 24 && numListed == 3,
+          QString("recorded responses received (%1 replies, %2 shaders, "
+                  "%3 listed)")
+            .arg(received.size()).arg(numShaders).arg(numListed));
+
+    // --- retries ---
+
+    received.clear();
+    sched.enqueue(QUrl(url + "/flaky/a"), "a");
+    sched.enqueue(QUrl(url + "/flaky/b"), "b");
+    sched.enqueue(QUrl(url + "/fail/c"), "c");
+    sched.enqueue(QUrl(url + "/missing"), "d");
+    run();
+    const DownloadScheduler::Stats stats = sched.stats();
+    check(received.contains("/flaky/a") && received.contains("/flaky/b"),
+          QString("transient errors are retried until success (%1)")
+            .arg(received.join(", ")));
+    check(failed.contains("/fail/c") && failed.contains("/missing"),
+          QString("failed after retries or not retried (%1)")
+            .arg(failed.join(", ")));
+    check(stats.numRetries == 2 * server.numFlaky + sched.maxRetries()
+          && stats.numFailed == 2,
+          QString("%1 retries, %2 failed")
+            .arg(stats.numRetries).arg(stats.numFailed));
+
+    // --- priorities ---
+
+    sched.setMaxInFlight(1);
+    server.log.clear();
+    for (int i=0; i<10; ++i)
+        sched.enqueue(QUrl(url + QString("/api/v1/shaders/bulk%1").arg(i)),
+                      i, 0);
+    sched.enqueue(QUrl(url + "/api/v1/shaders/single"), "single", 1);
+    // already queued, only moves up
+    sched.enqueue(QUrl(url + "/api/v1/shaders/bulk5"), "bulk5", 1);
+    run();
+    check(server.log.size() == 11
+          && server.log.value(1) == "/api/v1/shaders/single"
+          && server.log.value(2) == "/api/v1/shaders/bulk5"
+          && server.log.value(3) == "/api/v1/shaders/bulk1",
+          QString("single requests go before the bulk (%1)")
+            .arg(server.log.join(", ")));
+
+    // --- duplicates ---
+
+    // enqueue the same urls again while they are running
+    // or waiting for their retry
+    sched.setMaxInFlight(3);
+    server.log.clear();
+    received.clear();
+    const QStringList dupPaths = { "/api/v1/shaders/dup", "/flaky/dup" };
+    QTimer again;
+    again.setInterval(5);
+    QObject::connect(&again, &QTimer::timeout, [&]()
+    {
+        for (const QString& path : dupPaths)
+            if (!received.contains(path))
+                sched.enqueue(QUrl(url + path), path);
+    });
+    for (const QString& path : dupPaths)
+        sched.enqueue(QUrl(url + path), path);
+    again.start();
+    run();
+    again.stop();
+    check(server.log.count(dupPaths[0]) == 1
+          && server.log.count(dupPaths[1]) == 1 + server.numFlaky
+          && received.count(dupPaths[0]) == 1
+          && received.count(dupPaths[1]) == 1,
+          QString("running or retried urls are not requested twice (%1)")
+            .arg(server.log.join(", ")));
+
+    s << numFailedChecks << " checks failed, " << timer.elapsed() << " ms\n";
+
+    ST_INFO("Benchmark::downloadScheduler()\n" << report);
+    return report;
+}
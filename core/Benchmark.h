@@ -0,0 +1,60 @@
+/***************************************************************************
+
+Copyright (C) 2016  stefan.berke @ modular-audio-graphics.com
+
+This source is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either
+version 3.0 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this software; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+****************************************************************************/
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <QString>
+
+/** Namespace for static functions measuring performance.
+    Each function returns a human-readable report. */
+struct Benchmark
+{
+    /** Compares reading all shaders from the json directory
+        against reading them from the packed catalog file. */
+    static QString catalogStartup(const QString& shaderPath,
+                                  const QString& catalogFile);
+
+    /** Compares reading the pass and input descriptors of all shaders
+        through json lookups against the pre-parsed typed fields.
+        Shaders are read from the catalog if present,
+        otherwise from the json directory. */
+    static QString descriptorScan(const QString& shaderPath,
+                                  const QString& catalogFile,
+                                  int iterations = 20);
+
+    /** Compares the compiled ShaderQuery against the previous filter
+        of ShaderSortModel, which split the text at ';' and searched
+        each part with ShadertoyShader::containsString().
+        The results are compared for plain-text queries. */
+    static QString queryEvaluation(const QString& shaderPath,
+                                   const QString& catalogFile,
+                                   const QString& query,
+                                   int iterations = 20);
+
+    /** Runs a DownloadScheduler against a stub http server on
+        localhost, which answers with recorded api responses.
+        Checks the limit of parallel requests, the retries of
+        transient errors, the order of priorities and that running
+        or retried urls are not requested twice. */
+    static QString downloadScheduler();
+};
+
+#endif // BENCHMARK_H
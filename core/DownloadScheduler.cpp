@@ -0,0 +1,342 @@
+/***************************************************************************
+
+Copyright (C) 2016  stefan.berke @ modular-audio-graphics.com
+
+This source is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either
+version 3.0 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this software; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+****************************************************************************/
+
+#include <algorithm>
+
+#include <QNetworkAccessManager>
+#include <QNetworkRequest>
+#include <QNetworkReply>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMap>
+#include <QPair>
+#include <QSet>
+
+#include "DownloadScheduler.h"
+#include "log.h"
+
+namespace {
+
+    /** Errors that are worth another try */
+    bool isTransientError(QNetworkReply* reply)
+    {
+        const int status = reply->attribute(
+                    QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        if (status == 429 || status >= 500)
+            return true;
+
+        switch (reply->error())
+        {
+            case QNetworkReply::RemoteHostClosedError:
+            case QNetworkReply::TimeoutError:
+            case QNetworkReply::TemporaryNetworkFailureError:
+            case QNetworkReply::NetworkSessionFailedError:
+            case QNetworkReply::UnknownNetworkError:
+            case QNetworkReply::ProxyTimeoutError:
+            case QNetworkReply::ServiceUnavailableError:
+            case QNetworkReply::InternalServerError:
+            case QNetworkReply::UnknownServerError:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+} // namespace
+
+struct DownloadScheduler::Private
+{
+    Private(DownloadScheduler* p, QNetworkAccessManager* net)
+        : p             (p)
+        , net           (net)
+        , maxInFlight   (6)
+        , timeout       (30000)
+        , maxRetries    (4)
+        , retryDelay    (500)
+        , maxRetryDelay (30000)
+        , sequence      (0)
+        , generation    (0)
+    { }
+
+    struct Request
+    {
+        QUrl url;
+        QVariant user;
+        int priority, attempt;
+    };
+
+    /** Sorts by priority (high first), then by order of enqueue */
+    typedef QPair<int, quint64> Key;
+
+    void push(const Request& r);
+    void pump();
+    void start(const Request& r);
+    void onFinished(QNetworkReply* reply);
+    void retryLater(Request r);
+    void updateTime();
+
+    DownloadScheduler* p;
+    QNetworkAccessManager* net;
+
+    int maxInFlight, timeout, maxRetries, retryDelay, maxRetryDelay;
+
+    QMap<Key, Request> queue;
+    /** Queue key of each queued url */
+    QHash<QUrl, Key> queued;
+    QHash<QNetworkReply*, Request> running;
+    /** Urls of the running requests */
+    QSet<QUrl> inFlight;
+    quint64 sequence;
+    /** Increased by clear() to drop pending retries */
+    quint64 generation;
+    /** Priority of each url waiting for its retry */
+    QHash<QUrl, int> waiting;
+
+    Stats stats;
+    QElapsedTimer timer;
+};
+
+DownloadScheduler::DownloadScheduler(QNetworkAccessManager* net, QObject* parent)
+    : QObject       (parent)
+    , p_            (new Private(this, net))
+{
+    ST_DEBUG_CTOR("DownloadScheduler()");
+}
+
+DownloadScheduler::~DownloadScheduler()
+{
+    ST_DEBUG_CTOR("~DownloadScheduler()");
+    clear();
+    delete p_;
+}
+
+int DownloadScheduler::maxInFlight() const { return p_->maxInFlight; }
+int DownloadScheduler::timeout() const { return p_->timeout; }
+int DownloadScheduler::maxRetries() const { return p_->maxRetries; }
+int DownloadScheduler::retryDelay() const { return p_->retryDelay; }
+int DownloadScheduler::numQueued() const { return p_->queue.size(); }
+int DownloadScheduler::numInFlight() const { return p_->running.size(); }
+const DownloadScheduler::Stats& DownloadScheduler::stats() const
+    { return p_->stats; }
+
+bool DownloadScheduler::isIdle() const
+{
+    return p_->queue.isEmpty() && p_->running.isEmpty()
+            && p_->waiting.isEmpty();
+}
+
+double DownloadScheduler::progress() const
+{
+    const Stats& s = p_->stats;
+    return s.numRequests
+            ? 100. * (s.numFinished + s.numFailed) / s.numRequests
+            : 100.;
+}
+
+void DownloadScheduler::setMaxInFlight(int num)
+{
+    p_->maxInFlight = std::max(1, num);
+    p_->pump();
+}
+
+void DownloadScheduler::setTimeout(int msec) { p_->timeout = msec; }
+void DownloadScheduler::setMaxRetries(int num) { p_->maxRetries = num; }
+void DownloadScheduler::setRetryDelay(int msec) { p_->retryDelay = msec; }
+
+void DownloadScheduler::enqueue(
+        const QUrl& url, const QVariant& userData, int priority)
+{
+    ST_DEBUG2("DownloadScheduler::enqueue('" << url.toString() << "', "
+              << priority << ")");
+
+    if (isIdle())
+    {
+        p_->stats = Stats();
+        p_->timer.start();
+    }
+    // already queued, e.g. a single request for a shader
+    // that is part of a bulk download
+    auto q = p_->queued.find(url);
+    if (q != p_->queued.end())
+    {
+        if (priority > -q.value().first)
+        {
+            Private::Request r = p_->queue.take(q.value());
+            p_->queued.erase(q);
+            r.priority = priority;
+            p_->push(r);
+        }
+        return;
+    }
+    // already requested, the reply is on its way
+    if (p_->inFlight.contains(url))
+        return;
+    // failed before, keep the higher priority for the retry
+    auto w = p_->waiting.find(url);
+    if (w != p_->waiting.end())
+    {
+        w.value() = std::max(w.value(), priority);
+        return;
+    }
+
+    ++p_->stats.numRequests;
+
+    Private::Request r;
+    r.url = url;
+    r.user = userData;
+    r.priority = priority;
+    r.attempt = 0;
+    p_->push(r);
+    p_->pump();
+}
+
+void DownloadScheduler::clear()
+{
+    ST_DEBUG2("DownloadScheduler::clear() queued=" << p_->queue.size()
+              << " running=" << p_->running.size());
+
+    p_->queue.clear();
+    p_->queued.clear();
+    ++p_->generation;
+    p_->waiting.clear();
+    p_->inFlight.clear();
+
+    // abort() emits finished(), which deletes the unknown replies
+    auto replies = p_->running.keys();
+    p_->running.clear();
+    for (QNetworkReply* reply : replies)
+        reply->abort();
+}
+
+void DownloadScheduler::Private::push(const Request& r)
+{
+    const Key key(-r.priority, sequence++);
+    queue.insert(key, r);
+    queued.insert(r.url, key);
+}
+
+void DownloadScheduler::Private::pump()
+{
+    while (running.size() < maxInFlight && !queue.isEmpty())
+    {
+        auto i = queue.begin();
+        const Request r = i.value();
+        queue.erase(i);
+        queued.remove(r.url);
+        start(r);
+    }
+}
+
+void DownloadScheduler::Private::start(const Request& r)
+{
+    ST_DEBUG2("DownloadScheduler: GET '" << r.url.toString() << "' attempt "
+              << r.attempt);
+
+    auto reply = net->get(QNetworkRequest(r.url));
+    reply->setProperty("user", r.user);
+    running.insert(reply, r);
+    inFlight.insert(r.url);
+
+    connect(reply, &QNetworkReply::finished, p, [=](){ onFinished(reply); });
+
+    // the reply as context object stops the timer when it's deleted
+    QTimer::singleShot(timeout, reply, [=]()
+    {
+        if (reply->isRunning())
+        {
+            reply->setProperty("timedOut", true);
+            reply->abort();
+        }
+    });
+}
+
+void DownloadScheduler::Private::updateTime()
+{
+    stats.seconds = double(timer.nsecsElapsed()) / 1.e9;
+}
+
+void DownloadScheduler::Private::onFinished(QNetworkReply* reply)
+{
+    auto i = running.find(reply);
+    if (i == running.end())
+    {
+        // removed by clear()
+        reply->deleteLater();
+        return;
+    }
+    const Request r = i.value();
+    running.erase(i);
+    inFlight.remove(r.url);
+
+    const bool timedOut = reply->property("timedOut").toBool();
+    if (timedOut)
+        ++stats.numTimeouts;
+
+    if (!timedOut && reply->error() == QNetworkReply::NoError)
+    {
+        ++stats.numFinished;
+        stats.bytesReceived += reply->bytesAvailable();
+        updateTime();
+        emit p->replyReceived(reply);
+    }
+    else if (r.attempt < maxRetries && (timedOut || isTransientError(reply)))
+    {
+        ST_DEBUG("DownloadScheduler: retrying '" << r.url.toString() << "', "
+                 << (timedOut ? QString("timeout") : reply->errorString()));
+        retryLater(r);
+    }
+    else
+    {
+        ++stats.numFailed;
+        updateTime();
+        const QString error = timedOut ? QString("timeout")
+                                       : reply->errorString();
+        ST_WARN("DownloadScheduler: request '" << r.url.toString()
+                << "' failed, " << error);
+        emit p->requestFailed(r.url, r.user, error);
+    }
+
+    reply->deleteLater();
+
+    pump();
+    if (p->isIdle())
+        emit p->idle();
+}
+
+void DownloadScheduler::Private::retryLater(Request r)
+{
+    ++stats.numRetries;
+    waiting.insert(r.url, r.priority);
+    const int delay = std::min(maxRetryDelay,
+                               retryDelay << std::min(r.attempt, 16));
+    ++r.attempt;
+
+    const quint64 gen = generation;
+    QTimer::singleShot(delay, p, [=]()
+    {
+        if (gen != generation)
+            return;
+        Request retry = r;
+        retry.priority = waiting.take(r.url);
+        push(retry);
+        pump();
+    });
+}
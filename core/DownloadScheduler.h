@@ -0,0 +1,118 @@
+/***************************************************************************
+
+Copyright (C) 2016  stefan.berke @ modular-audio-graphics.com
+
+This source is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either
+version 3.0 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this software; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+****************************************************************************/
+
+#ifndef DOWNLOADSCHEDULER_H
+#define DOWNLOADSCHEDULER_H
+
+#include <QObject>
+#include <QUrl>
+#include <QVariant>
+
+class QNetworkAccessManager;
+class QNetworkReply;
+
+/** Queue of GET requests with a bounded number of parallel requests.
+
+    Requests with higher priority are started first, requests of the
+    same priority in the order of enqueue(). Each request has a timeout
+    and transient errors are retried with exponential backoff.
+
+    A url that is queued, running or waiting for a retry is not
+    requested twice, enqueueing it again only raises its priority.
+    The first user data is kept.
+
+    The user data given to enqueue() is set as the "user" property
+    of the QNetworkReply.
+*/
+class DownloadScheduler : public QObject
+{
+    Q_OBJECT
+public:
+    /** Statistics since the scheduler last became busy */
+    struct Stats
+    {
+        Stats() : numRequests(0), numFinished(0), numFailed(0),
+                  numRetries(0), numTimeouts(0), bytesReceived(0),
+                  seconds(0.) { }
+        int numRequests, numFinished, numFailed, numRetries, numTimeouts;
+        qint64 bytesReceived;
+        double seconds;
+        double requestsPerSecond() const
+            { return seconds > 0. ? numFinished / seconds : 0.; }
+        double bytesPerSecond() const
+            { return seconds > 0. ? bytesReceived / seconds : 0.; }
+    };
+
+    DownloadScheduler(QNetworkAccessManager* net, QObject* parent = nullptr);
+    ~DownloadScheduler();
+
+    // --- getter ---
+
+    int maxInFlight() const;
+    /** Timeout per request in milliseconds */
+    int timeout() const;
+    int maxRetries() const;
+    /** Delay before the first retry in milliseconds,
+        doubled for each further retry */
+    int retryDelay() const;
+
+    int numQueued() const;
+    int numInFlight() const;
+    /** No requests queued, running or waiting for retry */
+    bool isIdle() const;
+
+    const Stats& stats() const;
+    /** Finished and failed requests in percent of all requests */
+    double progress() const;
+
+    // --- setter ---
+
+    void setMaxInFlight(int num);
+    void setTimeout(int msec);
+    void setMaxRetries(int num);
+    void setRetryDelay(int msec);
+
+public slots:
+
+    void enqueue(const QUrl& url, const QVariant& userData, int priority = 0);
+
+    /** Drops all queued requests and aborts the running ones.
+        No signals are emitted for them. */
+    void clear();
+
+signals:
+
+    /** A request finished successfully.
+        The reply is deleted after the signal returns. */
+    void replyReceived(QNetworkReply* reply);
+
+    /** A request failed after all retries */
+    void requestFailed(const QUrl& url, const QVariant& userData,
+                       const QString& error);
+
+    /** All requests are finished or failed */
+    void idle();
+
+private:
+    struct Private;
+    Private* p_;
+};
+
+#endif // DOWNLOADSCHEDULER_H
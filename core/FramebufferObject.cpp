@@ -9,10 +9,19 @@
 */
 
 #include <QOpenGLFunctions>
+#include <QOpenGLExtraFunctions>
+#include <QOpenGLFramebufferObject>
 
 #include "FramebufferObject.h"
 #include "log.h"
 
+#ifndef GL_READ_FRAMEBUFFER
+#   define GL_READ_FRAMEBUFFER 0x8CA8
+#endif
+#ifndef GL_DRAW_FRAMEBUFFER
+#   define GL_DRAW_FRAMEBUFFER 0x8CA9
+#endif
+
 
 FramebufferObject::FramebufferObject(QOpenGLContext* ctx)
     : p_ctx_        (ctx)
@@ -75,6 +84,50 @@ bool FramebufferObject::create(const QSize &s)
     return true;
 }
 
+bool FramebufferObject::resize(const QSize& s, bool keepContents)
+{
+    if (!keepContents || p_tex2_ < 0 || p_fbo_ < 0
+            || !QOpenGLFramebufferObject::hasOpenGLFramebufferBlit())
+        return create(s);
+
+    ST_DEBUG2("FramebufferObject::resize(" << s.width()
+              << ", " << s.height() << ")");
+
+    // keep the last complete frame from release()
+    const QSize oldSize = p_size_;
+    GLuint oldTex = p_tex2_;
+    p_tex2_ = -1;
+    if (!create(s))
+        return false;
+    p_tex2_ = p_createTex_();
+
+    auto gl = p_ctx_->functions();
+    auto glx = p_ctx_->extraFunctions();
+
+    GLuint readFbo;
+    ST_CHECK_GL( gl->glGenFramebuffers(1, &readFbo) );
+    ST_CHECK_GL( gl->glBindFramebuffer(GL_READ_FRAMEBUFFER, readFbo) );
+    ST_CHECK_GL( gl->glFramebufferTexture2D(
+            GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, oldTex, 0) );
+    ST_CHECK_GL( gl->glBindFramebuffer(GL_DRAW_FRAMEBUFFER, p_fbo_) );
+    ST_CHECK_GL( gl->glFramebufferTexture2D(
+            GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, p_tex2_, 0) );
+
+    ST_CHECK_GL( glx->glBlitFramebuffer(
+            0, 0, oldSize.width(), oldSize.height(),
+            0, 0, s.width(), s.height(),
+            GL_COLOR_BUFFER_BIT, GL_LINEAR) );
+
+    // render target is the other texture again
+    ST_CHECK_GL( gl->glFramebufferTexture2D(
+            GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, p_tex1_, 0) );
+    ST_CHECK_GL( gl->glBindFramebuffer(GL_FRAMEBUFFER, 0) );
+    ST_CHECK_GL( gl->glDeleteFramebuffers(1, &readFbo) );
+    gl->glDeleteTextures(1, &oldTex);
+
+    return true;
+}
+
 int FramebufferObject::texture() const { return p_tex1_; }
 int FramebufferObject::readableTexture() const { return p_tex2_; }
 
@@ -31,6 +31,10 @@ public:
     /** Creates a new fbo with color attachment for given resolution.
         Previous fbo will be released. */
     bool create(const QSize& s);
+    /** Changes the resolution. With @p keepContents, the readable
+        texture is scaled into the new one, if the driver supports
+        framebuffer blits. Otherwise same as create(). */
+    bool resize(const QSize& s, bool keepContents);
     /** Release all OpenGL resources.
         Does nothing if nothing is created. */
     void release();
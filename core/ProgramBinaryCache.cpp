@@ -0,0 +1,451 @@
+/***************************************************************************
+
+Copyright (C) 2016  stefan.berke @ modular-audio-graphics.com
+
+This source is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either
+version 3.0 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this software; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+****************************************************************************/
+
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QDataStream>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QCryptographicHash>
+#include <QOpenGLContext>
+#include <QOpenGLFunctions>
+#include <QOpenGLShaderProgram>
+
+#include "ProgramBinaryCache.h"
+#include "log.h"
+
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#   define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#   define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#   define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+namespace {
+
+    const quint32 binaryMagic = 0x53545042; // "STPB"
+    const quint32 binaryVersion = 1;
+
+    typedef void (QOPENGLF_APIENTRYP GetProgramBinaryFunc)(
+            GLuint, GLsizei, GLsizei*, GLenum*, void*);
+    typedef void (QOPENGLF_APIENTRYP ProgramBinaryFunc)(
+            GLuint, GLenum, const void*, GLint);
+    typedef void (QOPENGLF_APIENTRYP ProgramParameteriFunc)(
+            GLuint, GLenum, GLint);
+
+    /** Entry points of the current context, resolved per call
+        since programs are only loaded when a shader changes */
+    struct Functions
+    {
+        Functions()
+            : getProgramBinary(nullptr), programBinary(nullptr),
+              programParameteri(nullptr) { }
+
+        GetProgramBinaryFunc getProgramBinary;
+        ProgramBinaryFunc programBinary;
+        ProgramParameteriFunc programParameteri;
+
+        bool resolve(QOpenGLContext* ctx)
+        {
+            if (!ctx)
+                return false;
+
+            const auto version = ctx->format().version();
+            const bool core = ctx->isOpenGLES() ? version.first >= 3
+                                                : version >= qMakePair(4, 1);
+            QByteArray suffix;
+            if (!core && !ctx->hasExtension("GL_ARB_get_program_binary"))
+            {
+                if (!ctx->hasExtension("GL_OES_get_program_binary"))
+                    return false;
+                suffix = "OES";
+            }
+
+            getProgramBinary = reinterpret_cast<GetProgramBinaryFunc>(
+                    ctx->getProcAddress("glGetProgramBinary" + suffix));
+            programBinary = reinterpret_cast<ProgramBinaryFunc>(
+                    ctx->getProcAddress("glProgramBinary" + suffix));
+            // the hint is not part of the OES extension
+            if (suffix.isEmpty())
+                programParameteri = reinterpret_cast<ProgramParameteriFunc>(
+                        ctx->getProcAddress("glProgramParameteri"));
+            if (!getProgramBinary || !programBinary)
+                return false;
+
+            GLint numFormats = 0;
+            ctx->functions()->glGetIntegerv(
+                        GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+            return numFormats > 0;
+        }
+    };
+
+    QByteArray glString(QOpenGLFunctions* gl, GLenum name)
+    {
+        return QByteArray(reinterpret_cast<const char*>(gl->glGetString(name)));
+    }
+
+    /** Sets the modification time to now, so the scan of the next
+        run sorts the file as recently used */
+    void touchFile(const QString& fn)
+    {
+        QFile file(fn);
+#if QT_VERSION >= QT_VERSION_CHECK(5, 10, 0)
+        if (file.open(QFile::ReadWrite))
+            file.setFileTime(QDateTime::currentDateTimeUtc(),
+                             QFileDevice::FileModificationTime);
+#else
+        // rewriting the first byte updates the time
+        char c;
+        if (file.open(QFile::ReadWrite) && file.getChar(&c))
+        {
+            file.seek(0);
+            file.putChar(c);
+        }
+#endif
+    }
+
+} // namespace
+
+struct ProgramBinaryCache::Private
+{
+    Private()
+        : directory     ("./program.cache/")
+        , maxBytes      (qint64(64) << 20)
+        , enabled       (true)
+        , scanned       (false)
+        , useCounter    (0)
+    { }
+
+    struct File
+    {
+        qint64 size;
+        /** Higher is more recent */
+        quint64 lastUse;
+    };
+
+    QString filename(const QByteArray& key) const
+        { return directory + QString::fromLatin1(key.toHex()) + ".bin"; }
+    /** Reads the directory once, in order of modification time.
+        The mutex must be locked. */
+    void scan();
+    void insertFile(const QByteArray& key, qint64 size);
+    void removeFile(const QByteArray& key);
+    /** Removes least recently used files until below maxBytes */
+    void evict();
+    static bool readFile(const QString& fn, GLenum& format, QByteArray& data);
+
+    mutable QMutex mutex;
+    QString directory;
+    qint64 maxBytes;
+    bool enabled, scanned;
+    QHash<QByteArray, File> files;
+    quint64 useCounter;
+    Stats stats;
+};
+
+ProgramBinaryCache::ProgramBinaryCache()
+    : p_        (new Private())
+{
+}
+
+ProgramBinaryCache::~ProgramBinaryCache()
+{
+    delete p_;
+}
+
+QString ProgramBinaryCache::directory() const
+{
+    QMutexLocker lock(&p_->mutex);
+    return p_->directory;
+}
+
+qint64 ProgramBinaryCache::maxBytes() const
+{
+    QMutexLocker lock(&p_->mutex);
+    return p_->maxBytes;
+}
+
+bool ProgramBinaryCache::isEnabled() const
+{
+    QMutexLocker lock(&p_->mutex);
+    return p_->enabled;
+}
+
+ProgramBinaryCache::Stats ProgramBinaryCache::stats() const
+{
+    QMutexLocker lock(&p_->mutex);
+    return p_->stats;
+}
+
+void ProgramBinaryCache::setDirectory(const QString& dir)
+{
+    QMutexLocker lock(&p_->mutex);
+    p_->directory = dir.endsWith('/') ? dir : dir + '/';
+    p_->files.clear();
+    p_->stats.numFiles = 0;
+    p_->stats.bytes = 0;
+    p_->scanned = false;
+}
+
+void ProgramBinaryCache::setMaxBytes(qint64 bytes)
+{
+    QMutexLocker lock(&p_->mutex);
+    p_->maxBytes = bytes;
+    if (p_->scanned)
+        p_->evict();
+}
+
+void ProgramBinaryCache::setEnabled(bool enable)
+{
+    QMutexLocker lock(&p_->mutex);
+    p_->enabled = enable;
+}
+
+bool ProgramBinaryCache::isSupported(QOpenGLContext* ctx)
+{
+    Functions f;
+    return f.resolve(ctx);
+}
+
+QByteArray ProgramBinaryCache::key(
+        const QString& vertexSource, const QString& fragmentSource)
+{
+    QCryptographicHash h(QCryptographicHash::Md5);
+    if (auto ctx = QOpenGLContext::currentContext())
+    {
+        auto gl = ctx->functions();
+        h.addData(glString(gl, GL_VENDOR));
+        h.addData(glString(gl, GL_RENDERER));
+        h.addData(glString(gl, GL_VERSION));
+    }
+    h.addData(vertexSource.toUtf8());
+    h.addData(fragmentSource.toUtf8());
+    return h.result();
+}
+
+void ProgramBinaryCache::clear()
+{
+    ST_DEBUG2("ProgramBinaryCache::clear()");
+
+    QMutexLocker lock(&p_->mutex);
+    p_->scan();
+    for (const QByteArray& key : p_->files.keys())
+        p_->removeFile(key);
+}
+
+void ProgramBinaryCache::Private::scan()
+{
+    if (scanned)
+        return;
+    scanned = true;
+
+    QDir dir(directory);
+    const QFileInfoList list = dir.entryInfoList(
+                QStringList() << "*.bin", QDir::Files,
+                QDir::Time | QDir::Reversed);
+    for (const QFileInfo& inf : list)
+    {
+        const QByteArray key = QByteArray::fromHex(
+                    inf.completeBaseName().toLatin1());
+        if (!key.isEmpty())
+            insertFile(key, inf.size());
+    }
+    ST_DEBUG2("ProgramBinaryCache: " << files.size() << " binaries, "
+              << (stats.bytes >> 10) << " KiB in '" << directory << "'");
+}
+
+void ProgramBinaryCache::Private::insertFile(const QByteArray& key, qint64 size)
+{
+    auto i = files.find(key);
+    if (i != files.end())
+        stats.bytes -= i->size;
+    File& f = files[key];
+    f.size = size;
+    f.lastUse = ++useCounter;
+    stats.bytes += size;
+    stats.numFiles = files.size();
+}
+
+void ProgramBinaryCache::Private::removeFile(const QByteArray& key)
+{
+    auto i = files.find(key);
+    if (i != files.end())
+    {
+        stats.bytes -= i->size;
+        files.erase(i);
+        stats.numFiles = files.size();
+    }
+    QFile::remove(filename(key));
+}
+
+void ProgramBinaryCache::Private::evict()
+{
+    while (stats.bytes > maxBytes && !files.isEmpty())
+    {
+        auto oldest = files.begin();
+        for (auto i = files.begin(); i != files.end(); ++i)
+            if (i->lastUse < oldest->lastUse)
+                oldest = i;
+        ST_DEBUG3("ProgramBinaryCache: evicting " << oldest.key().toHex());
+        removeFile(oldest.key());
+        ++stats.numEvicted;
+    }
+}
+
+bool ProgramBinaryCache::Private::readFile(
+        const QString& fn, GLenum& format, QByteArray& data)
+{
+    QFile file(fn);
+    if (!file.open(QFile::ReadOnly))
+        return false;
+
+    QDataStream s(&file);
+    s.setVersion(QDataStream::Qt_5_0);
+
+    quint32 magic, version, fmt;
+    s >> magic >> version >> fmt >> data;
+    if (s.status() != QDataStream::Ok || magic != binaryMagic
+            || version != binaryVersion || data.isEmpty())
+        return false;
+    format = fmt;
+    return true;
+}
+
+bool ProgramBinaryCache::load(
+        QOpenGLShaderProgram* program, const QByteArray& key)
+{
+    if (!program->create())
+        return false;
+
+    Functions f;
+    if (!isEnabled() || !f.resolve(QOpenGLContext::currentContext()))
+        return false;
+
+    const GLuint id = program->programId();
+    // some drivers only keep the binary with this hint
+    if (f.programParameteri)
+        f.programParameteri(id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
+    GLenum format = 0;
+    QByteArray data;
+    QString fn;
+    {
+        QMutexLocker lock(&p_->mutex);
+        p_->scan();
+        if (!p_->files.contains(key))
+        {
+            ++p_->stats.numMisses;
+            return false;
+        }
+        fn = p_->filename(key);
+    }
+
+    bool ok = Private::readFile(fn, format, data);
+    if (ok)
+    {
+        f.programBinary(id, format, data.constData(), data.size());
+        GLint linked = 0;
+        QOpenGLContext::currentContext()->functions()->glGetProgramiv(
+                    id, GL_LINK_STATUS, &linked);
+        ok = linked != 0;
+    }
+
+    QMutexLocker lock(&p_->mutex);
+    if (!ok)
+    {
+        // a failed glProgramBinary() leaves the program empty
+        ST_DEBUG("ProgramBinaryCache: binary " << key.toHex()
+                 << " rejected, compiling from source");
+        ++p_->stats.numRejected;
+        ++p_->stats.numMisses;
+        p_->removeFile(key);
+        return false;
+    }
+    ++p_->stats.numHits;
+    p_->files[key].lastUse = ++p_->useCounter;
+    lock.unlock();
+
+    touchFile(fn);
+
+    // sees the linked program without shaders and only updates its state
+    return program->link();
+}
+
+bool ProgramBinaryCache::store(
+        QOpenGLShaderProgram* program, const QByteArray& key)
+{
+    Functions f;
+    if (!program->isLinked() || !isEnabled()
+            || !f.resolve(QOpenGLContext::currentContext()))
+        return false;
+
+    const GLuint id = program->programId();
+    GLint length = 0;
+    QOpenGLContext::currentContext()->functions()->glGetProgramiv(
+                id, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return false;
+
+    QByteArray data(length, 0);
+    GLsizei written = 0;
+    GLenum format = 0;
+    f.getProgramBinary(id, length, &written, &format, data.data());
+    if (written <= 0)
+        return false;
+    data.resize(written);
+
+    QMutexLocker lock(&p_->mutex);
+    p_->scan();
+
+    if (!QDir(".").mkpath(p_->directory))
+    {
+        ST_ERROR("Could not create program cache '" << p_->directory << "'");
+        return false;
+    }
+
+    QSaveFile file(p_->filename(key));
+    if (!file.open(QFile::WriteOnly))
+    {
+        ST_ERROR("Could not create program binary '" << file.fileName()
+                 << "', " << file.errorString());
+        return false;
+    }
+    QDataStream s(&file);
+    s.setVersion(QDataStream::Qt_5_0);
+    s << binaryMagic << binaryVersion << quint32(format) << data;
+    if (!file.commit())
+    {
+        ST_ERROR("Could not write program binary '" << file.fileName()
+                 << "', " << file.errorString());
+        return false;
+    }
+
+    p_->insertFile(key, QFileInfo(file.fileName()).size());
+    ++p_->stats.numStored;
+    p_->evict();
+    return true;
+}
@@ -0,0 +1,111 @@
+/***************************************************************************
+
+Copyright (C) 2016  stefan.berke @ modular-audio-graphics.com
+
+This source is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either
+version 3.0 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this software; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+****************************************************************************/
+
+#ifndef PROGRAMBINARYCACHE_H
+#define PROGRAMBINARYCACHE_H
+
+#include <QString>
+#include <QByteArray>
+
+class QOpenGLContext;
+class QOpenGLShaderProgram;
+
+/** On-disk cache of linked OpenGL program binaries.
+
+    Uses glGetProgramBinary() and glProgramBinary() of OpenGL 4.1,
+    OpenGL ES 3.0, GL_ARB_get_program_binary or
+    GL_OES_get_program_binary. Without support, or when the driver
+    offers no binary format, load() and store() do nothing and
+    the programs are compiled from source as before.
+
+    Each program is one file in directory(), named after key(),
+    which hashes both sources together with the vendor, renderer
+    and version strings of the driver. A driver update therefore
+    only leaves unused files behind, which are evicted once the
+    cache grows over maxBytes(), least recently used first.
+    A hit sets the modification time of the file, which orders
+    the files of the next run.
+    Binaries that the driver rejects are deleted.
+
+    <b>All methods are threadsafe</b>, load() and store() need
+    the context of the program to be current.
+*/
+class ProgramBinaryCache
+{
+public:
+    struct Stats
+    {
+        Stats() : numHits(0), numMisses(0), numRejected(0), numStored(0),
+                  numEvicted(0), numFiles(0), bytes(0) { }
+        int numHits, numMisses,
+        /** Binaries that did not load, usually after a driver change */
+            numRejected,
+            numStored, numEvicted, numFiles;
+        qint64 bytes;
+    };
+
+    ProgramBinaryCache();
+    ~ProgramBinaryCache();
+
+    // --- getter ---
+
+    QString directory() const;
+    qint64 maxBytes() const;
+    bool isEnabled() const;
+    Stats stats() const;
+
+    /** The driver of @p ctx supports program binaries */
+    static bool isSupported(QOpenGLContext* ctx);
+
+    /** Hash of the sources and the driver of the current context */
+    static QByteArray key(const QString& vertexSource,
+                          const QString& fragmentSource);
+
+    // --- setter ---
+
+    /** Default is "./program.cache/" */
+    void setDirectory(const QString& dir);
+    /** Default is 64 MiB */
+    void setMaxBytes(qint64 bytes);
+    void setEnabled(bool enable);
+
+    /** Deletes all cached binaries */
+    void clear();
+
+    // --- gl ---
+
+    /** Creates @p program and tries to load the binary of @p key.
+        Returns true if the program is linked and ready.
+        Otherwise the program is empty and prepared for
+        compiling, linking and store(). */
+    bool load(QOpenGLShaderProgram* program, const QByteArray& key);
+
+    /** Writes the binary of the linked @p program */
+    bool store(QOpenGLShaderProgram* program, const QByteArray& key);
+
+private:
+    ProgramBinaryCache(const ProgramBinaryCache&) = delete;
+    void operator=(const ProgramBinaryCache&) = delete;
+
+    struct Private;
+    Private* p_;
+};
+
+#endif // PROGRAMBINARYCACHE_H
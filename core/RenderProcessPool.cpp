@@ -0,0 +1,870 @@
+/***************************************************************************
+
+Copyright (C) 2016  stefan.berke @ modular-audio-graphics.com
+
+This source is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either
+version 3.0 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this software; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+****************************************************************************/
+
+#include <algorithm>
+
+#include <QImage>
+#include <QHash>
+#include <QDir>
+#include <QFileInfo>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QProcess>
+#include <QProcessEnvironment>
+#include <QCoreApplication>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QDataStream>
+#include <QtEndian>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLShader>
+#include <QScopedPointer>
+
+#include "RenderProcessPool.h"
+#include "ShadertoyApi.h"
+#include "ShadertoyShader.h"
+#include "ShadertoyOffscreenRenderer.h"
+#include "ShadertoyRenderer.h"
+#include "ShaderValidator.h"
+#include "log.h"
+
+namespace {
+
+    /** First value of each message */
+    enum MessageType
+    {
+        /** worker -> pool: qint32 index */
+        M_HELLO,
+        /** pool -> worker: quint32 sequence, QString id, QSize resolution.
+            The worker loads the shader from the cache itself. */
+        M_JOB,
+        /** worker -> pool: quint32 sequence, QString error, QSize size,
+            qint32 bytesPerLine, QByteArray RGBA pixels */
+        M_RESULT,
+        /** pool -> worker: quint32 sequence, QString id,
+            QByteArray stored hash, QString stored driver */
+        M_COMPILE,
+        /** worker -> pool: quint32 sequence, QString error, QString driver,
+            bool skipped, QByteArray hash, qint32 status, QString log,
+            float compileMs, float linkMs */
+        M_COMPILED
+    };
+
+    /** Sends @p data with a 32 bit size in front */
+    void writeMessage(QLocalSocket* socket, const QByteArray& data)
+    {
+        uchar head[4];
+        qToBigEndian<quint32>(quint32(data.size()), head);
+        socket->write(reinterpret_cast<const char*>(head), 4);
+        socket->write(data);
+    }
+
+    /** Takes one message from the socket buffer,
+        returns false if it is not completely received yet */
+    bool takeMessage(QLocalSocket* socket, QByteArray& data)
+    {
+        if (socket->bytesAvailable() < 4)
+            return false;
+        const QByteArray head = socket->peek(4);
+        const qint64 size = qFromBigEndian<quint32>(
+                    reinterpret_cast<const uchar*>(head.constData()));
+        if (socket->bytesAvailable() < 4 + size)
+            return false;
+        socket->read(4);
+        data = socket->read(size);
+        return true;
+    }
+
+    /** Returns false when the socket is disconnected */
+    bool waitForMessage(QLocalSocket* socket, QByteArray& data)
+    {
+        while (!takeMessage(socket, data))
+            if (!socket->waitForReadyRead(-1))
+                return false;
+        return true;
+    }
+
+    /** OpenGL context of a worker for compile jobs */
+    struct CompileContext
+    {
+        QScopedPointer<QOffscreenSurface> surface;
+        QScopedPointer<QOpenGLContext> context;
+        /** The vertex shader is the same for all passes */
+        QScopedPointer<QOpenGLShader> vert;
+        QString driver;
+
+        /** Creates the context on first use and makes it current.
+            Returns an error or an empty string. */
+        QString makeCurrent()
+        {
+            if (!context)
+            {
+                surface.reset(ShadertoyOffscreenRenderer::createSurface());
+                if (!surface)
+                    return QString("no offscreen surface");
+                context.reset(new QOpenGLContext);
+                context->setFormat(surface->format());
+                if (!context->create())
+                    return QString("context not created");
+            }
+            if (!context->makeCurrent(surface.data()))
+                return QString("context not current");
+            if (!vert)
+            {
+                driver = ShaderValidator::driverName();
+                vert.reset(new QOpenGLShader(QOpenGLShader::Vertex));
+                if (!vert->compileSourceCode(ShadertoyRenderer::vertexSource()))
+                    ST_ERROR("render worker: vertex shader failed:\n"
+                             << vert->log());
+            }
+            return vert->isCompiled() ? QString()
+                                      : QString("vertex shader failed");
+        }
+    };
+
+    /** Size of the pixel data */
+    qint64 imageBytes(const QImage& img)
+    {
+#if QT_VERSION >= QT_VERSION_CHECK(5, 10, 0)
+        return qint64(img.sizeInBytes());
+#else
+        return qint64(img.bytesPerLine()) * img.height();
+#endif
+    }
+
+} // namespace
+
+struct RenderProcessPool::Private
+{
+    Private(RenderProcessPool* p)
+        : p             (p)
+        , api           (ShadertoyApi::acquire())
+        , server        (nullptr)
+        , numWorkers    (std::max(1, QThread::idealThreadCount()))
+        , timeout       (20000)
+        , maxFailedStarts(3)
+        , nextIndex     (0)
+        , resolution    (256, 256)
+        , overwrite     (false)
+        , compileOnly   (false)
+        , paused        (false)
+        , running       (false)
+        , sequence      (0)
+        , generation    (0)
+    { }
+
+    struct Worker
+    {
+        int index;
+        QProcess* process;
+        /** NULL until the worker said hello */
+        QLocalSocket* socket;
+        QTimer* watchdog;
+        /** Shader in progress, empty when idle */
+        QString id;
+        quint32 sequence;
+        int generation;
+        /** Killed by the watchdog */
+        bool timedOut;
+        /** Asked to exit by stopWorkers() */
+        bool stopping;
+        /** Exits without finishing a shader, in a row */
+        int numFailedStarts;
+    };
+
+    bool listen();
+    void startWorkers();
+    void startWorker(Worker* w);
+    void stopWorkers();
+    void removeWorker(Worker* w);
+    Worker* workerBySocket(QLocalSocket* socket) const;
+    void onConnection();
+    void onMessage(QLocalSocket* socket, const QByteArray& msg);
+    /** Ends the job of @p w if @p seq is its current one,
+        returns the shader id or an empty string */
+    QString takeJob(Worker* w, quint32 seq);
+    void onResult(Worker* w, QDataStream& s);
+    void onCompiled(Worker* w, QDataStream& s);
+    void onTimeout(Worker* w);
+    void onExit(Worker* w);
+    /** Sends the next shader to an idle worker */
+    void dispatch(Worker* w);
+    /** Fails everything queued, when no worker can run */
+    void dropQueue(const QString& reason);
+    void checkFinished();
+    void updateTime() { stats.seconds = double(timer.nsecsElapsed()) / 1.e9; }
+
+    RenderProcessPool* p;
+    ShadertoyApi* api;
+    QLocalServer* server;
+    QList<Worker*> workers;
+    QStringList queue;
+    /** Stored hashes of the queued shaders in compile-only mode,
+        empty when overwritten */
+    QHash<QString, QByteArray> knownHashes;
+
+    int numWorkers, timeout, maxFailedStarts, nextIndex;
+    QSize resolution;
+    bool overwrite, compileOnly, paused;
+    /** A batch is in progress and finished() is still to be sent */
+    bool running;
+    quint32 sequence;
+    /** Increased by cancel(), drops the results in progress */
+    int generation;
+
+    Stats stats;
+    QElapsedTimer timer;
+};
+
+RenderProcessPool::RenderProcessPool(QObject* parent)
+    : QObject       (parent)
+    , p_            (new Private(this))
+{
+    ST_DEBUG_CTOR("RenderProcessPool()");
+}
+
+RenderProcessPool::~RenderProcessPool()
+{
+    ST_DEBUG_CTOR("~RenderProcessPool()");
+    p_->running = false;
+    for (Private::Worker* w : p_->workers)
+    {
+        if (w->process)
+        {
+            w->process->disconnect(this);
+            w->process->kill();
+            w->process->waitForFinished(1000);
+        }
+        delete w;
+    }
+    p_->api->release();
+    delete p_;
+}
+
+QString RenderProcessPool::workerArgument() { return "--render-worker"; }
+
+int RenderProcessPool::numWorkers() const { return p_->numWorkers; }
+int RenderProcessPool::timeout() const { return p_->timeout; }
+const QSize& RenderProcessPool::resolution() const { return p_->resolution; }
+bool RenderProcessPool::isOverwrite() const { return p_->overwrite; }
+bool RenderProcessPool::isCompileOnly() const { return p_->compileOnly; }
+bool RenderProcessPool::isPaused() const { return p_->paused; }
+bool RenderProcessPool::isIdle() const { return !p_->running; }
+int RenderProcessPool::numQueued() const { return p_->queue.size(); }
+const RenderProcessPool::Stats& RenderProcessPool::stats() const
+    { return p_->stats; }
+
+double RenderProcessPool::progress() const
+{
+    const Stats& s = p_->stats;
+    return s.numRequests ? 100. * s.numDone() / s.numRequests : 100.;
+}
+
+void RenderProcessPool::setNumWorkers(int num)
+{
+    p_->numWorkers = std::max(1, num);
+    if (p_->running)
+        p_->startWorkers();
+}
+
+void RenderProcessPool::setTimeout(int msec) { p_->timeout = msec; }
+void RenderProcessPool::setResolution(const QSize& res) { p_->resolution = res; }
+void RenderProcessPool::setOverwrite(bool enable) { p_->overwrite = enable; }
+void RenderProcessPool::setCompileOnly(bool enable) { p_->compileOnly = enable; }
+
+void RenderProcessPool::enqueue(const QStringList& ids)
+{
+    ST_DEBUG2("RenderProcessPool::enqueue(" << ids.size() << " ids)");
+
+    if (ids.isEmpty())
+        return;
+
+    if (!p_->running)
+    {
+        p_->stats = Stats();
+        p_->timer.start();
+        p_->running = true;
+    }
+    p_->stats.numRequests += ids.size();
+    p_->queue << ids;
+
+    // the force flag is taken now
+    if (p_->compileOnly)
+    {
+        const ShaderValidationResults& known = p_->api->validationResults();
+        for (const QString& id : ids)
+        {
+            if (p_->overwrite)
+                p_->knownHashes.remove(id);
+            else if (auto e = known.find(id))
+                p_->knownHashes.insert(id, e->hash);
+        }
+    }
+
+    p_->startWorkers();
+}
+
+void RenderProcessPool::pause()
+{
+    p_->paused = true;
+}
+
+void RenderProcessPool::resume()
+{
+    p_->paused = false;
+    for (Private::Worker* w : p_->workers)
+        p_->dispatch(w);
+    p_->checkFinished();
+}
+
+void RenderProcessPool::cancel()
+{
+    ST_DEBUG2("RenderProcessPool::cancel()");
+
+    ++p_->generation;
+    p_->queue.clear();
+    p_->knownHashes.clear();
+    p_->paused = false;
+    p_->checkFinished();
+}
+
+bool RenderProcessPool::Private::listen()
+{
+    if (server)
+        return server->isListening();
+
+    server = new QLocalServer(p);
+    connect(server, &QLocalServer::newConnection, p, [=](){ onConnection(); });
+
+    const QString name = QString("shadertoy-render-%1-%2")
+            .arg(QCoreApplication::applicationPid())
+            .arg(quintptr(p), 0, 16);
+    if (!server->listen(name))
+    {
+        ST_ERROR("RenderProcessPool: can't listen on '" << name << "': "
+                 << server->errorString());
+        return false;
+    }
+    return true;
+}
+
+void RenderProcessPool::Private::startWorkers()
+{
+    if (!listen())
+    {
+        dropQueue(QString("no local server"));
+        return;
+    }
+
+    while (workers.size() < numWorkers && workers.size() < queue.size())
+    {
+        auto w = new Worker;
+        w->index = nextIndex++;
+        w->process = nullptr;
+        w->socket = nullptr;
+        w->watchdog = new QTimer(p);
+        w->watchdog->setSingleShot(true);
+        connect(w->watchdog, &QTimer::timeout, p, [=](){ onTimeout(w); });
+        w->sequence = 0;
+        w->generation = 0;
+        w->timedOut = false;
+        w->stopping = false;
+        w->numFailedStarts = 0;
+        workers << w;
+        startWorker(w);
+    }
+
+    for (Worker* w : workers)
+        dispatch(w);
+    checkFinished();
+}
+
+void RenderProcessPool::Private::startWorker(Worker* w)
+{
+    ST_DEBUG2("RenderProcessPool: starting worker " << w->index);
+
+    auto env = QProcessEnvironment::systemEnvironment();
+    if (!env.contains("LP_NUM_THREADS"))
+        env.insert("LP_NUM_THREADS", "1");
+
+    w->process = new QProcess(p);
+    w->process->setProcessChannelMode(QProcess::ForwardedChannels);
+    w->process->setProcessEnvironment(env);
+    w->process->setWorkingDirectory(QDir::currentPath());
+
+    connect(w->process, static_cast<void(QProcess::*)(int, QProcess::ExitStatus)>(
+                &QProcess::finished), p, [=](){ onExit(w); });
+    connect(w->process, &QProcess::errorOccurred, p,
+            [=](QProcess::ProcessError e)
+    {
+        // all other errors are followed by finished()
+        if (e == QProcess::FailedToStart)
+            onExit(w);
+    });
+
+    w->process->start(QCoreApplication::applicationFilePath(), QStringList()
+                      << workerArgument()
+                      << server->fullServerName()
+                      << QString::number(w->index));
+
+    // the hello must arrive in time as well
+    w->timedOut = false;
+    w->stopping = false;
+    w->watchdog->start(timeout);
+}
+
+void RenderProcessPool::Private::stopWorkers()
+{
+    for (Worker* w : workers)
+    {
+        if (!w->id.isEmpty() || w->stopping)
+            continue;
+        w->stopping = true;
+        // the worker returns when the connection closes
+        if (w->socket)
+        {
+            w->socket->disconnectFromServer();
+            w->socket->deleteLater();
+            w->socket = nullptr;
+        }
+        else if (w->process)
+            w->process->kill();
+        w->watchdog->start(timeout);
+    }
+}
+
+void RenderProcessPool::Private::removeWorker(Worker* w)
+{
+    ST_DEBUG2("RenderProcessPool: removing worker " << w->index);
+    workers.removeOne(w);
+    w->watchdog->deleteLater();
+    delete w;
+}
+
+RenderProcessPool::Private::Worker*
+RenderProcessPool::Private::workerBySocket(QLocalSocket* socket) const
+{
+    for (Worker* w : workers)
+        if (w->socket == socket)
+            return w;
+    return nullptr;
+}
+
+void RenderProcessPool::Private::onConnection()
+{
+    while (QLocalSocket* socket = server->nextPendingConnection())
+    {
+        connect(socket, &QLocalSocket::readyRead, p, [=]()
+        {
+            QByteArray msg;
+            while (takeMessage(socket, msg))
+                onMessage(socket, msg);
+        });
+    }
+}
+
+void RenderProcessPool::Private::onMessage(
+        QLocalSocket* socket, const QByteArray& msg)
+{
+    QDataStream s(msg);
+    qint32 type;
+    s >> type;
+
+    if (type == M_HELLO)
+    {
+        qint32 index;
+        s >> index;
+        for (Worker* w : workers)
+            if (w->index == index && !w->socket && !w->stopping)
+            {
+                ST_DEBUG2("RenderProcessPool: worker " << index << " ready");
+                w->socket = socket;
+                w->watchdog->stop();
+                dispatch(w);
+                checkFinished();
+                return;
+            }
+        ST_WARN("RenderProcessPool: hello from unknown worker " << index);
+        socket->disconnectFromServer();
+    }
+    else if (type == M_RESULT)
+    {
+        if (Worker* w = workerBySocket(socket))
+            onResult(w, s);
+    }
+    else if (type == M_COMPILED)
+    {
+        if (Worker* w = workerBySocket(socket))
+            onCompiled(w, s);
+    }
+}
+
+QString RenderProcessPool::Private::takeJob(Worker* w, quint32 seq)
+{
+    if (w->id.isEmpty() || seq != w->sequence)
+        return QString();
+
+    w->watchdog->stop();
+    const QString id = w->id;
+    w->id.clear();
+    w->numFailedStarts = 0;
+    return id;
+}
+
+void RenderProcessPool::Private::onResult(Worker* w, QDataStream& s)
+{
+    quint32 seq;
+    QString error;
+    QSize size;
+    qint32 bytesPerLine;
+    QByteArray pixels;
+    s >> seq >> error >> size >> bytesPerLine >> pixels;
+
+    const QString id = takeJob(w, seq);
+    if (id.isEmpty())
+        return;
+
+    if (w->generation == generation)
+    {
+        if (error.isEmpty()
+            && pixels.size() < qint64(bytesPerLine) * size.height())
+            error = QString("incomplete image");
+
+        if (!error.isEmpty())
+        {
+            ++stats.numFailed;
+            ST_WARN("RenderProcessPool: '" << id << "' failed, " << error);
+            emit p->snapshotFailed(id, error);
+        }
+        else
+        {
+            const QImage img(reinterpret_cast<const uchar*>(pixels.constData()),
+                             size.width(), size.height(), bytesPerLine,
+                             QImage::Format_RGBA8888);
+            ++stats.numRendered;
+            api->storeSnapshot(id, img.copy());
+            emit p->snapshotReady(id);
+        }
+        updateTime();
+        emit p->progressChanged(p->progress());
+    }
+
+    dispatch(w);
+    checkFinished();
+}
+
+void RenderProcessPool::Private::onCompiled(Worker* w, QDataStream& s)
+{
+    quint32 seq;
+    QString error, driver;
+    bool skipped;
+    ShaderValidationResults::Entry e;
+    qint32 status;
+    s >> seq >> error >> driver >> skipped
+      >> e.hash >> status >> e.log >> e.compileMs >> e.linkMs;
+    e.status = ShaderValidationResults::Status(status);
+
+    e.id = takeJob(w, seq);
+    if (e.id.isEmpty())
+        return;
+
+    if (w->generation == generation)
+    {
+        if (!error.isEmpty())
+        {
+            ++stats.numFailed;
+            ST_WARN("RenderProcessPool: '" << e.id << "' failed, " << error);
+            emit p->snapshotFailed(e.id, error);
+        }
+        else if (skipped)
+            ++stats.numSkipped;
+        else
+        {
+            ++stats.numRendered;
+            emit p->shaderCompiled(e, driver);
+        }
+        updateTime();
+        emit p->progressChanged(p->progress());
+    }
+
+    dispatch(w);
+    checkFinished();
+}
+
+void RenderProcessPool::Private::onTimeout(Worker* w)
+{
+    if (!w->id.isEmpty())
+    {
+        ST_WARN("RenderProcessPool: worker " << w->index << " hangs on '"
+                << w->id << "'");
+        w->timedOut = true;
+    }
+    if (w->process)
+        w->process->kill();
+}
+
+void RenderProcessPool::Private::onExit(Worker* w)
+{
+    if (!w->process)
+        return;
+
+    ST_DEBUG2("RenderProcessPool: worker " << w->index << " exited, "
+              << w->process->exitCode());
+
+    w->watchdog->stop();
+
+    if (!w->id.isEmpty())
+    {
+        const QString reason = w->timedOut ? QString("timeout")
+                                           : QString("crash");
+        if (w->generation == generation)
+        {
+            if (w->timedOut)
+                ++stats.numTimeouts;
+            else
+                ++stats.numCrashes;
+            ++stats.numFailed;
+            updateTime();
+            emit p->snapshotFailed(w->id, reason);
+            emit p->progressChanged(p->progress());
+        }
+        api->blockRender(w->id, reason);
+        emit p->shaderBlocked(w->id, reason);
+        w->id.clear();
+        w->numFailedStarts = 0;
+    }
+    else if (running && !w->stopping)
+        ++w->numFailedStarts;
+
+    if (w->socket)
+        w->socket->deleteLater();
+    w->socket = nullptr;
+    w->process->deleteLater();
+    w->process = nullptr;
+
+    if (running && !queue.isEmpty() && w->numFailedStarts < maxFailedStarts)
+        startWorker(w);
+    else
+    {
+        if (w->numFailedStarts >= maxFailedStarts)
+            ST_ERROR("RenderProcessPool: worker " << w->index
+                     << " does not start");
+        removeWorker(w);
+    }
+
+    if (running && workers.isEmpty() && !queue.isEmpty())
+        dropQueue(QString("no worker process"));
+
+    checkFinished();
+}
+
+void RenderProcessPool::Private::dispatch(Worker* w)
+{
+    if (!w->socket || !w->id.isEmpty())
+        return;
+
+    const int numSkipped = stats.numSkipped;
+    while (!paused && !queue.isEmpty())
+    {
+        const QString id = queue.takeFirst();
+        const QByteArray knownHash = knownHashes.take(id);
+
+        if (api->isRenderBlocked(id)
+            || (!compileOnly && !overwrite
+                && QFileInfo(api->snapshotFilename(id)).exists()))
+        {
+            ++stats.numSkipped;
+            continue;
+        }
+
+        w->id = id;
+        w->sequence = ++sequence;
+        w->generation = generation;
+        w->timedOut = false;
+
+        QByteArray msg;
+        QDataStream s(&msg, QIODevice::WriteOnly);
+        if (compileOnly)
+            s << qint32(M_COMPILE) << w->sequence << id << knownHash
+              << api->validationResults().driver();
+        else
+            s << qint32(M_JOB) << w->sequence << id << resolution;
+        writeMessage(w->socket, msg);
+
+        w->watchdog->start(timeout);
+        break;
+    }
+
+    if (stats.numSkipped != numSkipped)
+    {
+        updateTime();
+        emit p->progressChanged(p->progress());
+    }
+}
+
+void RenderProcessPool::Private::dropQueue(const QString& reason)
+{
+    if (queue.isEmpty())
+        return;
+    ST_ERROR("RenderProcessPool: dropping " << queue.size() << " shaders, "
+             << reason);
+    stats.numFailed += queue.size();
+    queue.clear();
+    knownHashes.clear();
+    checkFinished();
+}
+
+void RenderProcessPool::Private::checkFinished()
+{
+    if (!running || !queue.isEmpty())
+        return;
+    for (const Worker* w : workers)
+        if (!w->id.isEmpty())
+            return;
+
+    running = false;
+    updateTime();
+    ST_DEBUG2("RenderProcessPool: " << stats.numRendered << " rendered, "
+              << stats.numSkipped << " skipped, "
+              << stats.numFailed << " failed, "
+              << stats.numCrashes << " crashes, "
+              << stats.numTimeouts << " timeouts in "
+              << stats.seconds << " sec");
+    emit p->finished();
+    stopWorkers();
+}
+
+int RenderProcessPool::runWorker(const QStringList& arguments)
+{
+    const int arg = arguments.indexOf(workerArgument());
+    if (arg < 0 || arg + 2 >= arguments.size())
+    {
+        ST_ERROR("render worker: expected server name and index");
+        return 2;
+    }
+
+    QLocalSocket socket;
+    socket.connectToServer(arguments[arg + 1]);
+    if (!socket.waitForConnected(5000))
+    {
+        ST_ERROR("render worker: can't connect to '" << arguments[arg + 1]
+                 << "': " << socket.errorString());
+        return 1;
+    }
+
+    QByteArray msg;
+    {
+        QDataStream s(&msg, QIODevice::WriteOnly);
+        s << qint32(M_HELLO) << qint32(arguments[arg + 2].toInt());
+    }
+    writeMessage(&socket, msg);
+    socket.flush();
+
+    // opens the catalog for loadShaderBody()
+    auto api = ShadertoyApi::acquire();
+    api->loadShaderList();
+    {
+        ShadertoyOffscreenRenderer renderer;
+        CompileContext compiler;
+
+        while (waitForMessage(&socket, msg))
+        {
+            QDataStream s(msg);
+            qint32 type;
+            quint32 seq;
+            QString id;
+            s >> type;
+
+            QByteArray reply;
+            QDataStream r(&reply, QIODevice::WriteOnly);
+
+            if (type == M_JOB)
+            {
+                QSize res;
+                s >> seq >> id >> res;
+
+                QImage img;
+                QString error;
+                const ShadertoyShader shader = api->loadShaderBody(id);
+                if (!shader.isValid())
+                    error = QString("shader not loaded");
+                else
+                {
+                    renderer.setShader(shader);
+                    img = renderer.renderToImage(res);
+                    if (img.isNull())
+                        error = QString("render failed");
+                    else if (!api->saveSnapshot(id, img))
+                        error = QString("png not saved");
+                }
+                if (!error.isEmpty())
+                    img = QImage();
+                else
+                    img = img.convertToFormat(QImage::Format_RGBA8888);
+
+                r << qint32(M_RESULT) << seq << error << img.size()
+                  << qint32(img.bytesPerLine())
+                  << QByteArray(reinterpret_cast<const char*>(img.constBits()),
+                                int(imageBytes(img)));
+            }
+            else if (type == M_COMPILE)
+            {
+                QByteArray knownHash;
+                QString knownDriver;
+                s >> seq >> id >> knownHash >> knownDriver;
+
+                ShaderValidationResults::Entry e;
+                bool skipped = false;
+                const QString error = compiler.makeCurrent();
+                if (error.isEmpty())
+                {
+                    const ShadertoyShader shader = api->loadShaderBody(id);
+                    if (!shader.isValid())
+                        e.status = ShaderValidationResults::S_NOT_LOADED;
+                    else
+                    {
+                        e.hash = ShaderValidationResults::hash(shader);
+                        skipped = e.hash == knownHash
+                               && compiler.driver == knownDriver;
+                        if (!skipped)
+                            ShaderValidator::compileShader(
+                                        *compiler.vert, shader, e);
+                    }
+                    compiler.context->doneCurrent();
+                }
+
+                r << qint32(M_COMPILED) << seq << error << compiler.driver
+                  << skipped << e.hash << qint32(e.status) << e.log
+                  << e.compileMs << e.linkMs;
+            }
+            else
+                continue;
+
+            writeMessage(&socket, reply);
+            while (socket.bytesToWrite() && socket.waitForBytesWritten(-1))
+                ;
+        }
+    }
+    api->release();
+
+    return 0;
+}
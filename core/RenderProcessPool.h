@@ -0,0 +1,147 @@
+/***************************************************************************
+
+Copyright (C) 2016  stefan.berke @ modular-audio-graphics.com
+
+This source is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either
+version 3.0 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this software; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+****************************************************************************/
+
+#ifndef RENDERPROCESSPOOL_H
+#define RENDERPROCESSPOOL_H
+
+#include <QObject>
+#include <QSize>
+#include <QStringList>
+
+#include "ShaderValidationResults.h"
+
+/** Renders snapshots in child processes.
+
+    Some shaders crash the driver inside QOpenGLShaderProgram::link()
+    or hang in the first glClear(). The pool starts this executable
+    with workerArgument() a few times, and each child renders the shader
+    ids it receives over a local socket with its own offscreen renderer.
+    The child loads the shader from the cache, writes the png and sends
+    the image back, and the pool adds it to the thumbnail store.
+
+    A worker that crashes or does not answer within timeout() is killed
+    and restarted. Its shader is added to the render blocklist, see
+    ShadertoyApi::blockRender(), and later batches skip it. A worker
+    that fails again right after its start is dropped.
+
+    In compile-only mode the workers only compile and link the shaders,
+    see ShaderValidator, and send the results with shaderCompiled().
+    Shaders whose sources and driver did not change since the stored
+    ShadertoyApi::validationResults() are skipped.
+
+    Queue, pause, resume and cancel work like in SnapshotJob.
+    The children get LP_NUM_THREADS=1 unless the variable is set, so
+    Mesa's llvmpipe does not start its rasterizer threads in each
+    process.
+*/
+class RenderProcessPool : public QObject
+{
+    Q_OBJECT
+public:
+    struct Stats
+    {
+        Stats() : numRequests(0), numRendered(0), numSkipped(0),
+                  numFailed(0), numCrashes(0), numTimeouts(0), seconds(0.) { }
+        /** numRendered counts the compiled shaders in compile-only mode */
+        int numRequests, numRendered, numSkipped, numFailed,
+            numCrashes, numTimeouts;
+        double seconds;
+        int numDone() const { return numRendered + numSkipped + numFailed; }
+        double imagesPerSecond() const
+            { return seconds > 0. ? numRendered / seconds : 0.; }
+    };
+
+    explicit RenderProcessPool(QObject* parent = nullptr);
+    /** Kills all workers */
+    ~RenderProcessPool();
+
+    /** The command line switch that starts a worker */
+    static QString workerArgument();
+
+    /** Main loop of a worker process, called from main() when the
+        arguments contain workerArgument(). Needs a QGuiApplication.
+        Returns the exit code. */
+    static int runWorker(const QStringList& arguments);
+
+    // --- getter ---
+
+    /** Default is QThread::idealThreadCount() */
+    int numWorkers() const;
+    /** Maximum time for one shader in milliseconds, default 20000 */
+    int timeout() const;
+    /** Default is 256x256 */
+    const QSize& resolution() const;
+    bool isOverwrite() const;
+    bool isCompileOnly() const;
+    bool isPaused() const;
+    bool isIdle() const;
+    int numQueued() const;
+    /** Statistics of the current or last batch */
+    const Stats& stats() const;
+    /** Percent of the current batch that is done */
+    double progress() const;
+
+    // --- setter ---
+
+    /** Applies to workers started afterwards */
+    void setNumWorkers(int num);
+    void setTimeout(int msec);
+    void setResolution(const QSize& res);
+    /** Render shaders that already have a snapshot png.
+        In compile-only mode, compile shaders with unchanged sources
+        again, this applies to the ids enqueued afterwards. */
+    void setOverwrite(bool enable);
+    /** Compile and link instead of rendering, set before enqueue() */
+    void setCompileOnly(bool enable);
+
+public slots:
+
+    /** Appends @p ids to the queue and starts the workers */
+    void enqueue(const QStringList& ids);
+
+    /** Workers finish their current shader and wait */
+    void pause();
+    void resume();
+    /** Drops the queue and all results still in progress */
+    void cancel();
+
+signals:
+
+    /** A snapshot of @p id has been rendered and saved */
+    void snapshotReady(const QString& id);
+    /** Rendering or compiling @p id failed in the worker */
+    void snapshotFailed(const QString& id, const QString& error);
+    /** Compile result of @p e.id in compile-only mode,
+        @p driver is the OpenGL driver of the worker */
+    void shaderCompiled(const ShaderValidationResults::Entry& e,
+                        const QString& driver);
+    /** @p id crashed or hung a worker and is on the blocklist now */
+    void shaderBlocked(const QString& id, const QString& reason);
+    void progressChanged(double percent);
+    /** All queued shaders are done or the job was cancelled.
+        The workers exit afterwards. */
+    void finished();
+
+private:
+    struct Private;
+    Private* p_;
+};
+
+#endif // RENDERPROCESSPOOL_H
@@ -0,0 +1,200 @@
+/***************************************************************************
+
+Copyright (C) 2016  stefan.berke @ modular-audio-graphics.com
+
+This source is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either
+version 3.0 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this software; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+****************************************************************************/
+
+#include <QFile>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QCryptographicHash>
+
+#include "ShaderCacheManifest.h"
+#include "log.h"
+
+namespace {
+
+    const quint32 manifestMagic = 0x53544d46; // "STMF"
+
+    void writeInfo(QDataStream& s, const ShadertoyShaderInfo& i)
+    {
+        s << qint32(i.views) << qint32(i.likes) << qint32(i.published)
+          << qint32(i.hasliked) << qint32(i.flags)
+          << i.id << i.name << i.username << i.description
+          << i.date << i.tags
+          << quint64(i.numChars) << qint32(i.numPasses)
+          << i.usesTextures << i.usesBuffers << i.usesMusic << i.usesVideo
+          << i.usesCamera << i.usesMicrophone << i.usesKeyboard
+          << i.usesMouse << i.hasSound;
+    }
+
+    void readInfo(QDataStream& s, ShadertoyShaderInfo& i)
+    {
+        qint32 views, likes, published, hasliked, flags, numPasses;
+        quint64 numChars;
+        s >> views >> likes >> published >> hasliked >> flags
+          >> i.id >> i.name >> i.username >> i.description
+          >> i.date >> i.tags
+          >> numChars >> numPasses
+          >> i.usesTextures >> i.usesBuffers >> i.usesMusic >> i.usesVideo
+          >> i.usesCamera >> i.usesMicrophone >> i.usesKeyboard
+          >> i.usesMouse >> i.hasSound;
+        i.views = views;
+        i.likes = likes;
+        i.published = published;
+        i.hasliked = hasliked;
+        i.flags = flags;
+        i.numChars = numChars;
+        i.numPasses = numPasses;
+    }
+
+} // namespace
+
+const quint32 ShaderCacheManifest::schemaVersion = 1;
+
+ShaderCacheManifest::ShaderCacheManifest()
+    : p_modified_   (false)
+{
+}
+
+const ShaderCacheManifest::Entry* ShaderCacheManifest::find(
+        const QString& id) const
+{
+    auto i = p_entries_.constFind(id);
+    return i == p_entries_.constEnd() ? nullptr : &i.value();
+}
+
+QByteArray ShaderCacheManifest::hash(const QByteArray& data)
+{
+    return QCryptographicHash::hash(data, QCryptographicHash::Md5);
+}
+
+void ShaderCacheManifest::clear()
+{
+    if (!p_entries_.isEmpty())
+        p_modified_ = true;
+    p_entries_.clear();
+}
+
+void ShaderCacheManifest::insert(const QString& id, const Entry& e)
+{
+    p_entries_.insert(id, e);
+    p_modified_ = true;
+}
+
+void ShaderCacheManifest::retain(const QSet<QString>& ids)
+{
+    for (auto i = p_entries_.begin(); i != p_entries_.end(); )
+    {
+        if (ids.contains(i.key()))
+            ++i;
+        else
+        {
+            i = p_entries_.erase(i);
+            p_modified_ = true;
+        }
+    }
+}
+
+bool ShaderCacheManifest::load(const QString& filename)
+{
+    ST_DEBUG2("ShaderCacheManifest::load('" << filename << "')");
+
+    p_entries_.clear();
+    // anything that fails below requires a rebuild
+    p_modified_ = true;
+
+    QFile file(filename);
+    if (!file.open(QFile::ReadOnly))
+    {
+        ST_DEBUG("No shader cache manifest '" << filename << "'");
+        return false;
+    }
+
+    QDataStream s(&file);
+    s.setVersion(QDataStream::Qt_5_0);
+
+    quint32 magic, version;
+    qint32 count;
+    s >> magic >> version >> count;
+    if (s.status() != QDataStream::Ok || magic != manifestMagic || count < 0)
+    {
+        ST_WARN("Shader cache manifest '" << filename << "' is corrupt, "
+                "rebuilding");
+        return false;
+    }
+    if (version != schemaVersion)
+    {
+        ST_INFO("Shader cache manifest '" << filename << "' has schema "
+                << version << ", rebuilding for schema " << schemaVersion);
+        return false;
+    }
+
+    // no reserve(), count is not trusted and the loop
+    // stops at the end of a truncated file
+    for (qint32 k=0; k<count && s.status() == QDataStream::Ok; ++k)
+    {
+        Entry e;
+        s >> e.size >> e.mtime >> e.hash;
+        readInfo(s, e.info);
+        p_entries_.insert(e.info.id, e);
+    }
+
+    if (s.status() != QDataStream::Ok || p_entries_.size() != count)
+    {
+        ST_WARN("Shader cache manifest '" << filename << "' is corrupt, "
+                "rebuilding");
+        p_entries_.clear();
+        return false;
+    }
+
+    p_modified_ = false;
+    return true;
+}
+
+bool ShaderCacheManifest::save(const QString& filename)
+{
+    ST_DEBUG2("ShaderCacheManifest::save('" << filename << "')");
+
+    QSaveFile file(filename);
+    if (!file.open(QFile::WriteOnly))
+    {
+        ST_ERROR("Could not create shader cache manifest '" << filename
+                 << "', " << file.errorString());
+        return false;
+    }
+
+    QDataStream s(&file);
+    s.setVersion(QDataStream::Qt_5_0);
+
+    s << manifestMagic << schemaVersion << qint32(p_entries_.size());
+    for (const Entry& e : p_entries_)
+    {
+        s << e.size << e.mtime << e.hash;
+        writeInfo(s, e.info);
+    }
+
+    if (!file.commit())
+    {
+        ST_ERROR("Could not write shader cache manifest '" << filename
+                 << "', " << file.errorString());
+        return false;
+    }
+
+    p_modified_ = false;
+    return true;
+}
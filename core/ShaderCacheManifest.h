@@ -0,0 +1,88 @@
+/***************************************************************************
+
+Copyright (C) 2016  stefan.berke @ modular-audio-graphics.com
+
+This source is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either
+version 3.0 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this software; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+****************************************************************************/
+
+#ifndef SHADERCACHEMANIFEST_H
+#define SHADERCACHEMANIFEST_H
+
+#include <QHash>
+#include <QSet>
+#include <QByteArray>
+
+#include "ShadertoyShader.h"
+
+/** Persistent record of the json shader cache.
+
+    For each shader id it stores the size, modification time and
+    content hash of the json file, together with the extracted
+    ShadertoyShaderInfo, so unchanged files do not need to be parsed.
+
+    All const methods are threadsafe as long as no non-const
+    method is called concurrently.
+*/
+class ShaderCacheManifest
+{
+public:
+    struct Entry
+    {
+        Entry() : size(0), mtime(0) { }
+        qint64 size;
+        /** Modification time in msecs since epoch */
+        qint64 mtime;
+        QByteArray hash;
+        ShadertoyShaderInfo info;
+    };
+
+    /** Increase whenever the file layout or ShadertoyShaderInfo changes */
+    static const quint32 schemaVersion;
+
+    ShaderCacheManifest();
+
+    int size() const { return p_entries_.size(); }
+    /** There are changes that are not saved */
+    bool isModified() const { return p_modified_; }
+
+    /** Returns the entry for the shader id, or NULL */
+    const Entry* find(const QString& id) const;
+
+    /** Calculates the hash of the json file content */
+    static QByteArray hash(const QByteArray& data);
+
+    // --- setter ---
+
+    void clear();
+    void insert(const QString& id, const Entry& e);
+    /** Removes all entries whose id is not in @p ids */
+    void retain(const QSet<QString>& ids);
+
+    // --- io ---
+
+    /** Reads the manifest.
+        Returns false, and leaves the manifest empty and modified,
+        when the file is missing, corrupt or has a different schema. */
+    bool load(const QString& filename);
+    /** Writes the manifest and clears the modified flag */
+    bool save(const QString& filename);
+
+private:
+    QHash<QString, Entry> p_entries_;
+    bool p_modified_;
+};
+
+#endif // SHADERCACHEMANIFEST_H
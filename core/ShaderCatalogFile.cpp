@@ -0,0 +1,319 @@
+/***************************************************************************
+
+Copyright (C) 2016  stefan.berke @ modular-audio-graphics.com
+
+This source is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either
+version 3.0 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this software; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+****************************************************************************/
+
+#include <cstring>
+#include <algorithm>
+#include <limits>
+
+#include <QFile>
+#include <QSaveFile>
+#include <QJsonDocument>
+#include <QJsonParseError>
+#include <QByteArray>
+#include <QVector>
+
+#include "ShaderCatalogFile.h"
+#include "log.h"
+
+namespace {
+
+    const char catalogMagic[8] = { 'S','T','C','A','T','L','G','\0' };
+    const quint32 byteOrderMark = 0x01020304;
+
+    struct Header
+    {
+        char magic[8];
+        quint32 byteOrder, version, count, reserved;
+        quint64 indexOffset;
+    };
+
+    struct IndexEntry
+    {
+        char id[16];
+        quint64 offset;
+        quint32 size, reserved;
+    };
+
+    static_assert(sizeof(Header) == 32, "unexpected padding in Header");
+    static_assert(sizeof(IndexEntry) == 32, "unexpected padding in IndexEntry");
+
+    /** Size of a record including length field and padding */
+    quint64 recordSize(quint32 dataSize)
+    {
+        return (8 + quint64(dataSize) + 7) & ~quint64(7);
+    }
+
+    QByteArray encodeRecord(const QJsonObject& o)
+    {
+        return QJsonDocument(o).toJson(QJsonDocument::Compact);
+    }
+
+    /** Zero-padded latin1 id, truncated to 16 chars */
+    void copyId(char* dst, const QString& id)
+    {
+        std::memset(dst, 0, 16);
+        auto l1 = id.toLatin1();
+        std::memcpy(dst, l1.constData(), std::min(l1.size(), 16));
+    }
+
+} // namespace
+
+const int ShaderCatalogFile::version = 3;
+
+ShaderCatalogFile::ShaderCatalogFile()
+    : p_file_       (nullptr)
+    , p_data_       (nullptr)
+    , p_index_      (nullptr)
+    , p_size_       (0)
+    , p_count_      (0)
+{
+    ST_DEBUG_CTOR("ShaderCatalogFile()");
+}
+
+ShaderCatalogFile::~ShaderCatalogFile()
+{
+    ST_DEBUG_CTOR("~ShaderCatalogFile()");
+    close();
+}
+
+void ShaderCatalogFile::close()
+{
+    if (p_file_)
+    {
+        if (p_data_)
+            p_file_->unmap(const_cast<uchar*>(p_data_));
+        delete p_file_;
+    }
+    p_file_ = nullptr;
+    p_data_ = nullptr;
+    p_index_ = nullptr;
+    p_size_ = 0;
+    p_count_ = 0;
+    p_filename_.clear();
+}
+
+bool ShaderCatalogFile::open(const QString& filename)
+{
+    ST_DEBUG2("ShaderCatalogFile::open('" << filename << "')");
+
+    close();
+
+    p_file_ = new QFile(filename);
+    if (!p_file_->open(QFile::ReadOnly))
+    {
+        ST_ERROR("Could not open catalog file '" << filename << "', "
+                 << p_file_->errorString());
+        close();
+        return false;
+    }
+
+    p_size_ = p_file_->size();
+    if (p_size_ < qint64(sizeof(Header)))
+    {
+        ST_ERROR("Catalog file '" << filename << "' is truncated");
+        close();
+        return false;
+    }
+
+    p_data_ = p_file_->map(0, p_size_);
+    if (!p_data_)
+    {
+        ST_ERROR("Could not map catalog file '" << filename << "', "
+                 << p_file_->errorString());
+        close();
+        return false;
+    }
+
+    auto header = reinterpret_cast<const Header*>(p_data_);
+    if (std::memcmp(header->magic, catalogMagic, 8) != 0
+        || header->byteOrder != byteOrderMark)
+    {
+        ST_ERROR("'" << filename << "' is not a catalog file "
+                 "or has a different byte order");
+        close();
+        return false;
+    }
+    if (header->version != quint32(version))
+    {
+        ST_ERROR("Catalog file '" << filename << "' has unsupported version "
+                 << header->version);
+        close();
+        return false;
+    }
+    // written without overflow, the header is not trusted
+    const quint64 size = quint64(p_size_);
+    if (header->indexOffset < sizeof(Header)
+        || header->indexOffset > size
+        || (header->indexOffset & 7) != 0
+        || quint64(header->count)
+            > (size - header->indexOffset) / sizeof(IndexEntry)
+        || header->count > quint32(std::numeric_limits<int>::max()))
+    {
+        ST_ERROR("Catalog file '" << filename << "' has a corrupt index");
+        close();
+        return false;
+    }
+
+    p_index_ = p_data_ + header->indexOffset;
+    p_count_ = header->count;
+    p_filename_ = filename;
+
+    ST_DEBUG2("ShaderCatalogFile: mapped " << p_count_ << " shaders");
+    return true;
+}
+
+QString ShaderCatalogFile::id(int index) const
+{
+    if (index < 0 || index >= p_count_)
+        return QString();
+    auto e = reinterpret_cast<const IndexEntry*>(p_index_) + index;
+    return QString::fromLatin1(e->id, int(qstrnlen(e->id, 16)));
+}
+
+QStringList ShaderCatalogFile::ids() const
+{
+    QStringList list;
+    list.reserve(p_count_);
+    for (int i=0; i<p_count_; ++i)
+        list << id(i);
+    return list;
+}
+
+int ShaderCatalogFile::indexOf(const QString& sid) const
+{
+    char key[16];
+    copyId(key, sid);
+
+    auto index = reinterpret_cast<const IndexEntry*>(p_index_);
+    int lo = 0, hi = p_count_ - 1;
+    while (lo <= hi)
+    {
+        int mid = (lo + hi) / 2;
+        int cmp = std::memcmp(index[mid].id, key, 16);
+        if (cmp == 0)
+            return mid;
+        if (cmp < 0)
+            lo = mid + 1;
+        else
+            hi = mid - 1;
+    }
+    return -1;
+}
+
+QJsonObject ShaderCatalogFile::jsonData(int index) const
+{
+    if (index < 0 || index >= p_count_)
+        return QJsonObject();
+
+    auto e = reinterpret_cast<const IndexEntry*>(p_index_) + index;
+    const quint64 size = quint64(p_size_);
+    if (e->offset < sizeof(Header)
+        || e->offset > size
+        || (e->offset & 7) != 0
+        || recordSize(e->size) > size - e->offset
+        || *reinterpret_cast<const quint32*>(p_data_ + e->offset) != e->size)
+    {
+        ST_ERROR("Corrupt record " << index << " in catalog file '"
+                 << p_filename_ << "'");
+        return QJsonObject();
+    }
+
+    // parsed in place, the raw data is not copied
+    const QByteArray data = QByteArray::fromRawData(
+                reinterpret_cast<const char*>(p_data_ + e->offset + 8),
+                int(e->size));
+    QJsonParseError error;
+    const QJsonDocument doc = QJsonDocument::fromJson(data, &error);
+    if (error.error != QJsonParseError::NoError || !doc.isObject())
+    {
+        ST_ERROR("Could not parse record " << index << " in catalog file '"
+                 << p_filename_ << "', " << error.errorString());
+        return QJsonObject();
+    }
+    return doc.object();
+}
+
+bool ShaderCatalogFile::write(
+        const QString& filename, const QMap<QString, QJsonObject>& shaders)
+{
+    ST_DEBUG2("ShaderCatalogFile::write('" << filename << "', "
+              << shaders.size() << " shaders)");
+
+    // encode all records first to know the offsets
+    QVector<QByteArray> records;
+    records.reserve(shaders.size());
+    for (const QJsonObject& o : shaders)
+        records << encodeRecord(o);
+
+    Header header;
+    std::memcpy(header.magic, catalogMagic, 8);
+    header.byteOrder = byteOrderMark;
+    header.version = version;
+    header.count = shaders.size();
+    header.reserved = 0;
+    header.indexOffset = sizeof(Header);
+
+    QVector<IndexEntry> index;
+    index.reserve(shaders.size());
+    quint64 offset = header.indexOffset
+                   + quint64(shaders.size()) * sizeof(IndexEntry);
+    int i = 0;
+    for (auto it = shaders.begin(); it != shaders.end(); ++it, ++i)
+    {
+        IndexEntry e;
+        copyId(e.id, it.key());
+        e.offset = offset;
+        e.size = records[i].size();
+        e.reserved = 0;
+        index << e;
+        offset += recordSize(e.size);
+    }
+
+    QSaveFile file(filename);
+    if (!file.open(QFile::WriteOnly))
+    {
+        ST_ERROR("Could not create catalog file '" << filename << "', "
+                 << file.errorString());
+        return false;
+    }
+
+    const char padding[8] = { 0 };
+    file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+    file.write(reinterpret_cast<const char*>(index.constData()),
+               index.size() * sizeof(IndexEntry));
+    for (int k=0; k<records.size(); ++k)
+    {
+        const quint32 len[2] = { index[k].size, 0 };
+        file.write(reinterpret_cast<const char*>(len), 8);
+        file.write(records[k]);
+        file.write(padding, recordSize(index[k].size) - 8 - index[k].size);
+    }
+
+    if (!file.commit())
+    {
+        ST_ERROR("Could not write catalog file '" << filename << "', "
+                 << file.errorString());
+        return false;
+    }
+
+    ST_INFO("ShaderCatalogFile: wrote " << shaders.size() << " shaders to '"
+            << filename << "' (" << offset << " bytes)");
+    return true;
+}
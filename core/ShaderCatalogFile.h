@@ -0,0 +1,99 @@
+/***************************************************************************
+
+Copyright (C) 2016  stefan.berke @ modular-audio-graphics.com
+
+This source is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either
+version 3.0 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this software; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+****************************************************************************/
+
+#ifndef SHADERCATALOGFILE_H
+#define SHADERCATALOGFILE_H
+
+#include <QString>
+#include <QStringList>
+#include <QJsonObject>
+#include <QMap>
+
+class QFile;
+
+/** Read-only, memory-mapped file containing many shaders.
+
+    Layout (host byte order, all offsets from file start):
+    @code
+    header      char magic[8] "STCATLG", u32 byteOrderMark, u32 version,
+                u32 count, u32 reserved, u64 indexOffset
+    index       count * { char id[16], u64 recordOffset,
+                          u32 size, u32 reserved }, sorted by id
+    records     { u32 size, u32 reserved, data[size] },
+                each padded to 8 bytes
+    @endcode
+
+    The record data is the compact json text of the shader object.
+    jsonData() parses it straight from the mapping, no returned
+    object refers to the mapped file.
+
+    All offsets are checked against the file size, open() fails
+    for a corrupt header or index.
+*/
+class ShaderCatalogFile
+{
+public:
+    ShaderCatalogFile();
+    ~ShaderCatalogFile();
+
+    // ---- reading ----
+
+    /** Opens and maps the file, previous file is closed.
+        Returns false on any error or if the format is not supported. */
+    bool open(const QString& filename);
+    /** Unmaps the file. */
+    void close();
+
+    bool isOpen() const { return p_data_ != nullptr; }
+    const QString& filename() const { return p_filename_; }
+
+    /** Number of shaders in file */
+    int count() const { return p_count_; }
+    /** The shader id at index */
+    QString id(int index) const;
+    /** All shader ids in index order */
+    QStringList ids() const;
+    /** Binary-searches the index, returns -1 if not found */
+    int indexOf(const QString& id) const;
+
+    /** The json data of the shader at index, or an empty object on error.
+        <b>Threadsafe</b> */
+    QJsonObject jsonData(int index) const;
+
+    // ---- writing ----
+
+    /** Writes all shader json objects (by id) to a new catalog file.
+        The file is replaced atomically through QSaveFile. A
+        ShaderCatalogFile that has the old file open keeps reading
+        the old content, it needs to be opened again. */
+    static bool write(const QString& filename,
+                      const QMap<QString, QJsonObject>& shaders);
+
+    static const int version;
+
+private:
+    QString p_filename_;
+    QFile* p_file_;
+    const uchar* p_data_, *p_index_;
+    qint64 p_size_;
+    int p_count_;
+};
+
+#endif // SHADERCATALOGFILE_H
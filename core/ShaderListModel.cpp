@@ -8,32 +8,110 @@
     <p>created 5/31/2016</p>
 */
 
+#include <algorithm>
+
 #include <QList>
 #include <QColor>
 #include <QPixmap>
 #include <QImage>
+#include <QHash>
+#include <QSet>
+#include <QTimer>
 
 #include "ShaderListModel.h"
 #include "ShadertoyApi.h"
 #include "ShadertoyShader.h"
+#include "ThumbnailLoader.h"
 #include "log.h"
 
+namespace {
+
+    ShaderHandle makeHandle(const ShadertoyShader& shader)
+    {
+        return ShaderHandle(new ShadertoyShader(shader));
+    }
+
+    /** Rank of each string in the sorted set of distinct strings */
+    QVector<qint64> stringRanks(const QVector<QString>& strings)
+    {
+        QVector<int> order(strings.size());
+        for (int i=0; i<order.size(); ++i)
+            order[i] = i;
+        std::sort(order.begin(), order.end(), [&](int l, int r)
+        {
+            return QString::compare(strings[l], strings[r]) < 0;
+        });
+
+        QVector<qint64> ranks(strings.size());
+        qint64 rank = 0;
+        for (int i=0; i<order.size(); ++i)
+        {
+            if (i > 0 && strings[order[i]] != strings[order[i-1]])
+                ++rank;
+            ranks[order[i]] = rank;
+        }
+        return ranks;
+    }
+
+} // namespace
+
 struct ShaderListModel::Private
 {
     Private(ShaderListModel* p)
         : p     (p)
-        , api   (new ShadertoyApi(p))
+        , api   (ShadertoyApi::acquire())
+        , thumbnails    (new ThumbnailLoader(p))
         , doThumbnails  (false)
+        , syncTimer     (new QTimer(p))
+        , revision      (0)
     {
+        // at most one update per frame
+        syncTimer->setSingleShot(true);
+        syncTimer->setInterval(16);
+        connect(syncTimer, &QTimer::timeout, p, [=](){ syncWithApi(); });
+
+        connect(thumbnails, &ThumbnailLoader::thumbnailReady, p,
+                [=](const QString& id){ onThumbnail(id); });
+
         api->loadShaderList();
-        connect(api, &ShadertoyApi::shaderListChanged, [=]()
+        connect(api, &ShadertoyApi::shadersChanged, p,
+                [=](const QStringList& ids)
         {
-            copyListFromApi();
+            for (const QString& id : ids)
+                changedIds.insert(id);
+            scheduleSync();
+        });
+        connect(api, &ShadertoyApi::shaderListChanged, p, [=]()
+        {
+            scheduleSync();
         });
+        connect(api, &ShadertoyApi::snapshotChanged, p,
+                [=](const QString& id)
+        {
+            thumbnails->remove(id);
+            onThumbnail(id);
+        });
+        connect(api, &ShadertoyApi::validationChanged, p,
+                [=](const QStringList& ids){ onValidation(ids); });
+        scheduleSync();
     }
 
     void initHeaders();
+    void onThumbnail(const QString& id);
+    void onValidation(const QStringList& ids);
+    void scheduleSync()
+        { if (!syncTimer->isActive()) syncTimer->start(); }
+    /** Applies the changes of the api since the last call
+        as row removals, insertions and dataChanged() */
+    void syncWithApi();
     void copyListFromApi();
+    void updateRowIndex();
+    /** Called before the rows or their values change */
+    void invalidateKeys() { sortKeys.clear(); ++revision; }
+    /** Shader at row, loads the body if not yet present.
+        The list itself only keeps what the api provides,
+        so lazy loaded bodies stay in the api's cache. */
+    ShadertoyShader shader(int row) const;
 
     struct Column
     {
@@ -46,10 +124,23 @@ struct ShaderListModel::Private
 
     ShaderListModel* p;
     ShadertoyApi* api;
-    QList<ShadertoyShader> shaders;
+    QVector<ShaderHandle> shaders;
     QVector<Column> columns;
-    QMap<QString, QPixmap> pixMap;
+    ThumbnailLoader* thumbnails;
+    /** Shown until the thumbnail is decoded */
+    QPixmap placeholder;
     bool doThumbnails;
+    /** Lazily built sort keys per ColumnId */
+    QVector<QVector<qint64>> sortKeys;
+
+    QTimer* syncTimer;
+    /** The api's id list at the last sync, shares its data
+        while unchanged */
+    QStringList syncedIds;
+    /** Ids from ShadertoyApi::shadersChanged() since the last sync */
+    QSet<QString> changedIds;
+    QHash<QString, int> rowOf;
+    int revision;
 };
 
 ShaderListModel::ShaderListModel(QObject *parent)
@@ -79,11 +170,13 @@ void ShaderListModel::Private::initHeaders()
             << Column(tr("use mouse"), C_USE_MOUSE)
             << Column(tr("use music"), C_USE_MUSIC)
             << Column(tr("flags"), C_FLAGS)
+            << Column(tr("compiles"), C_COMPILES)
                ;
 }
 
 ShaderListModel::~ShaderListModel()
 {
+    p_->api->release();
     delete p_;
 }
 
@@ -96,33 +189,288 @@ void ShaderListModel::Private::copyListFromApi()
 {
     ST_DEBUG2("ShaderListModel::copyListFromApi()");
 
+    invalidateKeys();
     p->beginResetModel();
 
     shaders.clear();
     for (auto id : api->shaderIds())
-        shaders << api->getShader(id);
+        shaders << makeHandle(api->getShader(id, false));
+    thumbnails->clear();
+    syncedIds = api->shaderIds();
+    changedIds.clear();
+    updateRowIndex();
 
     p->endResetModel();
 }
 
+void ShaderListModel::Private::updateRowIndex()
+{
+    rowOf.clear();
+    rowOf.reserve(shaders.size());
+    for (int i=0; i<shaders.size(); ++i)
+        rowOf.insert(shaders[i]->info().id, i);
+}
+
+void ShaderListModel::Private::syncWithApi()
+{
+    const QStringList& ids = api->shaderIds();
+
+    if (!syncedIds.isSharedWith(ids))
+    {
+        const QSet<QString> idSet = ids.toSet();
+        QVector<int> removed;
+        for (int i=0; i<shaders.size(); ++i)
+            if (!idSet.contains(shaders[i]->info().id))
+                removed << i;
+
+        // first fill or a different list
+        if (shaders.isEmpty() || removed.size() > shaders.size() / 4)
+        {
+            copyListFromApi();
+            return;
+        }
+
+        ST_DEBUG2("ShaderListModel::syncWithApi() removing "
+                  << removed.size() << " rows");
+
+        // contiguous ranges, from the bottom
+        for (int i=removed.size()-1; i>=0; )
+        {
+            int first = i;
+            while (first > 0 && removed[first-1] == removed[first] - 1)
+                --first;
+            const int begin = removed[first], end = removed[i];
+            invalidateKeys();
+            p->beginRemoveRows(QModelIndex(), begin, end);
+            for (int r=end; r>=begin; --r)
+            {
+                thumbnails->remove(shaders[r]->info().id);
+                shaders.removeAt(r);
+            }
+            p->endRemoveRows();
+            i = first - 1;
+        }
+        if (!removed.isEmpty())
+            updateRowIndex();
+
+        QStringList added;
+        for (const QString& id : ids)
+            if (!rowOf.contains(id))
+                added << id;
+
+        if (!added.isEmpty())
+        {
+            ST_DEBUG2("ShaderListModel::syncWithApi() appending "
+                      << added.size() << " rows");
+
+            const int first = shaders.size();
+            invalidateKeys();
+            p->beginInsertRows(QModelIndex(), first,
+                               first + added.size() - 1);
+            for (const QString& id : added)
+            {
+                rowOf.insert(id, shaders.size());
+                shaders << makeHandle(api->getShader(id, false));
+                changedIds.remove(id);
+            }
+            p->endInsertRows();
+        }
+
+        syncedIds = ids;
+    }
+
+    // replaced shaders
+    QVector<int> rows;
+    for (const QString& id : changedIds)
+    {
+        const int row = rowOf.value(id, -1);
+        if (row < 0)
+            continue;
+        shaders[row] = makeHandle(api->getShader(id, false));
+        thumbnails->remove(id);
+        rows << row;
+    }
+    changedIds.clear();
+
+    if (!rows.isEmpty())
+    {
+        invalidateKeys();
+
+        std::sort(rows.begin(), rows.end());
+        for (int i=0; i<rows.size(); )
+        {
+            int last = i;
+            while (last+1 < rows.size() && rows[last+1] == rows[last] + 1)
+                ++last;
+            emit p->dataChanged(p->index(rows[i], 0),
+                                p->index(rows[last], columns.size() - 1));
+            i = last + 1;
+        }
+    }
+}
+
 void ShaderListModel::setEnableThumbnails(bool e)
 {
     beginResetModel();
     p_->doThumbnails = e;
     p_->initHeaders();
+    if (e)
+        p_->thumbnails->setStore(p_->api->thumbnailStore());
+    else
+        p_->thumbnails->clear();
     endResetModel();
 }
 
+void ShaderListModel::Private::onThumbnail(const QString& id)
+{
+    const int row = rowOf.value(id, -1);
+    if (row < 0)
+        return;
+    for (int i=0; i<columns.size(); ++i)
+        if (columns[i].id == C_IMAGE)
+        {
+            const QModelIndex idx = p->index(row, i);
+            emit p->dataChanged(idx, idx, QVector<int>() << Qt::DecorationRole);
+        }
+}
+
+void ShaderListModel::Private::onValidation(const QStringList& ids)
+{
+    if (sortKeys.size() == C_NUM_COLUMN_IDS)
+        sortKeys[C_COMPILES].clear();
+    ++revision;
+
+    int column = -1;
+    for (int i=0; i<columns.size(); ++i)
+        if (columns[i].id == C_COMPILES)
+            column = i;
+    if (column < 0)
+        return;
+
+    // one signal for the range of changed rows
+    int minRow = shaders.size(), maxRow = -1;
+    for (const QString& id : ids)
+    {
+        const int row = rowOf.value(id, -1);
+        if (row < 0)
+            continue;
+        minRow = std::min(minRow, row);
+        maxRow = std::max(maxRow, row);
+    }
+    if (maxRow < 0)
+        return;
+    emit p->dataChanged(p->index(minRow, column), p->index(maxRow, column),
+                        QVector<int>() << Qt::DisplayRole << Qt::ToolTipRole);
+}
+
+ShadertoyShader ShaderListModel::Private::shader(int row) const
+{
+    if (shaders[row]->isInfoOnly())
+        return api->getShader(shaders[row]->info().id);
+    return *shaders[row];
+}
+
 ShadertoyShader ShaderListModel::getShader(const QModelIndex& idx) const
 {
     if (idx.row() < 0 || idx.row() >= p_->shaders.size())
         return ShadertoyShader();
-    return p_->shaders[idx.row()];
+    return p_->shader(idx.row());
+}
+
+ShadertoyShader ShaderListModel::getShader(int row) const
+{
+    return p_->shader(row);
+}
+
+const QVector<ShaderHandle>& ShaderListModel::shaders() const
+{
+    return p_->shaders;
+}
+
+const ShadertoyShaderInfo& ShaderListModel::getShaderInfo(int row) const
+{
+    return p_->shaders[row]->info();
 }
 
-const ShadertoyShader& ShaderListModel::getShader(int row) const
+int ShaderListModel::revision() const { return p_->revision; }
+
+ShaderListModel::ColumnId ShaderListModel::columnId(int column) const
 {
-    return p_->shaders[row];
+    if (column < 0 || column >= p_->columns.size())
+        return C_NUM_COLUMN_IDS;
+    return p_->columns[column].id;
+}
+
+const QVector<qint64>& ShaderListModel::sortKeys(int column) const
+{
+    static const QVector<qint64> none;
+    const ColumnId id = columnId(column);
+    if (id == C_NUM_COLUMN_IDS)
+        return none;
+
+    if (p_->sortKeys.size() != C_NUM_COLUMN_IDS)
+        p_->sortKeys.resize(C_NUM_COLUMN_IDS);
+    QVector<qint64>& keys = p_->sortKeys[id];
+    if (keys.size() == p_->shaders.size())
+        return keys;
+
+    // not part of the shader, only known in this thread
+    if (id == C_COMPILES)
+    {
+        const ShaderValidationResults& results = p_->api->validationResults();
+        keys.clear();
+        keys.reserve(p_->shaders.size());
+        for (const ShaderHandle& s : p_->shaders)
+        {
+            auto e = results.find(s->info().id);
+            keys << (e ? qint64(e->status) : -1);
+        }
+    }
+    else
+        keys = createSortKeys(p_->shaders, id);
+    return keys;
+}
+
+QVector<qint64> ShaderListModel::createSortKeys(
+        const QVector<ShaderHandle>& shaders, ColumnId id)
+{
+    QVector<qint64> keys;
+
+    // strings
+    if (id == C_ID || id == C_NAME || id == C_USER)
+    {
+        QVector<QString> strings;
+        strings.reserve(shaders.size());
+        for (const ShaderHandle& s : shaders)
+            strings << (id == C_ID ? s->info().id
+                      : id == C_NAME ? s->info().name : s->info().username);
+        return stringRanks(strings);
+    }
+
+    if (id == C_IMAGE || id == C_NUM_COLUMN_IDS)
+        return keys;
+
+    keys.reserve(shaders.size());
+    for (const ShaderHandle& s : shaders)
+    {
+        const ShadertoyShaderInfo& i = s->info();
+        switch (id)
+        {
+            case C_DATE: keys << i.date.toMSecsSinceEpoch(); break;
+            case C_VIEWS: keys << i.views; break;
+            case C_LIKES: keys << i.likes; break;
+            case C_PASSES: keys << i.numPasses; break;
+            case C_NUM_CHARS: keys << qint64(i.numChars); break;
+            case C_HAS_SOUND: keys << i.hasSound; break;
+            case C_USE_TEX: keys << i.usesTextures; break;
+            case C_USE_MUSIC: keys << i.usesMusic; break;
+            case C_USE_KEYBOARD: keys << i.usesKeyboard; break;
+            case C_USE_MOUSE: keys << i.usesMouse; break;
+            case C_FLAGS: keys << i.flags; break;
+            default: keys << 0; break;
+        }
+    }
+    return keys;
 }
 
 int ShaderListModel::columnCount(const QModelIndex &parent) const
@@ -137,62 +485,89 @@ int ShaderListModel::rowCount(const QModelIndex &parent) const
 
 QVariant ShaderListModel::data(const QModelIndex &index, int role) const
 {
+    // the view asks for many roles per cell, most are not used
+    if (role != Qt::DisplayRole && role != Qt::EditRole
+            && role != Qt::DecorationRole && role != Qt::BackgroundColorRole
+            && role != Qt::ToolTipRole)
+        return QVariant();
+
     if (index.row() < 0 || index.row() >= p_->shaders.size())
         return QVariant();
 
-    if (index.column() < 0 || index.column() > p_->columns.size())
+    if (index.column() < 0 || index.column() >= p_->columns.size())
         return QVariant();
-    const Private::Column& column = p_->columns[index.column()];
+    const ColumnId column = p_->columns[index.column()].id;
 
-    const ShadertoyShader shader = p_->shaders[index.row()];
+    const ShadertoyShader& shader = *p_->shaders[index.row()];
+    const ShadertoyShaderInfo& info = shader.info();
 
     if (!shader.isValid())
     {
         if (role == Qt::BackgroundColorRole)
             return QColor(255,128,128);
         if (role == Qt::DisplayRole || role == Qt::EditRole)
-            if (column.id == C_ID)
-                return p_->shaders[index.row()].info().id;
+            if (column == C_ID)
+                return info.id;
         return QVariant();
     }
 
     if (role == Qt::DisplayRole || role == Qt::EditRole)
     {
-        switch (column.id)
+        switch (column)
         {
-            case C_ID: return shader.info().id;
-            case C_NAME: return shader.info().name;
-            case C_USER: return shader.info().username;
-            case C_DATE: return shader.info().date;
-            case C_VIEWS: return shader.info().views;
-            case C_LIKES: return shader.info().likes;
-            case C_PASSES: return (int)shader.numRenderPasses();
-            case C_NUM_CHARS: return (int)shader.info().numChars;
-            case C_HAS_SOUND: return shader.info().hasSound;
-            case C_USE_TEX: return shader.info().usesTextures;
-            case C_USE_MUSIC: return shader.info().usesMusic;
-            case C_USE_KEYBOARD: return shader.info().usesKeyboard;
-            case C_USE_MOUSE: return shader.info().usesMouse;
-            case C_FLAGS: return shader.info().flags;
-            case C_IMAGE: return QVariant();
+            case C_ID: return info.id;
+            case C_NAME: return info.name;
+            case C_USER: return info.username;
+            case C_DATE: return info.date;
+            case C_VIEWS: return info.views;
+            case C_LIKES: return info.likes;
+            case C_PASSES: return info.numPasses;
+            case C_NUM_CHARS: return (int)info.numChars;
+            case C_HAS_SOUND: return info.hasSound;
+            case C_USE_TEX: return info.usesTextures;
+            case C_USE_MUSIC: return info.usesMusic;
+            case C_USE_KEYBOARD: return info.usesKeyboard;
+            case C_USE_MOUSE: return info.usesMouse;
+            case C_FLAGS: return info.flags;
+            case C_COMPILES:
+            {
+                auto e = p_->api->validationResults().find(info.id);
+                if (!e)
+                    return QVariant();
+                return e->status == ShaderValidationResults::S_OK
+                        ? tr("yes")
+                        : ShaderValidationResults::statusName(e->status);
+            }
+            case C_IMAGE:
+            case C_NUM_COLUMN_IDS: return QVariant();
         }
     }
 
+    if (role == Qt::ToolTipRole && column == C_COMPILES)
+    {
+        auto e = p_->api->validationResults().find(info.id);
+        if (e && !e->log.isEmpty())
+            return e->log;
+        return QVariant();
+    }
+
     if (role == Qt::DecorationRole)
     {
-        if (column.id == C_IMAGE)
+        if (column == C_IMAGE)
         {
-            auto i = p_->pixMap.find(shader.info().id);
-            if (i != p_->pixMap.end())
-                return i.value();
-            auto img = p_->api->getSnapshot(shader.info().id, false);
-            if (img.isNull())
+            // decoded in the background, dataChanged() follows
+            const QPixmap pix = p_->thumbnails->thumbnail(
+                        info.id, p_->api->snapshotFilename(info.id));
+            if (!pix.isNull())
+                return pix;
+            if (p_->thumbnails->isMissing(info.id))
                 return QVariant();
-            auto p = QPixmap::fromImage(
-                        img.scaled(48, 48, Qt::IgnoreAspectRatio,
-                                           Qt::SmoothTransformation) );
-            p_->pixMap.insert(shader.info().id, p);
-            return p;
+            if (p_->placeholder.isNull())
+            {
+                p_->placeholder = QPixmap(p_->thumbnails->thumbnailSize());
+                p_->placeholder.fill(QColor(64, 64, 64));
+            }
+            return p_->placeholder;
         }
     }
 
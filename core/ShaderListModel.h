@@ -12,12 +12,23 @@
 #define SHADERLISTMODEL_H
 
 #include <QAbstractTableModel>
+#include <QVector>
+#include <QSharedPointer>
 
 class ShadertoyShader;
+struct ShadertoyShaderInfo;
 class ShadertoyApi;
 
+/** Shared, immutable shader of a ShaderListModel row.
+    A changed shader gets a new handle, so holders of the old
+    one keep a consistent view. */
+typedef QSharedPointer<const ShadertoyShader> ShaderHandle;
+
 /** Model to hold a list of Shaders as table.
-    Uses ShadertoyApi internally.
+    Uses the shared ShadertoyApi internally.
+    Changes of the api are collected and applied at most once
+    per frame as row insertions, removals and dataChanged(),
+    new shaders are appended at the end.
     */
 class ShaderListModel : public QAbstractTableModel
 {
@@ -41,7 +52,10 @@ public:
         C_USE_MUSIC,
         C_USE_KEYBOARD,
         C_USE_MOUSE,
-        C_FLAGS
+        C_FLAGS,
+        /** Result of the last ShaderValidator run */
+        C_COMPILES,
+        C_NUM_COLUMN_IDS
     };
 
     explicit ShaderListModel(QObject *parent = 0);
@@ -49,13 +63,41 @@ public:
 
     const QStringList& shaderIds() const;
 
-    /** Shader for index */
+    /** Shader for index, the json body is loaded if needed */
     ShadertoyShader getShader(const QModelIndex&) const;
-    /** Shader for row, no error checking */
-    const ShadertoyShader& getShader(int row) const;
+    /** Shader for row, no error checking.
+        The json body is loaded if needed */
+    ShadertoyShader getShader(int row) const;
+    /** All shaders in row order, as provided by the api,
+        possibly without render passes.
+        A copy is a cheap, immutable snapshot, the model
+        only copies the handles when it changes a row. */
+    const QVector<ShaderHandle>& shaders() const;
+    /** Info of shader in row, no error checking.
+        Does not load the json body. */
+    const ShadertoyShaderInfo& getShaderInfo(int row) const;
 
     ShadertoyApi* api();
 
+    /** Id of the column at index @p column, or C_NUM_COLUMN_IDS */
+    ColumnId columnId(int column) const;
+
+    /** One sort key per row for the column at index @p column.
+        Comparing the keys gives the same order as comparing
+        the displayed values, strings are replaced by their rank
+        among all distinct values of the column.
+        Empty for columns that are not sortable.
+        Built on first request and kept until the list changes. */
+    const QVector<qint64>& sortKeys(int column) const;
+
+    /** Increased whenever rows or their values change */
+    int revision() const;
+
+    /** Builds the sort keys of @p id for a list of shaders.
+        Threadsafe, for use on a snapshot of shaders(). */
+    static QVector<qint64> createSortKeys(
+            const QVector<ShaderHandle>& shaders, ColumnId id);
+
     /** Display snapshots images in the table */
     void setEnableThumbnails(bool e);
 
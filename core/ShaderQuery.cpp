@@ -0,0 +1,633 @@
+/***************************************************************************
+
+Copyright (C) 2016  stefan.berke @ modular-audio-graphics.com
+
+This source is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either
+version 3.0 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this software; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+****************************************************************************/
+
+#include <algorithm>
+#include <limits>
+
+#include <QDate>
+#include <QDateTime>
+
+#include "ShaderQuery.h"
+#include "ShadertoyShader.h"
+
+namespace {
+
+    const qint64 minValue = std::numeric_limits<qint64>::min(),
+                 maxValue = std::numeric_limits<qint64>::max();
+
+    struct FieldName
+    {
+        const char* name;
+        ShaderQuery::Field field;
+    };
+
+    /** Names of the fields in front of ':' or an operator */
+    const FieldName fieldNames[] =
+    {
+        { "text",           ShaderQuery::F_TEXT },
+        { "id",             ShaderQuery::F_ID },
+        { "name",           ShaderQuery::F_NAME },
+        { "user",           ShaderQuery::F_USER },
+        { "desc",           ShaderQuery::F_DESCRIPTION },
+        { "description",    ShaderQuery::F_DESCRIPTION },
+        { "tag",            ShaderQuery::F_TAG },
+        { "views",          ShaderQuery::F_VIEWS },
+        { "likes",          ShaderQuery::F_LIKES },
+        { "passes",         ShaderQuery::F_PASSES },
+        { "chars",          ShaderQuery::F_CHARS },
+        { "flags",          ShaderQuery::F_FLAGS },
+        { "date",           ShaderQuery::F_DATE }
+    };
+
+    /** Values of uses: and has: */
+    const FieldName usesNames[] =
+    {
+        { "textures",       ShaderQuery::F_USES_TEXTURES },
+        { "buffers",        ShaderQuery::F_USES_BUFFERS },
+        { "music",          ShaderQuery::F_USES_MUSIC },
+        { "video",          ShaderQuery::F_USES_VIDEO },
+        { "camera",         ShaderQuery::F_USES_CAMERA },
+        { "microphone",     ShaderQuery::F_USES_MICROPHONE },
+        { "keyboard",       ShaderQuery::F_USES_KEYBOARD },
+        { "mouse",          ShaderQuery::F_USES_MOUSE },
+        { "sound",          ShaderQuery::F_HAS_SOUND }
+    };
+
+    bool isStringField(ShaderQuery::Field f)
+    {
+        return f <= ShaderQuery::F_TAG;
+    }
+
+    bool isBoolField(ShaderQuery::Field f)
+    {
+        return f >= ShaderQuery::F_USES_TEXTURES;
+    }
+
+    /** The info part of ShadertoyShader::containsString() */
+    bool infoContains(const ShadertoyShaderInfo& info, const QString& s)
+    {
+        if (info.description.contains(s, Qt::CaseInsensitive)
+            || info.name.contains(s, Qt::CaseInsensitive)
+            || info.username.contains(s, Qt::CaseInsensitive)
+            || info.id.contains(s, Qt::CaseSensitive))
+            return true;
+
+        for (const QString& tag : info.tags)
+            if (tag.contains(s, Qt::CaseInsensitive))
+                return true;
+
+        return false;
+    }
+
+    qint64 numericValue(const ShadertoyShaderInfo& info, ShaderQuery::Field f)
+    {
+        switch (f)
+        {
+            case ShaderQuery::F_VIEWS: return info.views;
+            case ShaderQuery::F_LIKES: return info.likes;
+            case ShaderQuery::F_PASSES: return info.numPasses;
+            case ShaderQuery::F_CHARS: return qint64(info.numChars);
+            case ShaderQuery::F_FLAGS: return info.flags;
+            case ShaderQuery::F_DATE: return info.date.toMSecsSinceEpoch();
+            default: return 0;
+        }
+    }
+
+    bool boolValue(const ShadertoyShaderInfo& info, ShaderQuery::Field f)
+    {
+        switch (f)
+        {
+            case ShaderQuery::F_USES_TEXTURES: return info.usesTextures;
+            case ShaderQuery::F_USES_BUFFERS: return info.usesBuffers;
+            case ShaderQuery::F_USES_MUSIC: return info.usesMusic;
+            case ShaderQuery::F_USES_VIDEO: return info.usesVideo;
+            case ShaderQuery::F_USES_CAMERA: return info.usesCamera;
+            case ShaderQuery::F_USES_MICROPHONE: return info.usesMicrophone;
+            case ShaderQuery::F_USES_KEYBOARD: return info.usesKeyboard;
+            case ShaderQuery::F_USES_MOUSE: return info.usesMouse;
+            case ShaderQuery::F_HAS_SOUND: return info.hasSound;
+            default: return false;
+        }
+    }
+
+    /** Midnight in local time as msecs since epoch */
+    qint64 startOfDay(const QDate& d)
+    {
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+        return d.startOfDay().toMSecsSinceEpoch();
+#else
+        return QDateTime(d).toMSecsSinceEpoch();
+#endif
+    }
+
+    /** Start and end of the day, month or year in @p s,
+        as msecs since epoch in local time like ShadertoyShaderInfo::date */
+    bool parseDate(const QString& s, qint64& start, qint64& end)
+    {
+        QDate d, e;
+        switch (s.count('-'))
+        {
+            case 0:
+                d = QDate::fromString(s, "yyyy");
+                e = d.addYears(1);
+            break;
+            case 1:
+                d = QDate::fromString(s, "yyyy-M");
+                e = d.addMonths(1);
+            break;
+            case 2:
+                d = QDate::fromString(s, "yyyy-M-d");
+                e = d.addDays(1);
+            break;
+            default: return false;
+        }
+        if (!d.isValid())
+            return false;
+        start = startOfDay(d);
+        end = startOfDay(e);
+        return true;
+    }
+
+    /** "a..b", either side may be empty, @p max is exclusive */
+    bool parseRange(const QString& s, bool isDate, qint64& min, qint64& max)
+    {
+        const int dots = s.indexOf("..");
+        const QString a = dots < 0 ? s : s.left(dots),
+                      b = dots < 0 ? s : s.mid(dots + 2);
+        min = minValue;
+        max = maxValue;
+        qint64 start, end;
+        bool ok = true;
+        if (!a.isEmpty())
+        {
+            if (isDate)
+                ok = parseDate(a, min, end);
+            else
+                min = a.toLongLong(&ok);
+        }
+        if (ok && !b.isEmpty())
+        {
+            if (isDate)
+                ok = parseDate(b, start, max);
+            else
+                max = b.toLongLong(&ok) + 1;
+        }
+        return ok && (dots >= 0 || !a.isEmpty());
+    }
+
+    /** A word of the query, @c literal if it starts with a quote */
+    struct Token
+    {
+        QString text;
+        bool literal;
+    };
+
+    /** Splits at whitespace outside of double quotes, removes the quotes */
+    QList<Token> tokenize(const QString& text)
+    {
+        QList<Token> tokens;
+        Token token;
+        token.literal = false;
+        bool quoted = false, hasToken = false;
+        for (const QChar c : text)
+        {
+            if (c == '"')
+            {
+                if (!hasToken)
+                    token.literal = true;
+                quoted = !quoted;
+                hasToken = true;
+            }
+            else if (c.isSpace() && !quoted)
+            {
+                if (hasToken)
+                    tokens << token;
+                token.text.clear();
+                token.literal = false;
+                hasToken = false;
+            }
+            else
+            {
+                token.text += c;
+                hasToken = true;
+            }
+        }
+        if (hasToken)
+            tokens << token;
+        return tokens;
+    }
+
+    /** A '-' only negates when a word or field follows,
+        so numbers like -0.5 are searched as text */
+    bool isNegated(const QString& word)
+    {
+        return word.size() > 1 && word[0] == '-' && word[1].isLetter();
+    }
+
+} // namespace
+
+
+// ----------------------------- Clause --------------------------------
+
+int ShaderQuery::Clause::cost() const
+{
+    if (isBoolField(field))
+        return 0;
+    switch (field)
+    {
+        case F_VIEWS: case F_LIKES: case F_PASSES: case F_CHARS:
+        case F_FLAGS: case F_DATE: return 1;
+        case F_ID: return 2;
+        case F_NAME: case F_USER: return 3;
+        case F_TAG: return 4;
+        case F_DESCRIPTION: return 5;
+        default: return 10;
+    }
+}
+
+bool ShaderQuery::Clause::matches(const ShadertoyShaderInfo& info) const
+{
+    bool r;
+    if (isBoolField(field))
+        r = boolValue(info, field);
+    else if (isStringField(field))
+    {
+        switch (field)
+        {
+            case F_ID: r = info.id.contains(text, Qt::CaseSensitive); break;
+            case F_NAME: r = info.name.contains(text, Qt::CaseInsensitive); break;
+            case F_USER: r = info.username.contains(text, Qt::CaseInsensitive);
+                break;
+            case F_DESCRIPTION:
+                r = info.description.contains(text, Qt::CaseInsensitive); break;
+            case F_TAG:
+                r = false;
+                for (const QString& tag : info.tags)
+                    if (tag.contains(text, Qt::CaseInsensitive))
+                    {
+                        r = true;
+                        break;
+                    }
+            break;
+            default: r = infoContains(info, text); break;
+        }
+    }
+    else
+    {
+        const qint64 v = numericValue(info, field);
+        switch (op)
+        {
+            case O_EQUAL: r = v == min; break;
+            case O_LESS: r = v < min; break;
+            case O_LESS_EQUAL: r = v <= min; break;
+            case O_GREATER: r = v > min; break;
+            case O_GREATER_EQUAL: r = v >= min; break;
+            case O_RANGE: r = v >= min && v < max; break;
+            default: r = false; break;
+        }
+    }
+    return r != negate;
+}
+
+bool ShaderQuery::Clause::matches(const ShadertoyShader& shader) const
+{
+    if (field == F_TEXT)
+        return shader.containsString(text) != negate;
+    return matches(shader.info());
+}
+
+QString ShaderQuery::Clause::toString() const
+{
+    QString s = negate ? "-" : "";
+    if (isBoolField(field))
+    {
+        for (const FieldName& n : usesNames)
+            if (n.field == field)
+                return s + "uses:" + n.name;
+    }
+
+    for (const FieldName& n : fieldNames)
+        if (n.field == field)
+        {
+            s += n.name;
+            break;
+        }
+
+    if (isStringField(field))
+        return s + ":\"" + text + "\"";
+
+    auto num = [=](qint64 v)
+    {
+        if (field != F_DATE)
+            return QString::number(v);
+        return QDateTime::fromMSecsSinceEpoch(v).toString(Qt::ISODate);
+    };
+
+    switch (op)
+    {
+        case O_EQUAL: return s + "=" + num(min);
+        case O_LESS: return s + "<" + num(min);
+        case O_LESS_EQUAL: return s + "<=" + num(min);
+        case O_GREATER: return s + ">" + num(min);
+        case O_GREATER_EQUAL: return s + ">=" + num(min);
+        default: break;
+    }
+    // ranges of numbers are stored with an exclusive end
+    return s + ":" + (min == minValue ? QString() : num(min)) + ".."
+            + (max == maxValue ? QString()
+                               : num(field == F_DATE ? max : max - 1));
+}
+
+
+// --------------------------- ShaderQuery -----------------------------
+
+ShaderQuery::ShaderQuery()
+{
+}
+
+ShaderQuery::ShaderQuery(const QString& text)
+{
+    for (const QString& alt : text.split(";"))
+    {
+        Group g;
+        if (parseGroup(alt, g))
+            p_groups_ << g;
+    }
+}
+
+bool ShaderQuery::parseGroup(const QString& text, Group& group)
+{
+    QStringList words;
+    for (const Token& t : tokenize(text))
+    {
+        // quoted words are always searched as they are
+        const QString& token = t.text;
+        if (t.literal)
+        {
+            words << token;
+            continue;
+        }
+
+        Clause c;
+        if (parseClause(token, c))
+        {
+            group << c;
+            continue;
+        }
+        if (isNegated(token))
+        {
+            c.field = F_TEXT;
+            c.op = O_CONTAINS;
+            c.negate = true;
+            c.min = c.max = 0;
+            c.text = token.mid(1);
+            group << c;
+        }
+        else
+            words << token;
+    }
+
+    // the remaining words are one substring, like the old filter
+    const QString joined = words.join(" ").simplified();
+    if (!joined.isEmpty())
+    {
+        Clause c;
+        c.field = F_TEXT;
+        c.op = O_CONTAINS;
+        c.negate = false;
+        c.min = c.max = 0;
+        c.text = joined;
+        group << c;
+    }
+
+    std::stable_sort(group.begin(), group.end(),
+                     [](const Clause& l, const Clause& r)
+    {
+        return l.cost() < r.cost();
+    });
+
+    return !group.isEmpty();
+}
+
+bool ShaderQuery::parseClause(const QString& word, Clause& c) const
+{
+    c.negate = isNegated(word);
+    const QString w = c.negate ? word.mid(1) : word;
+    c.min = c.max = 0;
+
+    int i = 0;
+    while (i < w.size() && w[i].isLetter())
+        ++i;
+    if (i == 0 || i == w.size())
+        return false;
+    const QString name = w.left(i).toLower();
+
+    int len = 1;
+    if (w.midRef(i).startsWith(">="))
+    {
+        c.op = O_GREATER_EQUAL;
+        len = 2;
+    }
+    else if (w.midRef(i).startsWith("<="))
+    {
+        c.op = O_LESS_EQUAL;
+        len = 2;
+    }
+    else if (w[i] == '>')
+        c.op = O_GREATER;
+    else if (w[i] == '<')
+        c.op = O_LESS;
+    else if (w[i] == '=' || w[i] == ':')
+        c.op = O_EQUAL;
+    else
+        return false;
+    const QString value = w.mid(i + len);
+    if (value.isEmpty())
+        return false;
+
+    // uses:X
+    if (name == "uses" || name == "has")
+    {
+        if (c.op != O_EQUAL)
+            return false;
+        for (const FieldName& n : usesNames)
+            if (value.compare(n.name, Qt::CaseInsensitive) == 0)
+            {
+                c.field = n.field;
+                c.op = O_TRUE;
+                return true;
+            }
+        return false;
+    }
+
+    bool found = false;
+    for (const FieldName& n : fieldNames)
+        if (name == n.name)
+        {
+            c.field = n.field;
+            found = true;
+            break;
+        }
+    if (!found)
+        return false;
+
+    if (isStringField(c.field))
+    {
+        if (c.op != O_EQUAL)
+            return false;
+        c.op = O_CONTAINS;
+        c.text = value;
+        return true;
+    }
+
+    // dates are ranges, comparisons use the start or end of it
+    if (c.field == F_DATE)
+    {
+        qint64 start, end;
+        if (c.op == O_EQUAL)
+        {
+            c.op = O_RANGE;
+            return parseRange(value, true, c.min, c.max);
+        }
+        if (!parseDate(value, start, end))
+            return false;
+        c.min = minValue;
+        c.max = maxValue;
+        switch (c.op)
+        {
+            case O_GREATER: c.min = end; break;
+            case O_GREATER_EQUAL: c.min = start; break;
+            case O_LESS: c.max = start; break;
+            case O_LESS_EQUAL: c.max = end; break;
+            default: break;
+        }
+        c.op = O_RANGE;
+        return true;
+    }
+
+    if (c.op == O_EQUAL && value.contains(".."))
+    {
+        c.op = O_RANGE;
+        return parseRange(value, false, c.min, c.max);
+    }
+
+    bool ok;
+    c.min = value.toLongLong(&ok);
+    return ok;
+}
+
+QString ShaderQuery::toString() const
+{
+    QStringList alts;
+    for (const Group& g : p_groups_)
+    {
+        QStringList clauses;
+        for (const Clause& c : g)
+            clauses << c.toString();
+        alts << clauses.join(" ");
+    }
+    alts.sort();
+    return alts.join("; ");
+}
+
+bool ShaderQuery::isPlainText() const
+{
+    for (const Group& g : p_groups_)
+        if (g.size() != 1 || g[0].field != F_TEXT || g[0].negate)
+            return false;
+    return true;
+}
+
+QStringList ShaderQuery::textTerms() const
+{
+    QStringList terms;
+    for (const Group& g : p_groups_)
+        for (const Clause& c : g)
+            if (c.field == F_TEXT && !c.negate)
+                terms << c.text;
+    return terms;
+}
+
+bool ShaderQuery::indexTerms(QStringList& terms) const
+{
+    terms.clear();
+    for (const Group& g : p_groups_)
+    {
+        // the longest substring narrows the most
+        const Clause* best = nullptr;
+        for (const Clause& c : g)
+            if (c.field == F_TEXT && !c.negate
+                    && (!best || c.text.size() > best->text.size()))
+                best = &c;
+        if (!best)
+            return false;
+        terms << best->text;
+    }
+    return !terms.isEmpty();
+}
+
+ShaderQuery::Match ShaderQuery::matchInfo(
+        const ShadertoyShaderInfo& info) const
+{
+    bool needsSource = false;
+    for (const Group& g : p_groups_)
+    {
+        bool ok = true, undecided = false;
+        for (const Clause& c : g)
+        {
+            if (c.needsSource())
+            {
+                // found in the info fields decides, otherwise
+                // the sources have to be searched
+                if (infoContains(info, c.text))
+                    ok = !c.negate;
+                else
+                    undecided = true;
+            }
+            else
+                ok = c.matches(info);
+            if (!ok)
+                break;
+        }
+        if (!ok)
+            continue;
+        if (!undecided)
+            return M_YES;
+        needsSource = true;
+    }
+    return needsSource ? M_NEEDS_SOURCE : M_NO;
+}
+
+bool ShaderQuery::matches(const ShadertoyShader& shader) const
+{
+    for (const Group& g : p_groups_)
+    {
+        bool ok = true;
+        for (const Clause& c : g)
+            if (!c.matches(shader))
+            {
+                ok = false;
+                break;
+            }
+        if (ok)
+            return true;
+    }
+    return false;
+}
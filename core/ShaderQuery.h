@@ -0,0 +1,183 @@
+/***************************************************************************
+
+Copyright (C) 2016  stefan.berke @ modular-audio-graphics.com
+
+This source is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either
+version 3.0 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this software; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+****************************************************************************/
+
+#ifndef SHADERQUERY_H
+#define SHADERQUERY_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+class ShadertoyShader;
+struct ShadertoyShaderInfo;
+
+/** A parsed filter expression for shaders.
+
+    The text is split at ';' into alternatives, a shader matches if
+    any alternative matches. Within an alternative, all whitespace
+    separated clauses must match:
+
+    @code
+    user:iq tag:fractal likes>100 uses:buffers passes>=3 -uses:keyboard
+    date:2016..  date:2016-03..2016-06  name:"sea scape"  views:100..500
+    @endcode
+
+    - @c user:, @c name:, @c id:, @c desc:, @c tag: match substrings
+      of the info fields, like the free text search
+    - @c views, @c likes, @c passes, @c chars, @c flags compare with
+      @c > @c >= @c < @c <= @c = or @c : and accept @c a..b ranges
+    - @c date: takes @c yyyy, @c yyyy-MM or @c yyyy-MM-dd,
+      either end of a range may be left open
+    - @c uses: or @c has: takes textures, buffers, music, video,
+      camera, microphone, keyboard, mouse or sound
+    - a leading @c - negates a clause if a letter follows,
+      @c -0.5 or @c -1 are searched as text
+    - a word starting with a quote is always searched as text,
+      e.g. @c "-fractal" or @c "likes>100"
+
+    All other words of an alternative are joined into one substring
+    that is searched in the info fields and the pass sources, as
+    before. Clauses that can not be parsed are treated as such words.
+
+    Clauses are sorted by cost, so numeric and boolean tests run before
+    string tests and the source scan comes last.
+    The query is immutable after construction and can be copied
+    to worker threads.
+*/
+class ShaderQuery
+{
+public:
+
+    enum Field
+    {
+        F_TEXT,
+        F_ID,
+        F_NAME,
+        F_USER,
+        F_DESCRIPTION,
+        F_TAG,
+        F_VIEWS,
+        F_LIKES,
+        F_PASSES,
+        F_CHARS,
+        F_FLAGS,
+        F_DATE,
+        F_USES_TEXTURES,
+        F_USES_BUFFERS,
+        F_USES_MUSIC,
+        F_USES_VIDEO,
+        F_USES_CAMERA,
+        F_USES_MICROPHONE,
+        F_USES_KEYBOARD,
+        F_USES_MOUSE,
+        F_HAS_SOUND
+    };
+
+    enum Op
+    {
+        /** Substring, case-insensitive except for ids */
+        O_CONTAINS,
+        O_EQUAL,
+        O_LESS,
+        O_LESS_EQUAL,
+        O_GREATER,
+        O_GREATER_EQUAL,
+        /** min <= value < max */
+        O_RANGE,
+        O_TRUE
+    };
+
+    /** Result of matchInfo() */
+    enum Match
+    {
+        M_NO,
+        M_YES,
+        /** Only the pass sources can decide */
+        M_NEEDS_SOURCE
+    };
+
+    /** One compiled test */
+    struct Clause
+    {
+        Field field;
+        Op op;
+        bool negate;
+        /** Operands of numeric fields, dates as msecs since epoch */
+        qint64 min, max;
+        QString text;
+
+        /** Relative cost, clauses are evaluated in ascending order */
+        int cost() const;
+        bool needsSource() const { return field == F_TEXT; }
+        /** Tests the info fields. For F_TEXT this only checks
+            the info part of ShadertoyShader::containsString() */
+        bool matches(const ShadertoyShaderInfo&) const;
+        /** Tests the clause including the pass sources */
+        bool matches(const ShadertoyShader&) const;
+        QString toString() const;
+    };
+
+    typedef QVector<Clause> Group;
+
+    ShaderQuery();
+    explicit ShaderQuery(const QString& text);
+
+    // --- getter ---
+
+    bool isEmpty() const { return p_groups_.isEmpty(); }
+
+    /** The alternatives, each a list of clauses sorted by cost */
+    const QVector<Group>& groups() const { return p_groups_; }
+
+    /** Normalized text of the query, equal for equivalent queries */
+    QString toString() const;
+
+    /** Each alternative is a single substring without fields,
+        as in the old ';'-separated filter. */
+    bool isPlainText() const;
+    /** The substrings of a plain-text query */
+    QStringList textTerms() const;
+
+    /** Collects one substring per alternative that a matching shader
+        must contain. Returns false if some alternative does not
+        require a substring, in which case the search index
+        can not narrow the candidates. */
+    bool indexTerms(QStringList& terms) const;
+
+    // --- evaluation ---
+
+    /** Evaluates the query on the info fields only.
+        Returns M_NEEDS_SOURCE if the result depends on the
+        pass sources, which the info does not have. */
+    Match matchInfo(const ShadertoyShaderInfo&) const;
+
+    /** Evaluates the whole query. The shader should have its
+        render passes, otherwise only the info fields are searched. */
+    bool matches(const ShadertoyShader&) const;
+
+private:
+
+    bool parseGroup(const QString& text, Group& group);
+    bool parseClause(const QString& word, Clause& clause) const;
+
+    QVector<Group> p_groups_;
+};
+
+#endif // SHADERQUERY_H
@@ -0,0 +1,145 @@
+/***************************************************************************
+
+Copyright (C) 2016  stefan.berke @ modular-audio-graphics.com
+
+This source is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either
+version 3.0 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this software; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+****************************************************************************/
+
+#include <QHash>
+#include <QTextStream>
+
+#include "ShaderRenderGraph.h"
+#include "log.h"
+
+void ShaderRenderGraph::build(const ShadertoyShader& shader)
+{
+    p_passes_ = shader.sortedRenderPasses();
+    p_edges_.clear();
+
+    // writer of each buffer id, the first one wins
+    QHash<int, int> writer;
+    for (int i=0; i<p_passes_.size(); ++i)
+        if (!writer.contains(p_passes_[i].outputId()))
+            writer.insert(p_passes_[i].outputId(), i);
+
+    for (int i=0; i<p_passes_.size(); ++i)
+    {
+        const ShadertoyRenderPass& pass = p_passes_[i];
+        for (size_t ch=0; ch<pass.numInputs() && ch<4; ++ch)
+        {
+            const ShadertoyInput& inp = pass.input(ch);
+            if (inp.type() != ShadertoyInput::T_BUFFER)
+                continue;
+            const int from = writer.value(inp.id(), -1);
+            if (from < 0)
+                continue;
+
+            Edge e;
+            e.from = from;
+            e.to = i;
+            e.channel = int(ch);
+            e.feedback = from >= i;
+            p_edges_ << e;
+        }
+    }
+
+    cull();
+}
+
+void ShaderRenderGraph::cull()
+{
+    p_culled_.fill(true, p_passes_.size());
+
+    // walk back from the passes that produce visible or audible output
+    QVector<int> stack;
+    for (int i=0; i<p_passes_.size(); ++i)
+        if (p_passes_[i].type() == ShadertoyRenderPass::T_IMAGE
+         || p_passes_[i].type() == ShadertoyRenderPass::T_SOUND)
+        {
+            p_culled_[i] = false;
+            stack << i;
+        }
+
+    while (!stack.isEmpty())
+    {
+        const int to = stack.takeLast();
+        for (const Edge& e : p_edges_)
+            if (e.to == to && p_culled_[e.from])
+            {
+                p_culled_[e.from] = false;
+                stack << e.from;
+            }
+    }
+
+    p_order_.clear();
+    for (int i=0; i<p_passes_.size(); ++i)
+        if (!p_culled_[i])
+            p_order_ << i;
+
+    if (numCulled())
+        ST_DEBUG2("ShaderRenderGraph: " << numCulled() << " of "
+                  << p_passes_.size() << " passes culled");
+}
+
+int ShaderRenderGraph::inputPass(int pass, int channel) const
+{
+    for (const Edge& e : p_edges_)
+        if (e.to == pass && e.channel == channel)
+            return e.from;
+    return -1;
+}
+
+int ShaderRenderGraph::numFeedbackEdges() const
+{
+    int num = 0;
+    for (const Edge& e : p_edges_)
+        num += e.feedback;
+    return num;
+}
+
+QString ShaderRenderGraph::toString() const
+{
+    QString str;
+    QTextStream s(&str);
+
+    for (int i=0; i<p_passes_.size(); ++i)
+    {
+        const ShadertoyRenderPass& pass = p_passes_[i];
+        s << i << ": " << pass.name() << " (" << pass.typeName()
+          << ", output " << pass.outputId() << ")";
+        if (p_culled_[i])
+            s << " CULLED";
+        s << "\n";
+        for (const Edge& e : p_edges_)
+            if (e.to == i)
+                s << "    iChannel" << e.channel << " <- "
+                  << p_passes_[e.from].name()
+                  << (e.feedback ? " (previous frame)" : "") << "\n";
+    }
+
+    // the sound pass is not drawn per frame
+    int numDraws = 0;
+    for (const ShadertoyRenderPass& pass : p_passes_)
+        numDraws += pass.type() != ShadertoyRenderPass::T_SOUND;
+
+    s << "\n" << p_order_.size() << " of " << p_passes_.size()
+      << " passes used, " << numFeedbackEdges() << " feedback edges\n";
+    if (numDraws)
+        s << numCulled() << " full-screen draws culled, "
+          << (100 * numCulled() / numDraws)
+          << "% of the per-frame fragment work\n";
+    return str;
+}
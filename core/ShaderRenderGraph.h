@@ -0,0 +1,92 @@
+/***************************************************************************
+
+Copyright (C) 2016  stefan.berke @ modular-audio-graphics.com
+
+This source is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either
+version 3.0 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this software; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+****************************************************************************/
+
+#ifndef SHADERRENDERGRAPH_H
+#define SHADERRENDERGRAPH_H
+
+#include <QVector>
+#include <QString>
+
+#include "ShadertoyShader.h"
+
+/** Execution graph of the render passes of a shader.
+
+    Nodes are the passes, an edge goes from the pass writing a buffer
+    to each pass reading it in one of its channels.
+
+    Passes run in the order of shadertoy.com, buffers by name, then
+    the image and the sound pass. An edge whose producer does not run
+    before its consumer, including a buffer reading itself, is a
+    feedback edge and reads the previous frame. All other edges point
+    forward, so order() is topological with respect to the edges
+    within one frame.
+
+    Buffer passes whose output never reaches the image or sound pass
+    are culled and not part of order().
+*/
+class ShaderRenderGraph
+{
+public:
+    struct Edge
+    {
+        /** Indices into passes() */
+        int from, to;
+        /** Input slot of the consumer */
+        int channel;
+        /** Reads the output of the previous frame */
+        bool feedback;
+    };
+
+    ShaderRenderGraph() { }
+    explicit ShaderRenderGraph(const ShadertoyShader& shader) { build(shader); }
+
+    void build(const ShadertoyShader& shader);
+
+    // --- getter ---
+
+    /** All passes in execution order, including the culled ones */
+    const QVector<ShadertoyRenderPass>& passes() const { return p_passes_; }
+    int numPasses() const { return p_passes_.size(); }
+
+    /** Indices into passes() that need to run each frame */
+    const QVector<int>& order() const { return p_order_; }
+    const QVector<Edge>& edges() const { return p_edges_; }
+
+    /** Index of the pass writing input slot @p channel
+        of pass @p pass, or -1 */
+    int inputPass(int pass, int channel) const;
+
+    bool isCulled(int pass) const { return p_culled_[pass]; }
+    int numCulled() const { return p_passes_.size() - p_order_.size(); }
+    int numFeedbackEdges() const;
+
+    /** Multi-line description of passes, edges and culling */
+    QString toString() const;
+
+private:
+    void cull();
+
+    QVector<ShadertoyRenderPass> p_passes_;
+    QVector<Edge> p_edges_;
+    QVector<int> p_order_;
+    QVector<bool> p_culled_;
+};
+
+#endif // SHADERRENDERGRAPH_H
@@ -0,0 +1,252 @@
+/***************************************************************************
+
+Copyright (C) 2016  stefan.berke @ modular-audio-graphics.com
+
+This source is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either
+version 3.0 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this software; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+****************************************************************************/
+
+#include <algorithm>
+#include <vector>
+#include <iterator>
+
+#include <QHash>
+#include <QByteArray>
+#include <QReadWriteLock>
+#include <QReadLocker>
+#include <QWriteLocker>
+
+#include "ShaderSearchIndex.h"
+#include "ShadertoyShader.h"
+#include "log.h"
+
+namespace {
+
+    /** Sorted document numbers of one trigram */
+    struct Posting
+    {
+        Posting() : last(-1), count(0) { }
+        /** Varint-encoded differences to the previous document */
+        QByteArray data;
+        int last, count;
+    };
+
+    void appendVarint(QByteArray& data, quint32 v)
+    {
+        while (v >= 0x80)
+        {
+            data.append(char((v & 0x7f) | 0x80));
+            v >>= 7;
+        }
+        data.append(char(v));
+    }
+
+    void decode(const Posting& p, std::vector<int>& docs)
+    {
+        docs.clear();
+        docs.reserve(p.count);
+        auto d = reinterpret_cast<const uchar*>(p.data.constData()),
+             end = d + p.data.size();
+        int doc = -1;
+        while (d < end)
+        {
+            quint32 v = 0;
+            int shift = 0;
+            while (d < end)
+            {
+                const uchar b = *d++;
+                v |= quint32(b & 0x7f) << shift;
+                shift += 7;
+                if (!(b & 0x80))
+                    break;
+            }
+            doc += int(v);
+            docs.push_back(doc);
+        }
+    }
+
+    /** Same folding as QString::contains(..., Qt::CaseInsensitive) */
+    quint64 foldedChar(QChar c)
+    {
+        return c.toCaseFolded().unicode();
+    }
+
+    /** Appends all trigrams of the case-folded text */
+    void addTrigrams(const QString& text, std::vector<quint64>& keys)
+    {
+        if (text.size() < ShaderSearchIndex::minQueryLength)
+            return;
+        quint64 key = (foldedChar(text[0]) << 16) | foldedChar(text[1]);
+        for (int i=2; i<text.size(); ++i)
+        {
+            key = ((key << 16) | foldedChar(text[i])) & 0xffffffffffffULL;
+            keys.push_back(key);
+        }
+    }
+
+    void sortUnique(std::vector<quint64>& keys)
+    {
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    }
+
+} // namespace
+
+struct ShaderSearchIndex::Private
+{
+    Private()
+        : numDocs   (0)
+    { }
+
+    mutable QReadWriteLock lock;
+    QHash<QString, int> docs;
+    QHash<quint64, Posting> postings;
+    int numDocs;
+};
+
+ShaderSearchIndex::ShaderSearchIndex()
+    : p_    (new Private())
+{
+}
+
+ShaderSearchIndex::~ShaderSearchIndex()
+{
+    delete p_;
+}
+
+int ShaderSearchIndex::numDocuments() const
+{
+    QReadLocker lock(&p_->lock);
+    return p_->numDocs;
+}
+
+int ShaderSearchIndex::numShaders() const
+{
+    QReadLocker lock(&p_->lock);
+    return p_->docs.size();
+}
+
+size_t ShaderSearchIndex::memoryUsage() const
+{
+    QReadLocker lock(&p_->lock);
+    size_t bytes = sizeof(Private)
+            + size_t(p_->docs.size()) * 64
+            + size_t(p_->postings.size()) * (sizeof(Posting) + 32);
+    for (const Posting& p : p_->postings)
+        bytes += p.data.capacity();
+    return bytes;
+}
+
+int ShaderSearchIndex::document(const QString& shaderId) const
+{
+    QReadLocker lock(&p_->lock);
+    return p_->docs.value(shaderId, -1);
+}
+
+void ShaderSearchIndex::clear()
+{
+    QWriteLocker lock(&p_->lock);
+    p_->docs.clear();
+    p_->postings.clear();
+    p_->numDocs = 0;
+}
+
+void ShaderSearchIndex::swap(ShaderSearchIndex& other)
+{
+    if (&other == this)
+        return;
+    QWriteLocker lock(&p_->lock);
+    QWriteLocker lockOther(&other.p_->lock);
+    p_->docs.swap(other.p_->docs);
+    p_->postings.swap(other.p_->postings);
+    std::swap(p_->numDocs, other.p_->numDocs);
+}
+
+void ShaderSearchIndex::add(const ShadertoyShader& shader)
+{
+    const ShadertoyShaderInfo& info = shader.info();
+
+    std::vector<quint64> keys;
+    addTrigrams(info.id, keys);
+    addTrigrams(info.name, keys);
+    addTrigrams(info.username, keys);
+    addTrigrams(info.description, keys);
+    for (const QString& tag : info.tags)
+        addTrigrams(tag, keys);
+    for (size_t i=0; i<shader.numRenderPasses(); ++i)
+        addTrigrams(shader.renderPass(i).fragmentSource(), keys);
+    sortUnique(keys);
+
+    QWriteLocker lock(&p_->lock);
+
+    const int doc = p_->numDocs++;
+    p_->docs.insert(info.id, doc);
+
+    for (quint64 key : keys)
+    {
+        Posting& p = p_->postings[key];
+        appendVarint(p.data, quint32(doc - p.last));
+        p.last = doc;
+        ++p.count;
+    }
+}
+
+bool ShaderSearchIndex::query(
+        const QString& text, QVector<int>& documents) const
+{
+    documents.clear();
+
+    if (text.size() < minQueryLength)
+        return false;
+
+    std::vector<quint64> keys;
+    addTrigrams(text, keys);
+    sortUnique(keys);
+
+    QReadLocker lock(&p_->lock);
+
+    // rarest trigrams first, to keep the intersection small
+    std::vector<const Posting*> lists;
+    lists.reserve(keys.size());
+    for (quint64 key : keys)
+    {
+        auto i = p_->postings.constFind(key);
+        if (i == p_->postings.constEnd())
+            return true;
+        lists.push_back(&i.value());
+    }
+    std::sort(lists.begin(), lists.end(),
+              [](const Posting* l, const Posting* r)
+    {
+        return l->count < r->count;
+    });
+
+    std::vector<int> result, next, tmp;
+    decode(*lists[0], result);
+    for (size_t i=1; i<lists.size() && !result.empty(); ++i)
+    {
+        decode(*lists[i], next);
+        tmp.clear();
+        std::set_intersection(result.begin(), result.end(),
+                              next.begin(), next.end(),
+                              std::back_inserter(tmp));
+        result.swap(tmp);
+    }
+
+    documents.reserve(int(result.size()));
+    for (int doc : result)
+        documents << doc;
+    return true;
+}
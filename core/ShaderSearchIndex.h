@@ -0,0 +1,87 @@
+/***************************************************************************
+
+Copyright (C) 2016  stefan.berke @ modular-audio-graphics.com
+
+This source is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either
+version 3.0 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this software; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+****************************************************************************/
+
+#ifndef SHADERSEARCHINDEX_H
+#define SHADERSEARCHINDEX_H
+
+#include <QString>
+#include <QVector>
+
+class ShadertoyShader;
+
+/** Trigram index over the searchable text of shaders.
+
+    The text is the id, name, user, description, tags and the source
+    of all passes, case-folded like QString::contains() with
+    Qt::CaseInsensitive. Each shader gets a document number,
+    for each trigram a sorted list of document numbers is stored,
+    delta- and varint-encoded.
+
+    query() returns a superset of the shaders containing a substring,
+    the result must be verified with ShadertoyShader::containsString().
+
+    <b>All methods are threadsafe</b>
+*/
+class ShaderSearchIndex
+{
+public:
+    ShaderSearchIndex();
+    ~ShaderSearchIndex();
+
+    /** Minimum length of a query to narrow the result */
+    static const int minQueryLength = 3;
+
+    /** Number of document numbers handed out so far.
+        All document numbers are below this value. */
+    int numDocuments() const;
+    /** Number of indexed shaders */
+    int numShaders() const;
+    /** Approximate memory use in bytes */
+    size_t memoryUsage() const;
+
+    /** Document number of the shader id, or -1 if not indexed */
+    int document(const QString& shaderId) const;
+
+    /** Collects the sorted document numbers of all shaders that
+        might contain @p text.
+        Returns false if the text is too short to use the index,
+        in which case every shader is a candidate. */
+    bool query(const QString& text, QVector<int>& documents) const;
+
+    // --- setter ---
+
+    void clear();
+
+    /** Adds or replaces a shader. The render passes must be loaded.
+        A replaced shader gets a new document number. */
+    void add(const ShadertoyShader& shader);
+
+    /** Exchanges the contents with another index */
+    void swap(ShaderSearchIndex& other);
+
+private:
+    ShaderSearchIndex(const ShaderSearchIndex&) = delete;
+    void operator=(const ShaderSearchIndex&) = delete;
+
+    struct Private;
+    Private* p_;
+};
+
+#endif // SHADERSEARCHINDEX_H
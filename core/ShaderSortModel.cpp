@@ -8,29 +8,519 @@
     <p>created 5/31/2016</p>
 */
 
+#include <algorithm>
+
+#include <QStringList>
+#include <QBitArray>
+#include <QAtomicInt>
+#include <QCache>
+#include <QHash>
+#include <QElapsedTimer>
+#include <QFutureWatcher>
+#include <QThread>
+#include <QtConcurrent/QtConcurrentRun>
+#include <QtConcurrent/QtConcurrentMap>
+
 #include "ShaderSortModel.h"
 #include "ShaderListModel.h"
 #include "ShadertoyShader.h"
+#include "ShadertoyApi.h"
+#include "ShaderSearchIndex.h"
+#include "ShaderQuery.h"
+#include "log.h"
+
+namespace {
+
+    struct FilterResult
+    {
+        FilterResult()
+            : generation(0), revision(0), numAccepted(0), numTested(0),
+              ms(0.), cancelled(false) { }
+        /** ShaderQuery::toString() */
+        QString key;
+        /** Substrings of a plain-text query, for isRefinement() */
+        QStringList terms;
+        /** One bit per source row */
+        QBitArray accepted;
+        int generation,
+        /** ShaderSortModel::Private::rowsRevision of the snapshot */
+            revision,
+            numAccepted, numTested;
+        double ms;
+        bool cancelled;
+    };
+
+    /** Runs in a worker thread.
+        If @p base is not empty, only rows with a set bit are tested.
+        Stops before the next row when @p generation is not @p gen
+        anymore, so a superseded filter loads no further bodies. */
+    FilterResult runFilter(const QVector<ShaderHandle>& rows,
+                           const ShaderQuery& query,
+                           const QBitArray& base,
+                           const ShadertoyApi* api,
+                           const QAtomicInt* generation, int gen, int rev)
+    {
+        QElapsedTimer timer;
+        timer.start();
+
+        FilterResult r;
+        r.key = query.toString();
+        if (query.isPlainText())
+            r.terms = query.textTerms();
+        r.generation = gen;
+        r.revision = rev;
+        r.accepted.resize(rows.size());
+        const bool useBase = base.size() == rows.size();
+
+        // candidates from the search index
+        const ShaderSearchIndex& index = api->searchIndex();
+        QBitArray candidates;
+        QStringList terms;
+        bool useIndex = index.numShaders() > 0 && query.indexTerms(terms);
+        if (useIndex)
+        {
+            candidates.resize(index.numDocuments());
+            QVector<int> docs;
+            for (const QString& s : terms)
+            {
+                // too short to use the index
+                if (!index.query(s, docs))
+                {
+                    useIndex = false;
+                    break;
+                }
+                for (int doc : docs)
+                    candidates.setBit(doc);
+            }
+        }
+
+        for (int i=0; i<rows.size(); ++i)
+        {
+            if (generation->load() != gen)
+            {
+                r.cancelled = true;
+                return r;
+            }
+
+            if (useBase && !base.testBit(i))
+                continue;
+
+            const ShadertoyShader& row = *rows[i];
+            ++r.numTested;
+
+            // numeric, boolean and info clauses
+            const ShaderQuery::Match m = query.matchInfo(row.info());
+            if (m == ShaderQuery::M_NO)
+                continue;
+            if (m == ShaderQuery::M_YES)
+            {
+                r.accepted.setBit(i);
+                ++r.numAccepted;
+                continue;
+            }
+
+            // shaders added after the index query are checked below
+            if (useIndex)
+            {
+                const int doc = index.document(row.info().id);
+                if (doc >= 0 && doc < candidates.size()
+                        && !candidates.testBit(doc))
+                    continue;
+            }
+
+            ShadertoyShader shader = row;
+            if (row.isInfoOnly())
+            {
+                shader = api->loadShaderBody(row.info().id);
+                if (!shader.isValid())
+                    shader = row;
+            }
+
+            if (query.matches(shader))
+            {
+                r.accepted.setBit(i);
+                ++r.numAccepted;
+            }
+        }
+
+        r.ms = double(timer.nsecsElapsed()) / 1.e6;
+        return r;
+    }
+
+    /** Position of each row when sorted ascending by @p keys,
+        ties are kept in row order.
+        Chunks are sorted in parallel and merged pairwise. */
+    QVector<int> sortRank(const QVector<qint64>& keys)
+    {
+        const int num = keys.size();
+        QVector<int> perm(num);
+        int* rows = perm.data();
+        for (int i=0; i<num; ++i)
+            rows[i] = i;
+
+        const qint64* k = keys.constData();
+        auto less = [=](int l, int r)
+        {
+            return k[l] < k[r] || (k[l] == k[r] && l < r);
+        };
+
+        struct Range { int begin, mid, end; };
+        const int numChunks = num < 16384
+                ? 1 : std::max(1, QThread::idealThreadCount());
+        QVector<Range> ranges;
+        for (int i=0; i<numChunks; ++i)
+        {
+            Range r;
+            r.begin = r.mid = qint64(num) * i / numChunks;
+            r.end = qint64(num) * (i + 1) / numChunks;
+            ranges << r;
+        }
+
+        QtConcurrent::blockingMap(ranges, [=](Range& r)
+        {
+            std::sort(rows + r.begin, rows + r.end, less);
+        });
+
+        while (ranges.size() > 1)
+        {
+            QVector<Range> merged;
+            for (int i=0; i+1<ranges.size(); i+=2)
+            {
+                Range r;
+                r.begin = ranges[i].begin;
+                r.mid = ranges[i].end;
+                r.end = ranges[i+1].end;
+                merged << r;
+            }
+            QtConcurrent::blockingMap(merged, [=](Range& r)
+            {
+                std::inplace_merge(rows + r.begin, rows + r.mid,
+                                   rows + r.end, less);
+            });
+            if (ranges.size() & 1)
+                merged << ranges.last();
+            ranges.swap(merged);
+        }
+
+        QVector<int> rank(num);
+        for (int i=0; i<num; ++i)
+            rank[rows[i]] = i;
+        return rank;
+    }
+
+    struct SortResult
+    {
+        QVector<int> rank;
+        /** The snapshot the rank belongs to */
+        QVector<ShaderHandle> rows;
+        int column, generation, revision;
+        Qt::SortOrder order;
+    };
+
+    /** Lists up to this size are sorted in the GUI thread */
+    const int maxSyncSortRows = 20000;
+
+    /** Background sorts started again because the rows changed,
+        e.g. during mergeWithWeb(), before the order is kept */
+    const int maxSortRestarts = 4;
+
+    /** A previous result of the filter */
+    struct CachedResult
+    {
+        QBitArray accepted;
+        int numAccepted;
+        /** See FilterResult::terms */
+        QStringList terms;
+    };
+
+    /** Every shader matching @p filters also matches @p previous:
+        each new term contains one of the previous terms.
+        Compared case-sensitive because ids are matched that way. */
+    bool isRefinement(const QStringList& filters,
+                      const QStringList& previous)
+    {
+        for (const QString& f : filters)
+        {
+            bool found = false;
+            for (const QString& prev : previous)
+                if (f.contains(prev, Qt::CaseSensitive))
+                {
+                    found = true;
+                    break;
+                }
+            if (!found)
+                return false;
+        }
+        return true;
+    }
+
+} // namespace
+
+struct ShaderSortModel::Private
+{
+    Private(ShaderSortModel* p)
+        : p             (p)
+        , hasResult     (false)
+        , generation    (0)
+        , rowsRevision  (0)
+        , watcher       (new QFutureWatcher<FilterResult>())
+        , resultCache   (16)
+        , rankColumn    (-1)
+        , rankRevision  (-1)
+        , sortGeneration(0)
+        , sortRestarts  (0)
+        , sortWatcher   (new QFutureWatcher<SortResult>())
+    {
+        connect(watcher, &QFutureWatcher<FilterResult>::finished,
+                p, [=](){ onFilterFinished(); });
+        connect(sortWatcher, &QFutureWatcher<SortResult>::finished,
+                p, [=](){ onSortFinished(); });
+    }
+
+    ~Private()
+    {
+        generation.fetchAndAddOrdered(1);
+        for (QFuture<FilterResult>& f : running)
+            f.waitForFinished();
+        delete watcher;
+        delete sortWatcher;
+    }
+
+    ShaderListModel* srcModel() const
+        { return qobject_cast<ShaderListModel*>(p->sourceModel()); }
+
+    void startFilter();
+    void onFilterFinished();
+    void applyResult(const QBitArray& bits, int numAccepted, double ms);
+    /** Smallest cached result that the query refines, or NULL */
+    const CachedResult* findBase() const;
+    void sort(int column, Qt::SortOrder order);
+    void onSortFinished();
+    /** Moves the rank of an older snapshot to the current rows,
+        rows that are not in the snapshot go last */
+    QVector<int> mapRank(const SortResult& r) const;
+    void applySort(const QVector<int>& rank, int column, int revision,
+                   Qt::SortOrder order);
+
+    ShaderSortModel* p;
+
+    ShaderQuery query;
+    /** Result of the last finished filter, one bit per source row */
+    QBitArray accepted;
+    bool hasResult;
+
+    /** Increased for each new filter, running filters with
+        an older value stop */
+    QAtomicInt generation;
+    /** Increased when the source rows or their filtered values
+        change, results of an older revision are dropped */
+    int rowsRevision;
+    QFutureWatcher<FilterResult>* watcher;
+    /** All started filters, they use the api */
+    QList<QFuture<FilterResult>> running;
+
+    QList<QMetaObject::Connection> sourceConnections;
+
+    /** Recent results by ShaderQuery::toString(), cleared when the rows change */
+    QCache<QString, CachedResult> resultCache;
+
+    /** Sorted position of each source row for rankColumn,
+        cleared when the rows change */
+    QVector<int> rank;
+    int rankColumn, rankRevision;
+    /** Increased for each sort, older results are dropped */
+    int sortGeneration;
+    /** Restarts of the current background sort */
+    int sortRestarts;
+    QFutureWatcher<SortResult>* sortWatcher;
+};
 
 ShaderSortModel::ShaderSortModel(QObject *parent)
     : QSortFilterProxyModel (parent)
+    , p_                    (new Private(this))
 {
 
 }
 
+ShaderSortModel::~ShaderSortModel()
+{
+    delete p_;
+}
+
+bool ShaderSortModel::isFiltering() const
+{
+    return p_->watcher->isRunning();
+}
+
+void ShaderSortModel::setSourceModel(QAbstractItemModel* model)
+{
+    for (const QMetaObject::Connection& c : p_->sourceConnections)
+        disconnect(c);
+    p_->sourceConnections.clear();
+
+    QSortFilterProxyModel::setSourceModel(model);
+
+    if (!model)
+        return;
+
+    // rerun the filter when rows change
+    auto restart = [=]()
+    {
+        ++p_->rowsRevision;
+        p_->resultCache.clear();
+        if (!p_->query.isEmpty())
+            p_->startFilter();
+    };
+    p_->sourceConnections
+        << connect(model, &QAbstractItemModel::modelReset, this, restart)
+        << connect(model, &QAbstractItemModel::rowsInserted, this, restart)
+        << connect(model, &QAbstractItemModel::rowsRemoved, this, restart)
+        << connect(model, &QAbstractItemModel::dataChanged, this,
+                   [=](const QModelIndex& topLeft, const QModelIndex& bottomRight,
+                       const QVector<int>& roles)
+        {
+            // compile results are not part of the filter
+            auto src = p_->srcModel();
+            if (src && topLeft.column() == bottomRight.column()
+                    && src->columnId(topLeft.column())
+                        == ShaderListModel::C_COMPILES)
+                return;
+            // thumbnails don't change the filter result
+            if (roles.isEmpty() || roles.contains(Qt::DisplayRole))
+                restart();
+        });
+
+    // document numbers changed, results stay valid
+    if (auto srcModel = qobject_cast<ShaderListModel*>(model))
+        p_->sourceConnections
+            << connect(srcModel->api(), &ShadertoyApi::searchIndexChanged,
+                       this, [=]()
+            {
+                if (!p_->query.isEmpty() && p_->watcher->isRunning())
+                    p_->startFilter();
+            });
+}
 
 void ShaderSortModel::setFulltextFilter(const QString &s)
 {
-    p_fulltextFilters_.clear();
-    auto list = s.split(";");
-    for (QString s : list)
+    p_->query = ShaderQuery(s);
+    p_->startFilter();
+}
+
+void ShaderSortModel::Private::startFilter()
+{
+    const int gen = generation.fetchAndAddOrdered(1) + 1;
+
+    auto src = srcModel();
+    if (query.isEmpty() || !src)
+    {
+        hasResult = false;
+        accepted.clear();
+        p->invalidateFilter();
+        emit p->filterFinished(p->rowCount(), 0.);
+        return;
+    }
+
+    ST_DEBUG2("ShaderSortModel::startFilter(" << query.toString() << ")");
+
+    // backspacing or repeating a query
+    if (auto cached = resultCache.object(query.toString()))
+    {
+        if (cached->accepted.size() == src->rowCount(QModelIndex()))
+        {
+            // a running filter is ignored by the generation check
+            applyResult(cached->accepted, cached->numAccepted, 0.);
+            return;
+        }
+    }
+
+    // only test rows accepted by a broader query
+    QBitArray base;
+    if (auto b = findBase())
+        base = b->accepted;
+
+    for (auto i = running.begin(); i != running.end(); )
+    {
+        if (i->isFinished())
+            i = running.erase(i);
+        else
+            ++i;
+    }
+
+    // snapshot for the worker thread
+    const QVector<ShaderHandle> rows = src->shaders();
+    const ShaderQuery q = query;
+    const ShadertoyApi* api = src->api();
+    const QAtomicInt* g = &generation;
+    const int rev = rowsRevision;
+
+    auto future = QtConcurrent::run([=]()
+    {
+        return runFilter(rows, q, base, api, g, gen, rev);
+    });
+    running << future;
+    watcher->setFuture(future);
+
+    emit p->filterStarted();
+}
+
+void ShaderSortModel::Private::onFilterFinished()
+{
+    const FilterResult r = watcher->result();
+    if (r.cancelled || r.generation != generation.load())
+        return;
+    // tested on rows that were replaced since
+    if (r.revision != rowsRevision)
+        return;
+
+    // the rows changed in the meantime
+    auto src = srcModel();
+    if (!src || r.accepted.size() != src->rowCount(QModelIndex()))
     {
-        s = s.simplified();
-        if (!s.isEmpty())
-            p_fulltextFilters_ << s;
+        startFilter();
+        return;
     }
 
-    invalidate();
+    ST_DEBUG2("ShaderSortModel: " << r.numAccepted << " of "
+              << r.accepted.size() << " accepted, " << r.numTested
+              << " tested in " << r.ms << " ms");
+
+    auto cached = new CachedResult;
+    cached->accepted = r.accepted;
+    cached->numAccepted = r.numAccepted;
+    cached->terms = r.terms;
+    resultCache.insert(r.key, cached);
+
+    applyResult(r.accepted, r.numAccepted, r.ms);
+}
+
+void ShaderSortModel::Private::applyResult(
+        const QBitArray& bits, int numAccepted, double ms)
+{
+    accepted = bits;
+    hasResult = true;
+    p->invalidateFilter();
+
+    emit p->filterFinished(numAccepted, ms);
+}
+
+const CachedResult* ShaderSortModel::Private::findBase() const
+{
+    // other queries are only reused when repeated
+    if (!query.isPlainText())
+        return nullptr;
+    const QStringList terms = query.textTerms();
+
+    const CachedResult* base = nullptr;
+    for (const QString& key : resultCache.keys())
+    {
+        auto c = resultCache.object(key);
+        if (c->terms.isEmpty() || !isRefinement(terms, c->terms))
+            continue;
+        if (!base || c->numAccepted < base->numAccepted)
+            base = c;
+    }
+    return base;
 }
 
 bool ShaderSortModel::filterAcceptsRow(
@@ -40,22 +530,137 @@ bool ShaderSortModel::filterAcceptsRow(
                 source_row, source_parent))
         return false;
 
-    if (p_fulltextFilters_.isEmpty())
+    if (p_->query.isEmpty() || !p_->hasResult)
         return true;
 
-    auto srcModel = qobject_cast<ShaderListModel*>(sourceModel());
-    if (!srcModel)
-        return false;
+    // new rows stay visible until the filter is finished
+    if (source_row < 0 || source_row >= p_->accepted.size())
+        return true;
 
-    if (source_row < 0
-     || source_row >= srcModel->rowCount(QModelIndex()))
-        return false;
+    return p_->accepted.testBit(source_row);
+}
 
-    const ShadertoyShader& shader = srcModel->getShader(source_row);
+void ShaderSortModel::sort(int column, Qt::SortOrder order)
+{
+    p_->sortRestarts = 0;
+    p_->sort(column, order);
+}
+
+void ShaderSortModel::Private::sort(int column, Qt::SortOrder order)
+{
+    ++sortGeneration;
+
+    auto src = srcModel();
+    const auto id = src ? src->columnId(column)
+                        : ShaderListModel::C_NUM_COLUMN_IDS;
+    if (id == ShaderListModel::C_NUM_COLUMN_IDS
+            || id == ShaderListModel::C_IMAGE)
+    {
+        p->QSortFilterProxyModel::sort(column, order);
+        return;
+    }
+
+    // ranks of the column are still valid
+    if (column == rankColumn && rankRevision == src->revision())
+    {
+        p->QSortFilterProxyModel::sort(column, order);
+        return;
+    }
+
+    const int numRows = src->rowCount(QModelIndex());
+    if (numRows <= maxSyncSortRows)
+    {
+        applySort(sortRank(src->sortKeys(column)), column,
+                  src->revision(), order);
+        return;
+    }
+
+    ST_DEBUG2("ShaderSortModel::sort(" << column << ") in background");
+
+    // keys are built from a snapshot in the worker,
+    // except the compile results, which only the gui thread may read
+    const QVector<ShaderHandle> rows = src->shaders();
+    const QVector<qint64> keys = id == ShaderListModel::C_COMPILES
+            ? src->sortKeys(column) : QVector<qint64>();
+    const int gen = sortGeneration,
+              rev = src->revision();
+    sortWatcher->setFuture(QtConcurrent::run([=]()
+    {
+        SortResult r;
+        r.rank = sortRank(id == ShaderListModel::C_COMPILES
+                          ? keys : ShaderListModel::createSortKeys(rows, id));
+        r.rows = rows;
+        r.column = column;
+        r.order = order;
+        r.generation = gen;
+        r.revision = rev;
+        return r;
+    }));
+}
+
+void ShaderSortModel::Private::onSortFinished()
+{
+    const SortResult r = sortWatcher->result();
+    auto src = srcModel();
+    if (r.generation != sortGeneration || !src)
+        return;
+    if (r.revision == src->revision())
+    {
+        applySort(r.rank, r.column, r.revision, r.order);
+        return;
+    }
+
+    // the rows changed in the meantime, show the order of the
+    // snapshot and sort again, unless the rows keep changing
+    applySort(mapRank(r), r.column, src->revision(), r.order);
+    if (++sortRestarts <= maxSortRestarts)
+        sort(r.column, r.order);
+    else
+        ST_DEBUG("ShaderSortModel: rows keep changing, "
+                 "keeping the order of an older snapshot");
+}
+
+QVector<int> ShaderSortModel::Private::mapRank(const SortResult& r) const
+{
+    QHash<QString, int> oldRank;
+    oldRank.reserve(r.rows.size());
+    for (int i=0; i<r.rows.size(); ++i)
+        oldRank.insert(r.rows[i]->info().id, r.rank[i]);
+
+    const QVector<ShaderHandle>& rows = srcModel()->shaders();
+    QVector<int> rank(rows.size());
+    for (int i=0; i<rows.size(); ++i)
+        rank[i] = oldRank.value(rows[i]->info().id, r.rows.size() + i);
+    return rank;
+}
 
-    for (const auto & s : p_fulltextFilters_)
-        if (shader.containsString(s))
-            return true;
+void ShaderSortModel::Private::applySort(
+        const QVector<int>& r, int column, int revision, Qt::SortOrder order)
+{
+    rank = r;
+    rankColumn = column;
+    rankRevision = revision;
+    p->QSortFilterProxyModel::sort(column, order);
+}
+
+bool ShaderSortModel::lessThan(
+        const QModelIndex& left, const QModelIndex& right) const
+{
+    const int l = left.row(), r = right.row(),
+              column = left.column();
+
+    auto src = p_->srcModel();
+    if (src && column == p_->rankColumn
+            && p_->rankRevision == src->revision())
+        return p_->rank[l] < p_->rank[r];
+
+    // after the rows changed, until the next sort()
+    if (src)
+    {
+        const QVector<qint64>& keys = src->sortKeys(column);
+        if (l < keys.size() && r < keys.size())
+            return keys[l] < keys[r];
+    }
 
-    return false;
+    return QSortFilterProxyModel::lessThan(left, right);
 }
@@ -12,24 +12,58 @@
 #define SHADERSORTMODEL_H
 
 #include <QSortFilterProxyModel>
-#include <QStringList>
 
 class ShaderSortModel : public QSortFilterProxyModel
 {
     Q_OBJECT
 public:
     explicit ShaderSortModel(QObject *parent = 0);
+    ~ShaderSortModel();
 
-    void setFulltextFilter(const QString&);
+    /** The full-text filter is running in the background */
+    bool isFiltering() const;
+
+    /** Accepts shaders matching the ShaderQuery @p text,
+        e.g. any of the ';'-separated strings or field clauses
+        like <tt>user:iq likes>100 -uses:keyboard</tt>.
+
+        The filter runs in a worker thread over a snapshot of the
+        source model, a new call cancels the running filter.
+        Info clauses are tested first, rows that need a source scan
+        are narrowed with the api's ShaderSearchIndex.
+        If the terms refine a recent query, only the rows accepted
+        by it are tested, recent results are reused directly.
+        Until filterFinished() the previous result stays visible. */
+    void setFulltextFilter(const QString& text);
+
+    void setSourceModel(QAbstractItemModel* model) override;
+
+    /** Sorts by the columnar keys of the ShaderListModel.
+        For large lists the permutation is computed in worker
+        threads and applied when ready, the previous order
+        stays visible until then. */
+    void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override;
+
+signals:
+
+    /** A full-text filter started running */
+    void filterStarted();
+    /** The result of the full-text filter has been applied,
+        @p numAccepted shaders matched in @p ms milliseconds */
+    void filterFinished(int numAccepted, double ms);
 
 protected:
 
     bool filterAcceptsRow(
             int source_row, const QModelIndex &source_parent) const override;
 
-private:
+    /** Compares the precomputed rank or sort key of the rows */
+    bool lessThan(const QModelIndex& left,
+                  const QModelIndex& right) const override;
 
-    QStringList p_fulltextFilters_;
+private:
+    struct Private;
+    Private* p_;
 };
 
 #endif // SHADERSORTMODEL_H
@@ -0,0 +1,202 @@
+/***************************************************************************
+
+Copyright (C) 2016  stefan.berke @ modular-audio-graphics.com
+
+This source is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either
+version 3.0 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this software; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+****************************************************************************/
+
+#include <QFile>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QCryptographicHash>
+
+#include "ShaderValidationResults.h"
+#include "ShadertoyShader.h"
+#include "ShadertoyRenderer.h"
+#include "log.h"
+
+namespace {
+
+    const quint32 resultsMagic = 0x53545652; // "STVR"
+
+} // namespace
+
+const quint32 ShaderValidationResults::schemaVersion = 2;
+
+ShaderValidationResults::ShaderValidationResults()
+    : p_modified_   (false)
+{
+}
+
+const ShaderValidationResults::Entry* ShaderValidationResults::find(
+        const QString& id) const
+{
+    auto i = p_entries_.constFind(id);
+    return i == p_entries_.constEnd() ? nullptr : &i.value();
+}
+
+QByteArray ShaderValidationResults::hash(const ShadertoyShader& shader)
+{
+    QCryptographicHash h(QCryptographicHash::Md5);
+    h.addData(ShadertoyRenderer::vertexSource().toUtf8());
+    for (const ShadertoyRenderPass& pass : shader.sortedRenderPasses())
+        h.addData(ShadertoyRenderer::fragmentSource(pass).toUtf8());
+    return h.result();
+}
+
+QString ShaderValidationResults::statusName(Status s)
+{
+    switch (s)
+    {
+        case S_UNKNOWN: break;
+        case S_OK: return "ok";
+        case S_COMPILE_ERROR: return "compile error";
+        case S_LINK_ERROR: return "link error";
+        case S_NOT_LOADED: return "not loaded";
+        case S_CRASHED: return "crashed";
+    }
+    return QString();
+}
+
+void ShaderValidationResults::clear()
+{
+    if (!p_entries_.isEmpty())
+        p_modified_ = true;
+    p_entries_.clear();
+}
+
+void ShaderValidationResults::setDriver(const QString& driver)
+{
+    if (driver == p_driver_)
+        return;
+    if (!p_entries_.isEmpty())
+        ST_INFO("Shader validation results of '" << p_driver_
+                << "' dropped for '" << driver << "'");
+    p_entries_.clear();
+    p_driver_ = driver;
+    p_modified_ = true;
+}
+
+void ShaderValidationResults::insert(const Entry& e)
+{
+    p_entries_.insert(e.id, e);
+    p_modified_ = true;
+}
+
+void ShaderValidationResults::retain(const QSet<QString>& ids)
+{
+    for (auto i = p_entries_.begin(); i != p_entries_.end(); )
+    {
+        if (ids.contains(i.key()))
+            ++i;
+        else
+        {
+            i = p_entries_.erase(i);
+            p_modified_ = true;
+        }
+    }
+}
+
+bool ShaderValidationResults::load(const QString& filename)
+{
+    ST_DEBUG2("ShaderValidationResults::load('" << filename << "')");
+
+    p_entries_.clear();
+    p_driver_.clear();
+    p_modified_ = false;
+
+    QFile file(filename);
+    if (!file.open(QFile::ReadOnly))
+    {
+        ST_DEBUG("No shader validation results '" << filename << "'");
+        return false;
+    }
+
+    QDataStream s(&file);
+    s.setVersion(QDataStream::Qt_5_0);
+    s.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+    quint32 magic, version;
+    qint32 count;
+    s >> magic >> version >> count;
+    if (s.status() != QDataStream::Ok || magic != resultsMagic || count < 0)
+    {
+        ST_WARN("Shader validation results '" << filename << "' are corrupt");
+        return false;
+    }
+    if (version != schemaVersion)
+    {
+        ST_INFO("Shader validation results '" << filename << "' have schema "
+                << version << ", expected " << schemaVersion);
+        return false;
+    }
+
+    s >> p_driver_;
+
+    // the count is not reserved, it may be corrupt
+    for (qint32 k=0; k<count && s.status() == QDataStream::Ok; ++k)
+    {
+        Entry e;
+        qint32 status;
+        s >> e.id >> e.hash >> status >> e.log >> e.compileMs >> e.linkMs;
+        e.status = Status(status);
+        p_entries_.insert(e.id, e);
+    }
+
+    if (s.status() != QDataStream::Ok || p_entries_.size() != count)
+    {
+        ST_WARN("Shader validation results '" << filename << "' are corrupt");
+        p_entries_.clear();
+        p_driver_.clear();
+        return false;
+    }
+
+    return true;
+}
+
+bool ShaderValidationResults::save(const QString& filename)
+{
+    ST_DEBUG2("ShaderValidationResults::save('" << filename << "')");
+
+    QSaveFile file(filename);
+    if (!file.open(QFile::WriteOnly))
+    {
+        ST_ERROR("Could not create shader validation results '" << filename
+                 << "', " << file.errorString());
+        return false;
+    }
+
+    QDataStream s(&file);
+    s.setVersion(QDataStream::Qt_5_0);
+    // compile times as 32 bit
+    s.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+    s << resultsMagic << schemaVersion << qint32(p_entries_.size())
+      << p_driver_;
+    for (const Entry& e : p_entries_)
+        s << e.id << e.hash << qint32(e.status) << e.log
+          << e.compileMs << e.linkMs;
+
+    if (!file.commit())
+    {
+        ST_ERROR("Could not write shader validation results '" << filename
+                 << "', " << file.errorString());
+        return false;
+    }
+
+    p_modified_ = false;
+    return true;
+}
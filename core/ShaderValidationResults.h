@@ -0,0 +1,119 @@
+/***************************************************************************
+
+Copyright (C) 2016  stefan.berke @ modular-audio-graphics.com
+
+This source is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either
+version 3.0 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this software; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+****************************************************************************/
+
+#ifndef SHADERVALIDATIONRESULTS_H
+#define SHADERVALIDATIONRESULTS_H
+
+#include <QHash>
+#include <QSet>
+#include <QString>
+#include <QByteArray>
+
+class ShadertoyShader;
+
+/** Persistent compile results of ShaderValidator.
+
+    For each shader id it stores the status, the compiler log and
+    the time spent compiling and linking, together with a hash of the
+    compiled sources, so unchanged shaders need not be compiled again.
+    The results depend on the OpenGL driver, so they are stored with
+    the driver() and setDriver() drops them when the driver changes.
+
+    All const methods are threadsafe as long as no non-const
+    method is called concurrently.
+*/
+class ShaderValidationResults
+{
+public:
+    enum Status
+    {
+        S_UNKNOWN,
+        S_OK,
+        S_COMPILE_ERROR,
+        S_LINK_ERROR,
+        /** The json could not be loaded */
+        S_NOT_LOADED,
+        /** Crashed or hung the validating process,
+            the shader is on the render blocklist */
+        S_CRASHED
+    };
+
+    struct Entry
+    {
+        Entry() : status(S_UNKNOWN), compileMs(0.f), linkMs(0.f) { }
+        QString id;
+        /** See hash() */
+        QByteArray hash;
+        Status status;
+        /** Compiler or linker log of the first failing pass */
+        QString log;
+        /** Sum over all passes in milliseconds */
+        float compileMs, linkMs;
+    };
+
+    /** Increase whenever the file layout changes */
+    static const quint32 schemaVersion;
+
+    ShaderValidationResults();
+
+    int size() const { return p_entries_.size(); }
+    /** There are changes that are not saved */
+    bool isModified() const { return p_modified_; }
+
+    /** Vendor, renderer and version of the OpenGL driver
+        that produced the results */
+    const QString& driver() const { return p_driver_; }
+
+    /** Returns the entry for the shader id, or NULL */
+    const Entry* find(const QString& id) const;
+
+    /** Calculates the hash of all sources the renderer
+        would compile for @p shader */
+    static QByteArray hash(const ShadertoyShader& shader);
+
+    /** Short readable name of the status */
+    static QString statusName(Status s);
+
+    // --- setter ---
+
+    void clear();
+    /** Sets the driver of the results. All entries are
+        removed when @p driver differs from the previous one. */
+    void setDriver(const QString& driver);
+    void insert(const Entry& e);
+    /** Removes all entries whose id is not in @p ids */
+    void retain(const QSet<QString>& ids);
+
+    // --- io ---
+
+    /** Reads the results.
+        Returns false, and leaves the results empty,
+        when the file is missing, corrupt or has a different schema. */
+    bool load(const QString& filename);
+    /** Writes the results and clears the modified flag */
+    bool save(const QString& filename);
+
+private:
+    QHash<QString, Entry> p_entries_;
+    QString p_driver_;
+    bool p_modified_;
+};
+
+#endif // SHADERVALIDATIONRESULTS_H
@@ -0,0 +1,249 @@
+/***************************************************************************
+
+Copyright (C) 2016  stefan.berke @ modular-audio-graphics.com
+
+This source is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either
+version 3.0 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this software; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+****************************************************************************/
+
+#include <QVector>
+#include <QTimer>
+#include <QOpenGLContext>
+#include <QOpenGLFunctions>
+#include <QOpenGLShader>
+#include <QOpenGLShaderProgram>
+#include <QElapsedTimer>
+
+#include "ShaderValidator.h"
+#include "RenderProcessPool.h"
+#include "ShadertoyApi.h"
+#include "ShadertoyShader.h"
+#include "ShadertoyRenderer.h"
+#include "log.h"
+
+typedef ShaderValidationResults::Entry Entry;
+
+struct ShaderValidator::Private
+{
+    Private(ShaderValidator* p)
+        : p             (p)
+        , api           (ShadertoyApi::acquire())
+        , pool          (new RenderProcessPool(p))
+        , running       (false)
+    { }
+
+    void onCompiled(const Entry& e, const QString& drv);
+    void onBlocked(const QString& id, const QString& reason);
+    /** Moves the results to the api and updates the stats */
+    void flush();
+    void onFinished();
+
+    ShaderValidator* p;
+    ShadertoyApi* api;
+    RenderProcessPool* pool;
+    /** A run is in progress and finished() is still to be sent */
+    bool running;
+
+    Stats stats;
+    QTimer flushTimer;
+    /** Driver of the workers, empty until the first result */
+    QString driver;
+    /** Results not yet flushed */
+    QVector<Entry> results;
+};
+
+ShaderValidator::ShaderValidator(QObject* parent)
+    : QObject       (parent)
+    , p_            (new Private(this))
+{
+    ST_DEBUG_CTOR("ShaderValidator()");
+
+    p_->pool->setCompileOnly(true);
+    connect(p_->pool, &RenderProcessPool::shaderCompiled,
+            [=](const Entry& e, const QString& driver)
+    {
+        p_->onCompiled(e, driver);
+    });
+    connect(p_->pool, &RenderProcessPool::shaderBlocked,
+            [=](const QString& id, const QString& reason)
+    {
+        p_->onBlocked(id, reason);
+    });
+    connect(p_->pool, &RenderProcessPool::finished,
+            [=](){ p_->onFinished(); });
+
+    p_->flushTimer.setInterval(250);
+    connect(&p_->flushTimer, &QTimer::timeout, [=](){ p_->flush(); });
+}
+
+ShaderValidator::~ShaderValidator()
+{
+    ST_DEBUG_CTOR("~ShaderValidator()");
+    // kills the workers, the results so far are kept
+    delete p_->pool;
+    p_->flush();
+    p_->api->saveValidationResults();
+    p_->api->release();
+    delete p_;
+}
+
+int ShaderValidator::numThreads() const { return p_->pool->numWorkers(); }
+bool ShaderValidator::isForce() const { return p_->pool->isOverwrite(); }
+bool ShaderValidator::isIdle() const { return p_->pool->isIdle(); }
+const ShaderValidator::Stats& ShaderValidator::stats() const
+    { return p_->stats; }
+
+double ShaderValidator::progress() const
+{
+    const Stats& s = p_->stats;
+    return s.numRequests ? 100. * s.numDone() / s.numRequests : 100.;
+}
+
+void ShaderValidator::setNumThreads(int num) { p_->pool->setNumWorkers(num); }
+void ShaderValidator::setForce(bool enable) { p_->pool->setOverwrite(enable); }
+
+void ShaderValidator::validate(const QStringList& ids)
+{
+    ST_DEBUG2("ShaderValidator::validate(" << ids.size() << " ids)");
+
+    if (ids.isEmpty())
+        return;
+
+    if (!p_->running)
+    {
+        p_->stats = Stats();
+        p_->flushTimer.start();
+        p_->running = true;
+    }
+    // may send finished() when everything is skipped
+    p_->pool->enqueue(ids);
+}
+
+void ShaderValidator::cancel()
+{
+    ST_DEBUG2("ShaderValidator::cancel()");
+    p_->pool->cancel();
+}
+
+void ShaderValidator::Private::onCompiled(const Entry& e, const QString& drv)
+{
+    driver = drv;
+    if (e.status == ShaderValidationResults::S_OK)
+        ++stats.numOk;
+    stats.compileMs += e.compileMs;
+    stats.linkMs += e.linkMs;
+    results << e;
+}
+
+void ShaderValidator::Private::onBlocked(
+        const QString& id, const QString& reason)
+{
+    Entry e;
+    e.id = id;
+    e.status = ShaderValidationResults::S_CRASHED;
+    e.log = reason;
+    results << e;
+}
+
+void ShaderValidator::Private::flush()
+{
+    if (!results.isEmpty())
+    {
+        QVector<Entry> entries;
+        entries.swap(results);
+        api->setValidationResults(entries, driver);
+    }
+
+    // compile errors, crashes and timeouts are failures
+    const RenderProcessPool::Stats& s = pool->stats();
+    stats.numRequests = s.numRequests;
+    stats.numSkipped = s.numSkipped;
+    stats.numFailed = s.numFailed + s.numRendered - stats.numOk;
+    stats.seconds = s.seconds;
+
+    emit p->progressChanged(p->progress());
+}
+
+void ShaderValidator::Private::onFinished()
+{
+    if (!running)
+        return;
+
+    flushTimer.stop();
+    flush();
+    running = false;
+    api->saveValidationResults();
+
+    ST_DEBUG2("ShaderValidator: " << stats.numOk << " ok, "
+              << stats.numFailed << " failed, "
+              << stats.numSkipped << " skipped in "
+              << stats.seconds << " sec, compile "
+              << stats.compileMs << " ms, link "
+              << stats.linkMs << " ms");
+    emit p->finished();
+}
+
+void ShaderValidator::compileShader(
+        QOpenGLShader& vert, const ShadertoyShader& shader, Entry& e)
+{
+    QElapsedTimer time;
+    e.status = ShaderValidationResults::S_OK;
+
+    for (const ShadertoyRenderPass& pass : shader.sortedRenderPasses())
+    {
+        QOpenGLShader frag(QOpenGLShader::Fragment);
+        QOpenGLShaderProgram prog;
+
+        time.start();
+        const bool compiled = frag.compileSourceCode(
+                    ShadertoyRenderer::fragmentSource(pass));
+        e.compileMs += float(time.nsecsElapsed()) / 1.e6f;
+        if (!compiled)
+        {
+            e.status = ShaderValidationResults::S_COMPILE_ERROR;
+            e.log = QString("%1:\n%2").arg(pass.name()).arg(frag.log());
+            return;
+        }
+
+        time.start();
+        const bool linked = prog.addShader(&vert)
+                         && prog.addShader(&frag)
+                         && prog.link();
+        e.linkMs += float(time.nsecsElapsed()) / 1.e6f;
+        if (!linked)
+        {
+            e.status = ShaderValidationResults::S_LINK_ERROR;
+            e.log = QString("%1:\n%2").arg(pass.name()).arg(prog.log());
+            return;
+        }
+        // detach before the shaders are destroyed
+        prog.removeAllShaders();
+    }
+}
+
+QString ShaderValidator::driverName()
+{
+    auto ctx = QOpenGLContext::currentContext();
+    if (!ctx)
+        return QString();
+    auto gl = ctx->functions();
+    auto str = [=](GLenum name)
+    {
+        return QString::fromLatin1(
+                    reinterpret_cast<const char*>(gl->glGetString(name)));
+    };
+    return QString("%1 / %2 / %3").arg(str(GL_VENDOR))
+            .arg(str(GL_RENDERER)).arg(str(GL_VERSION));
+}
@@ -0,0 +1,114 @@
+/***************************************************************************
+
+Copyright (C) 2016  stefan.berke @ modular-audio-graphics.com
+
+This source is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either
+version 3.0 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this software; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+****************************************************************************/
+
+#ifndef SHADERVALIDATOR_H
+#define SHADERVALIDATOR_H
+
+#include <QObject>
+#include <QStringList>
+
+#include "ShaderValidationResults.h"
+
+class QOpenGLShader;
+class ShadertoyShader;
+
+/** Compiles and links all passes of many shaders in worker processes.
+
+    The shaders are compiled by a RenderProcessPool in compile-only mode,
+    so a shader that crashes the driver only takes down its worker.
+    It is added to the render blocklist and stored with
+    ShaderValidationResults::S_CRASHED, blocklisted shaders are skipped.
+    Nothing is rendered, so no textures or framebuffers are needed.
+    Status, compiler log and the compile and link times go to
+    ShadertoyApi::validationResults(), in batches, and the file is saved
+    at the end.
+
+    Shaders whose sources have the same hash as the stored result
+    are skipped, unless setForce() is enabled or the OpenGL driver
+    has changed.
+*/
+class ShaderValidator : public QObject
+{
+    Q_OBJECT
+public:
+    struct Stats
+    {
+        Stats() : numRequests(0), numOk(0), numFailed(0), numSkipped(0),
+                  compileMs(0.), linkMs(0.), seconds(0.) { }
+        int numRequests, numOk, numFailed, numSkipped;
+        /** Sum over all compiled shaders */
+        double compileMs, linkMs;
+        double seconds;
+        int numDone() const { return numOk + numFailed + numSkipped; }
+    };
+
+    explicit ShaderValidator(QObject* parent = nullptr);
+    /** Kills the workers and saves the results */
+    ~ShaderValidator();
+
+    /** Compiles and links all passes of @p shader until the first error
+        in the current OpenGL context and sets status, log and times
+        of @p e. @p vert is the compiled vertex shader of all passes. */
+    static void compileShader(QOpenGLShader& vert,
+                              const ShadertoyShader& shader,
+                              ShaderValidationResults::Entry& e);
+
+    /** Vendor, renderer and version of the current OpenGL context */
+    static QString driverName();
+
+    // --- getter ---
+
+    /** Number of worker processes,
+        default is QThread::idealThreadCount() */
+    int numThreads() const;
+    bool isForce() const;
+    bool isIdle() const;
+    /** Statistics of the current or last run */
+    const Stats& stats() const;
+    /** Percent of the current run that is done */
+    double progress() const;
+
+    // --- setter ---
+
+    /** Applies to workers started afterwards */
+    void setNumThreads(int num);
+    /** Compile shaders with unchanged sources again.
+        Applies to the ids passed to validate() afterwards. */
+    void setForce(bool enable);
+
+public slots:
+
+    /** Appends @p ids to the current run, or starts a new one */
+    void validate(const QStringList& ids);
+    /** Drops the remaining shaders, the finished ones are kept */
+    void cancel();
+
+signals:
+
+    void progressChanged(double percent);
+    /** All shaders are done or the run was cancelled */
+    void finished();
+
+private:
+    struct Private;
+    Private* p_;
+};
+
+#endif // SHADERVALIDATOR_H
@@ -10,6 +10,7 @@
 
 
 #include <functional>
+#include <algorithm>
 
 #include <QDebug>
 
@@ -23,7 +24,7 @@
 #include <QJsonValue>
 #include <QFile>
 #include <QDir>
-#include <QApplication>
+#include <QCoreApplication>
 #include <QImage>
 #include <QImageReader>
 #include <QImageWriter>
@@ -31,79 +32,471 @@
 #include <QByteArray>
 #include <QRegExp>
 #include <QThread>
+#include <QElapsedTimer>
+#include <QCache>
+#include <QHash>
+#include <QSet>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QTextStream>
+#include <QFutureWatcher>
+#include <QtConcurrent/QtConcurrentMap>
+#include <QtConcurrent/QtConcurrentRun>
+#include <QAtomicInt>
+#include <QSharedPointer>
 
 #include "ShadertoyApi.h"
 #include "ShadertoyShader.h"
+#include "DownloadScheduler.h"
+#include "ShaderCatalogFile.h"
+#include "ThumbnailStore.h"
+#include "ProgramBinaryCache.h"
+#include "ShaderCacheManifest.h"
+#include "ShaderSearchIndex.h"
 #include "ShadertoyOffscreenRenderer.h"
 #include "log.h"
 
+namespace {
+
+    /** Parses the json file content, returns invalid shader on error */
+    ShadertoyShader parseShaderJson(const QByteArray& data, const QString& fn)
+    {
+        auto obj = QJsonDocument::fromJson(data).object();
+
+        ShadertoyShader shader;
+        if (!shader.setJsonData(obj) || !shader.isValid())
+        {
+            ST_ERROR("Error parsing json file '" << fn << "'");
+            return ShadertoyShader();
+        }
+        return shader;
+    }
+
+    /** Loads a shader from the packed catalog if present,
+        otherwise from the json file in directory @p path.
+        The json files of the @p loose ids replace the packed ones. */
+    ShadertoyShader loadCachedShader(
+            const QString& path, const ShaderCatalogFile* catalog,
+            const QSet<QString>& loose, const QString& id)
+    {
+        if (catalog && !loose.contains(id))
+        {
+            const int idx = catalog->indexOf(id);
+            if (idx >= 0)
+            {
+                ShadertoyShader shader;
+                if (!shader.setJsonData(catalog->jsonData(idx))
+                        || !shader.isValid())
+                {
+                    ST_ERROR("Error parsing shader '" << id
+                             << "' in catalog '" << catalog->filename() << "'");
+                    return ShadertoyShader();
+                }
+                return shader;
+            }
+        }
+
+        return ShadertoyApi::loadShaderFile(
+                    path + ShadertoyApi::shaderIdToFilename(id) + ".json");
+    }
+
+    /** Result of loading one shader in a worker thread */
+    struct LoadResult
+    {
+        LoadResult() : ok(false), updateManifest(false) { }
+        ShadertoyShader shader;
+        bool ok, updateManifest;
+        ShaderCacheManifest::Entry entry;
+    };
+
+    /** Functor for QtConcurrent::mapped(),
+        loads a shader id from the given cache directory.
+        With a manifest, unchanged json files are not parsed
+        and an info-only shader is returned instead. */
+    struct LoadShaderFunctor
+    {
+        typedef LoadResult result_type;
+
+        LoadShaderFunctor(
+                const QString& path,
+                const QSharedPointer<const ShaderCatalogFile>& catalog,
+                const QSet<QString>& loose,
+                const ShaderCacheManifest* manifest)
+            : path(path), catalog(catalog), loose(loose)
+            , manifest(manifest) { }
+
+        LoadResult operator()(const QString& id) const
+        {
+            LoadResult r;
+            if (manifest && !catalog)
+                loadWithManifest(r, id);
+            else
+                r.shader = loadCachedShader(path, catalog.data(), loose, id);
+            r.ok = r.shader.isValid();
+            return r;
+        }
+
+        void loadWithManifest(LoadResult& r, const QString& id) const
+        {
+            const QString fn =
+                    path + ShadertoyApi::shaderIdToFilename(id) + ".json";
+            QFileInfo fi(fn);
+            if (!fi.exists())
+                return;
+
+            const qint64 mtime = fi.lastModified().toMSecsSinceEpoch();
+            auto e = manifest->find(id);
+            if (e && e->size == fi.size() && e->mtime == mtime)
+            {
+                r.shader = ShadertoyShader::fromInfo(e->info);
+                return;
+            }
+
+            QFile file(fn);
+            if (!file.open(QFile::Text | QFile::ReadOnly))
+            {
+                ST_ERROR("Could not open shader file '" << fn << "', "
+                         << file.errorString());
+                return;
+            }
+            const QByteArray data = file.readAll();
+
+            r.entry.size = fi.size();
+            r.entry.mtime = mtime;
+            r.entry.hash = ShaderCacheManifest::hash(data);
+
+            // only touched, content is the same
+            if (e && e->hash == r.entry.hash)
+            {
+                r.entry.info = e->info;
+                r.shader = ShadertoyShader::fromInfo(e->info);
+                r.updateManifest = true;
+                return;
+            }
+
+            r.shader = parseShaderJson(data, fn);
+            if (r.shader.isValid())
+            {
+                r.entry.info = r.shader.info();
+                r.updateManifest = true;
+            }
+        }
+
+        QString path;
+        QSharedPointer<const ShaderCatalogFile> catalog;
+        QSet<QString> loose;
+        const ShaderCacheManifest* manifest;
+    };
+
+    /** Size of the pixel data, the cost in the texture cache */
+    qint64 imageBytes(const QImage& img)
+    {
+#if QT_VERSION >= QT_VERSION_CHECK(5, 10, 0)
+        return qint64(img.sizeInBytes());
+#else
+        return qint64(img.bytesPerLine()) * img.height();
+#endif
+    }
+
+    /** Priorities in the DownloadScheduler */
+    enum RequestPriority
+    {
+        /** Shader downloads of mergeWithWeb() */
+        RP_BULK,
+        /** Single shader requests */
+        RP_SINGLE,
+        /** Shader list and assets */
+        RP_LIST
+    };
+
+    ShadertoyApi* sharedInstance = nullptr;
+    /** Atomic, renderers in worker threads acquire the instance too */
+    QAtomicInt sharedRefCount(0);
+    /** Number of existing ShadertoyApi objects */
+    int numInstances = 0;
+
+} // namespace
+
 struct ShadertoyApi::Private
 {
     Private(ShadertoyApi* p)
         : p             (p)
         , net           (nullptr)
+        , downloads     (nullptr)
+        , maxDownloads  (6)
         , numDownloads  (0)
         , renderer      (nullptr)
+        , thumbnailStore(nullptr)
+        , loadWatcher   (nullptr)
+        , loadBatchSize (512)
+        , indexWatcher  (nullptr)
+        , indexBuild    (nullptr)
+        , indexAbort    (0)
+        , indexRestart  (false)
+        , manifestLoaded(false)
+        , blocklistLoaded(false)
+        , validationLoaded(false)
+        , lazyLoading   (false)
         , doWebMerge    (false)
-    { }
+    {
+        setCacheBudget(qint64(64) << 20);
+        textureCache.setMaxCost(128 << 10);
+    }
 
-    void postRequest(const QString& url, const QVariant& userData);
+    void postRequest(const QString& url, const QVariant& userData,
+                     int priority = RP_BULK);
+    void requestShader(const QString& id, int priority);
     void readShaderList(QNetworkReply* reply);
     void readShader(QNetworkReply* reply);
     void readAsset(QNetworkReply* reply);
+    void onRequestFailed(const QString& user);
+    void finishShaderDownload(const QString& id);
 
     bool storeJson(const QString& filename, const QJsonObject& data);
     QImage loadImage(QByteArray);
     QImage loadImage(const QString& fn);
+    QImage cachedTexture(const QString& src) const;
+    void cacheTexture(const QString& src, const QImage& img);
     bool saveImage(const QString& fn, const QImage& img);
-    bool loadShader(const QString& id);
+    ShadertoyShader loadShader(const QString& id);
+    void insertShader(const ShadertoyShader& shader);
+    /** Puts the full shader into the bodyCache, threadsafe */
+    void cacheBody(const ShadertoyShader& shader, bool replace);
+    /** Emits shadersChanged() and shaderListChanged() */
+    void emitListChanged();
+    void setCacheBudget(qint64 bytes);
+    bool openCatalog();
+    /** The current catalog, for use in other threads,
+        @p loose receives a copy of looseIds */
+    QSharedPointer<const ShaderCatalogFile> currentCatalog(
+            QSet<QString>* loose = nullptr) const;
+    /** Writes the catalog from the open or existing one and the json
+        files in @p jsonFiles, then opens it again if it was open */
+    bool writeCatalog(const QStringList& jsonFiles);
+    void loadBlocklist() const;
+    void onLoadResults(int begin, int end);
+    void onLoadFinished();
+    void flushLoadResults();
+    void onIndexFinished();
 
     static QString removeFilename(const QString&);
 
     ShadertoyApi* p;
     QNetworkAccessManager* net;
+    DownloadScheduler* downloads;
+    int maxDownloads;
 
     QString
-        apiUrl, appKey,
+        serverUrl, apiUrl, appKey,
         cacheUrlShader,
+        cacheUrlCatalog,
+        cacheUrlManifest,
         cacheUrlAssets,
-        cacheUrlSnapshot;
+        cacheUrlSnapshot,
+        cacheUrlThumbnails,
+        cacheUrlBlocklist,
+        cacheUrlValidation,
+        cacheUrlPrograms;
 
     QStringList shaderIds;
+    /** Ids downloaded or (re)loaded from the cache since the last
+        emitListChanged(). Bodies loaded on demand are not changes. */
+    QStringList changedIds;
     QSet<QString> downloadShaderIds;
     int numDownloads;
     QMap<QString, ShadertoyShader> shaderMap;
 
     ShadertoyOffscreenRenderer* renderer;
+    /** Packed cache, if used. Only replaced in the gui thread,
+        other threads take a reference through currentCatalog() */
+    QSharedPointer<const ShaderCatalogFile> catalog;
+    /** Shaders downloaded while the catalog is open. Their json files
+        replace the packed version and are packed on destruction.
+        Written in the gui thread, guarded by catalogMutex */
+    QSet<QString> looseIds;
+    mutable QMutex catalogMutex;
+    /** Opened on first use */
+    ThumbnailStore* thumbnailStore;
+    /** Shared by all renderers, threadsafe */
+    ProgramBinaryCache programCache;
+
+    QFutureWatcher<LoadResult>* loadWatcher;
+    QList<ShadertoyShader> loadPending;
+    int loadBatchSize;
+    LoadStats loadStats;
+    QElapsedTimer loadTimer;
+
+    /** Render blocklist, id to reason, loaded on first use */
+    mutable QHash<QString, QString> blocklist;
+    mutable bool blocklistLoaded;
+
+    /** Loaded on first use */
+    mutable ShaderValidationResults validation;
+    mutable bool validationLoaded;
+
+    ShaderCacheManifest manifest;
+    QList<QPair<QString, ShaderCacheManifest::Entry>> manifestUpdates;
+    bool manifestLoaded;
+
+    ShaderSearchIndex searchIndex;
+    QFutureWatcher<void>* indexWatcher;
+    /** Built in background, swapped into searchIndex when finished */
+    ShaderSearchIndex* indexBuild;
+    /** Shaders added to searchIndex while indexBuild is running */
+    QSet<QString> indexAdded;
+    QElapsedTimer indexTimer;
+    QAtomicInt indexAbort;
+    bool indexRestart;
+
+    /** Decoded textures by asset src, cost is in KiB */
+    QCache<QString, QImage> textureCache;
+    mutable QMutex textureMutex;
+
+    /** Fully loaded shaders in lazy mode, cost is in KiB */
+    QCache<QString, ShadertoyShader> bodyCache;
+    mutable QMutex bodyMutex;
+    bool lazyLoading;
 
     bool doWebMerge;
 };
 
-namespace {
-
-}
-
 ShadertoyApi::ShadertoyApi(QObject* parent)
     : QObject       (parent)
     , p_            (new Private(this))
 {
     ST_DEBUG_CTOR("ShadertoyApi()");
-    p_->apiUrl = "https://www.shadertoy.com/api/v1/";
+    ++numInstances;
+    setServerUrl("https://www.shadertoy.com");
     p_->appKey = "rtHtwr";
     //p_->appKey = Settings::instance().value(
     //                Settings::keyAppkey, "rtHtwr").toString();
     p_->cacheUrlShader = "./shader/";
+    p_->cacheUrlCatalog = "./shader.catalog";
+    p_->cacheUrlManifest = "./shader.manifest";
     p_->cacheUrlSnapshot = "./snapshot/";
+    p_->cacheUrlThumbnails = "./snapshot.thumbs";
+    p_->cacheUrlBlocklist = "./render.blocklist";
+    p_->cacheUrlValidation = "./shader.validation";
+    p_->cacheUrlPrograms = "./program.cache/";
+    p_->programCache.setDirectory(p_->cacheUrlPrograms);
     p_->cacheUrlAssets = "./assets"; ///< no trailing / !
 }
 
 ShadertoyApi::~ShadertoyApi()
 {
     ST_DEBUG_CTOR("~ShadertoyApi");
+    --numInstances;
     stopRequests();
+    if (p_->loadWatcher)
+    {
+        p_->loadWatcher->cancel();
+        p_->loadWatcher->waitForFinished();
+        delete p_->loadWatcher;
+    }
+    if (p_->indexWatcher)
+    {
+        p_->indexAbort = 1;
+        p_->indexWatcher->waitForFinished();
+        delete p_->indexWatcher;
+        delete p_->indexBuild;
+    }
+    saveValidationResults();
+    // keep downloads in the catalog, which hides the json files
+    if (p_->catalog && !p_->looseIds.isEmpty())
+    {
+        QStringList files;
+        for (const QString& id : p_->looseIds)
+            files << p_->cacheUrlShader + shaderIdToFilename(id) + ".json";
+        p_->writeCatalog(files);
+    }
+    delete p_->thumbnailStore;
     delete p_;
 }
 
+ShadertoyApi* ShadertoyApi::acquire()
+{
+    if (!sharedInstance)
+        sharedInstance = new ShadertoyApi();
+    sharedRefCount.ref();
+    ST_DEBUG2("ShadertoyApi::acquire() refs=" << sharedRefCount.load());
+    return sharedInstance;
+}
+
+void ShadertoyApi::release()
+{
+    ST_DEBUG2("ShadertoyApi::release() refs=" << sharedRefCount.load());
+    Q_ASSERT(this == sharedInstance && sharedRefCount.load() > 0);
+
+    const int refs = sharedRefCount.fetchAndAddOrdered(-1) - 1;
+
+    // The snapshot renderer holds a reference to this instance,
+    // its destructor calls release() again
+    if (refs == 1 && p_->renderer)
+    {
+        auto r = p_->renderer;
+        p_->renderer = nullptr;
+        delete r;
+        return;
+    }
+
+    if (refs == 0)
+    {
+        sharedInstance = nullptr;
+        delete this;
+    }
+}
+
+QString ShadertoyApi::memoryReport() const
+{
+    size_t shaderBytes = 0;
+    int numFull = 0;
+    for (const ShadertoyShader& s : p_->shaderMap)
+    {
+        shaderBytes += s.memoryUsage();
+        if (!s.isInfoOnly())
+            ++numFull;
+    }
+    const qint64 cacheBytes = shaderCacheUsage();
+
+    qint64 texBytes;
+    int numTex;
+    {
+        QMutexLocker lock(&p_->textureMutex);
+        numTex = p_->textureCache.size();
+        texBytes = qint64(p_->textureCache.totalCost()) << 10;
+    }
+
+    const int users = std::max(
+            1, this == sharedInstance ? sharedRefCount.load() : 1);
+    const qint64 total = qint64(shaderBytes) + cacheBytes + texBytes;
+    const ProgramBinaryCache::Stats programs = p_->programCache.stats();
+
+    QString report;
+    QTextStream s(&report);
+    s << "ShadertoyApi objects: " << numInstances
+      << ", users of shared instance: " << sharedRefCount.load() << "\n"
+      << "shaders: " << p_->shaderMap.size() << " (" << numFull
+      << " with render passes) " << (shaderBytes >> 10) << " KiB\n"
+      << "lazy loading cache: " << (cacheBytes >> 10) << " KiB\n"
+      << "decoded textures: " << numTex << " " << (texBytes >> 10) << " KiB\n"
+      << "search index: " << p_->searchIndex.numShaders() << " shaders "
+      << (p_->searchIndex.memoryUsage() >> 10) << " KiB\n"
+      << "network managers: " << (p_->net ? 1 : 0) << "\n"
+      << "thumbnail store: "
+      << (p_->thumbnailStore ? p_->thumbnailStore->count() : 0)
+      << " tiles " << (p_->thumbnailStore
+                       ? p_->thumbnailStore->fileSize() >> 10 : 0)
+      << " KiB mapped\n"
+      << "program binaries: " << programs.numFiles << " files "
+      << (programs.bytes >> 10) << " KiB, " << programs.numHits
+      << " hits, " << programs.numMisses << " misses, "
+      << programs.numRejected << " rejected\n"
+      << "total: " << (total >> 10) << " KiB, with one instance per user: "
+      << ((total * users) >> 10) << " KiB (saved "
+      << ((total * (users - 1)) >> 10) << " KiB)\n";
+    return report;
+}
+
 QString ShadertoyApi::shaderIdToFilename(const QString& id)
 {
     QString s;
@@ -117,63 +510,252 @@ QString ShadertoyApi::shaderIdToFilename(const QString& id)
 }
 
 const QStringList& ShadertoyApi::shaderIds() const { return p_->shaderIds; }
+const QString& ShadertoyApi::shaderCachePath() const
+    { return p_->cacheUrlShader; }
+const QString& ShadertoyApi::catalogFilename() const
+    { return p_->cacheUrlCatalog; }
+bool ShadertoyApi::isCatalogUsed() const { return !p_->catalog.isNull(); }
+const ShadertoyApi::LoadStats& ShadertoyApi::loadStats() const
+    { return p_->loadStats; }
+const ShaderSearchIndex& ShadertoyApi::searchIndex() const
+    { return p_->searchIndex; }
+bool ShadertoyApi::isIndexing() const { return p_->indexBuild != nullptr; }
+bool ShadertoyApi::isLoading() const
+{
+    return p_->loadWatcher && p_->loadWatcher->isRunning();
+}
 bool ShadertoyApi::hasShader(const QString& id) const
 {
     return p_->shaderMap.contains(id);
 }
-ShadertoyShader ShadertoyApi::getShader(const QString& id) const
+ShadertoyShader ShadertoyApi::getShader(const QString& id, bool loadBody) const
+{
+    auto i = p_->shaderMap.constFind(id);
+    if (i == p_->shaderMap.constEnd())
+        return ShadertoyShader(id);
+
+    if (!loadBody || !i.value().isInfoOnly())
+        return i.value();
+
+    {
+        QMutexLocker lock(&p_->bodyMutex);
+        if (auto s = p_->bodyCache.object(id))
+            return *s;
+    }
+
+    auto shader = p_->loadShader(id);
+    return shader.isValid() ? shader : p_->shaderMap.value(id);
+}
+
+bool ShadertoyApi::isLazyLoading() const { return p_->lazyLoading; }
+qint64 ShadertoyApi::shaderCacheBudget() const
 {
-    auto i = p_->shaderMap.find(id);
-    return i != p_->shaderMap.end() ? i.value() : ShadertoyShader(id);
+    QMutexLocker lock(&p_->bodyMutex);
+    return qint64(p_->bodyCache.maxCost()) << 10;
 }
 
+qint64 ShadertoyApi::shaderCacheUsage() const
+{
+    QMutexLocker lock(&p_->bodyMutex);
+    return qint64(p_->bodyCache.totalCost()) << 10;
+}
+
+ShadertoyShader ShadertoyApi::loadShaderBody(const QString& id) const
+{
+    {
+        QMutexLocker lock(&p_->bodyMutex);
+        if (auto s = p_->bodyCache.object(id))
+            return *s;
+    }
+    QSet<QString> loose;
+    const auto catalog = p_->currentCatalog(&loose);
+    auto shader = loadCachedShader(
+                p_->cacheUrlShader, catalog.data(), loose, id);
+    if (shader.isValid())
+        p_->cacheBody(shader, false);
+    return shader;
+}
+
+void ShadertoyApi::setShaderCacheBudget(qint64 bytes)
+{
+    p_->setCacheBudget(bytes);
+}
+
+qint64 ShadertoyApi::textureCacheBudget() const
+{
+    QMutexLocker lock(&p_->textureMutex);
+    return qint64(p_->textureCache.maxCost()) << 10;
+}
+
+void ShadertoyApi::setTextureCacheBudget(qint64 bytes)
+{
+    QMutexLocker lock(&p_->textureMutex);
+    p_->textureCache.setMaxCost(int(std::max(qint64(1), bytes >> 10)));
+}
+
+void ShadertoyApi::Private::setCacheBudget(qint64 bytes)
+{
+    QMutexLocker lock(&bodyMutex);
+    bodyCache.setMaxCost(int(std::max(qint64(1), bytes >> 10)));
+}
+
+void ShadertoyApi::setLazyLoading(bool enable)
+{
+    ST_DEBUG2("ShadertoyApi::setLazyLoading(" << enable << ")");
+
+    if (enable == p_->lazyLoading)
+        return;
+    p_->lazyLoading = enable;
+
+    if (!enable)
+    {
+        QMutexLocker lock(&p_->bodyMutex);
+        p_->bodyCache.clear();
+        return;
+    }
+
+    // strip loaded shaders down to their info
+    QList<ShadertoyShader> loaded;
+    for (const ShadertoyShader& s : p_->shaderMap)
+        if (!s.isInfoOnly())
+            loaded << s;
+    for (const ShadertoyShader& s : loaded)
+        p_->insertShader(s);
+    p_->emitListChanged();
+}
+
+void ShadertoyApi::Private::insertShader(const ShadertoyShader& shader)
+{
+    const QString id = shader.info().id;
+    ST_DEBUG2("ShadertoyApi: insert shader '" << id << "'");
+
+    if (!lazyLoading || shader.isInfoOnly())
+    {
+        shaderMap.insert(id, shader);
+        QMutexLocker lock(&bodyMutex);
+        bodyCache.remove(id);
+        return;
+    }
+
+    shaderMap.insert(id, ShadertoyShader::fromInfo(shader.info()));
+    cacheBody(shader, true);
+}
+
+void ShadertoyApi::Private::cacheBody(
+        const ShadertoyShader& shader, bool replace)
+{
+    const QString id = shader.info().id;
+    QMutexLocker lock(&bodyMutex);
+    // a body read from disk in another thread must not
+    // replace one that was inserted in the meantime
+    if (!replace && bodyCache.contains(id))
+        return;
+    // too large shaders are simply not cached
+    bodyCache.insert(id, new ShadertoyShader(shader),
+                     int(std::max(size_t(1), shader.memoryUsage() >> 10)));
+}
+
+void ShadertoyApi::Private::emitListChanged()
+{
+    if (!changedIds.isEmpty())
+    {
+        QStringList ids;
+        ids.swap(changedIds);
+        emit p->shadersChanged(ids);
+    }
+    emit p->shaderListChanged();
+}
+
+
+const QString& ShadertoyApi::serverUrl() const { return p_->serverUrl; }
+const DownloadScheduler* ShadertoyApi::downloads() const
+    { return p_->downloads; }
+
+void ShadertoyApi::setServerUrl(const QString& url)
+{
+    p_->serverUrl = url;
+    while (p_->serverUrl.endsWith("/"))
+        p_->serverUrl.chop(1);
+    p_->apiUrl = p_->serverUrl + "/api/v1/";
+}
+
+void ShadertoyApi::setMaxParallelDownloads(int num)
+{
+    p_->maxDownloads = num;
+    if (p_->downloads)
+        p_->downloads->setMaxInFlight(num);
+}
 
 void ShadertoyApi::downloadShaderList()
 {
-    p_->postRequest(p_->apiUrl + "shaders?key=" + p_->appKey, "shaderlist");
+    p_->postRequest(p_->apiUrl + "shaders?key=" + p_->appKey, "shaderlist",
+                    RP_LIST);
 }
 
 void ShadertoyApi::downloadShader(const QString &id)
 {
-    p_->postRequest(p_->apiUrl + "shaders/" + id + "?key=" + p_->appKey,
-                    "shader");
+    // single requests go before the bulk of mergeWithWeb()
+    p_->requestShader(id, RP_SINGLE);
+}
+
+void ShadertoyApi::Private::requestShader(const QString& id, int priority)
+{
+    postRequest(apiUrl + "shaders/" + id + "?key=" + appKey,
+                "shader:" + id, priority);
 }
 
 void ShadertoyApi::stopRequests()
 {
     p_->doWebMerge = false;
     p_->downloadShaderIds.clear();
+    p_->numDownloads = 0;
+    if (p_->downloads)
+        p_->downloads->clear();
 }
 
 void ShadertoyApi::Private::postRequest(
-        const QString& url, const QVariant& userData)
+        const QString& url, const QVariant& userData, int priority)
 {
     ST_DEBUG2("ShadertoyApi::postRequest('" << url << "')");
 
     if (!net)
     {
         net = new QNetworkAccessManager(p);
-        connect(net, SIGNAL(finished(QNetworkReply*)),
-                p, SLOT(p_onReply_(QNetworkReply*)), Qt::QueuedConnection);
+        downloads = new DownloadScheduler(net, p);
+        downloads->setMaxInFlight(maxDownloads);
+        connect(downloads, SIGNAL(replyReceived(QNetworkReply*)),
+                p, SLOT(p_onReply_(QNetworkReply*)));
+        connect(downloads, &DownloadScheduler::requestFailed,
+                [=](const QUrl&, const QVariant& user, const QString&)
+        {
+            onRequestFailed(user.toString());
+        });
     }
 
-    auto r = QNetworkRequest(QUrl(url));
-
-    auto reply = net->get(r);
-    reply->setProperty("user", userData);
+    downloads->enqueue(QUrl(url), userData, priority);
 }
 
 void ShadertoyApi::p_onReply_(QNetworkReply* reply)
 {
+    // reply is deleted by the DownloadScheduler
     const auto user = reply->property("user").toString();
-    if (user == "shader")
+    if (user.startsWith("shader:"))
         p_->readShader(reply);
     else if (user == "shaderlist")
         p_->readShaderList(reply);
     else if (user.startsWith("asset"))
         p_->readAsset(reply);
+}
 
-    reply->deleteLater();
+void ShadertoyApi::Private::onRequestFailed(const QString& user)
+{
+    if (user.startsWith("shader:"))
+        finishShaderDownload(user.mid(7));
+    else if (user == "shaderlist" && doWebMerge)
+    {
+        doWebMerge = false;
+        emit p->mergeFinished();
+    }
 }
 
 
@@ -200,7 +782,7 @@ void ShadertoyApi::Private::readShaderList(QNetworkReply* reply)
     {
         shaderIds = ids;
         emit p->shaderListReceived();
-        emit p->shaderListChanged();
+        emitListChanged();
         return;
     }
 
@@ -212,17 +794,24 @@ void ShadertoyApi::Private::readShaderList(QNetworkReply* reply)
     downloadShaderIds.clear();
     for (auto& id : shaderIds)
     {
-        auto s = p->getShader(id);
-        if (!s.isValid())
+        auto s = shaderMap.find(id);
+        if (s == shaderMap.end() || !s.value().isValid())
             downloadShaderIds << id;
     }
 
-    // trigger download
-    if (!downloadShaderIds.isEmpty())
+    ST_INFO("ShadertoyApi:: merging " << downloadShaderIds.size()
+            << " shaders from web");
+
+    // queue all downloads
+    if (downloadShaderIds.isEmpty())
     {
-        numDownloads = downloadShaderIds.size();
-        p->downloadShader(*downloadShaderIds.begin());
+        doWebMerge = false;
+        emit p->mergeFinished();
+        return;
     }
+    numDownloads = downloadShaderIds.size();
+    for (const QString& id : downloadShaderIds)
+        requestShader(id, RP_BULK);
 }
 
 
@@ -230,6 +819,7 @@ void ShadertoyApi::Private::readShader(QNetworkReply* reply)
 {
     ST_DEBUG2("ShadertoyApi:: shader received");
 
+    const QString id = reply->property("user").toString().mid(7);
     auto all = reply->readAll();
 
     auto json = QJsonDocument::fromJson(all).object();
@@ -242,30 +832,52 @@ void ShadertoyApi::Private::readShader(QNetworkReply* reply)
     {
         storeJson(shaderIdToFilename(shader.info().id) + ".json",
                   shader.jsonData());
+        if (catalog)
+        {
+            QMutexLocker lock(&catalogMutex);
+            looseIds << shader.info().id;
+        }
+
+        insertShader(shader);
+        changedIds << shader.info().id;
 
-        shaderMap[shader.info().id] = shader;
+        searchIndex.add(shader);
+        if (indexBuild)
+            indexAdded << shader.info().id;
 
         emit p->shaderReceived(shader.info().id);
-        emit p->shaderListChanged();
+        emitListChanged();
     }
 
-    if (numDownloads)
-    {
-        emit p->downloadProgress(100 -
-                std::min(100, downloadShaderIds.size() * 100 / numDownloads));
+    else
+        ST_ERROR("ShadertoyApi:: invalid shader received for '" << id << "'");
 
-        // grab the next shader from requests
-        downloadShaderIds.remove(shader.info().id);
-        if (!downloadShaderIds.isEmpty())
-        {
-            p->downloadShader(*downloadShaderIds.begin());
-        }
-        else
-        {
-            numDownloads = 0;
-            emit p->mergeFinished();
-        }
-    }
+    finishShaderDownload(id);
+}
+
+void ShadertoyApi::Private::finishShaderDownload(const QString& id)
+{
+    if (!numDownloads || !downloadShaderIds.remove(id))
+        return;
+
+    emit p->downloadProgress(100. * (numDownloads - downloadShaderIds.size())
+                                  / numDownloads);
+    if (!downloadShaderIds.isEmpty())
+        return;
+
+    const auto& stats = downloads->stats();
+    ST_INFO("ShadertoyApi:: merged " << numDownloads << " shaders in "
+            << stats.seconds << " sec (" << stats.requestsPerSecond()
+            << " req/sec, " << stats.bytesPerSecond() / 1024.
+            << " KiB/sec, " << stats.numRetries << " retries, "
+            << stats.numFailed << " failed)");
+
+    numDownloads = 0;
+    doWebMerge = false;
+    // keep the packed cache in sync
+    if (catalog)
+        p->packShaderCache();
+    emit p->mergeFinished();
 }
 
 void ShadertoyApi::Private::readAsset(QNetworkReply* reply)
@@ -303,6 +915,7 @@ void ShadertoyApi::Private::readAsset(QNetworkReply* reply)
     if (!img.isNull())
     {
         ST_INFO("ShadertoyApi:: received texture '" << fn << "'");
+        cacheTexture(src, img);
         emit p->textureReceived(src, img);
     }
     else
@@ -336,12 +949,20 @@ void ShadertoyApi::getAsset(const QString &src)
 {
     ST_DEBUG2("ShadertoyApi::getAsset(" << src << ")");
 
+    QImage img = p_->cachedTexture(src);
+    if (!img.isNull())
+    {
+        emit textureReceived(src, img);
+        return;
+    }
+
     if (QFileInfo(p_->cacheUrlAssets + src).exists())
     {
-        QImage img = p_->loadImage(p_->cacheUrlAssets + src);
+        img = p_->loadImage(p_->cacheUrlAssets + src);
         if (!img.isNull())
         {
             ST_INFO("ShadertoyApi:: loaded '" << src << "'");
+            p_->cacheTexture(src, img);
             emit textureReceived(src, img);
             return;
         }
@@ -349,10 +970,10 @@ void ShadertoyApi::getAsset(const QString &src)
         return;
     }
 
-    const QString url = "https://www.shadertoy.com" + src;
+    const QString url = p_->serverUrl + src;
 
     ST_DEBUG("ShadertoyApi:: downloading asset '" << url << "'");
-    p_->postRequest(url, "asset" + src);
+    p_->postRequest(url, "asset" + src, RP_LIST);
 }
 
 
@@ -360,19 +981,80 @@ QImage ShadertoyApi::getTextureBlocking(const QString &src) const
 {
     ST_DEBUG2("ShadertoyApi::getTextureBlocking(" << src << ")");
 
+    QImage img = p_->cachedTexture(src);
+    if (!img.isNull())
+        return img;
+
     if (QFileInfo(p_->cacheUrlAssets + src).exists())
     {
-        return p_->loadImage(p_->cacheUrlAssets + src);
+        img = p_->loadImage(p_->cacheUrlAssets + src);
+        if (!img.isNull())
+            p_->cacheTexture(src, img);
     }
-    return QImage();
+    return img;
 }
 
+QImage ShadertoyApi::Private::cachedTexture(const QString& src) const
+{
+    QMutexLocker lock(&textureMutex);
+    const QImage* img = textureCache.object(src);
+    return img ? *img : QImage();
+}
 
+void ShadertoyApi::Private::cacheTexture(const QString& src, const QImage& img)
+{
+    // too large images are simply not cached
+    QMutexLocker lock(&textureMutex);
+    textureCache.insert(src, new QImage(img),
+                        int(std::max(qint64(1), imageBytes(img) >> 10)));
+}
+
+
+
+bool ShadertoyApi::Private::openCatalog()
+{
+    if (catalog)
+        return true;
+
+    if (!QFileInfo(cacheUrlCatalog).exists())
+        return false;
+
+    auto cat = new ShaderCatalogFile();
+    if (!cat->open(cacheUrlCatalog))
+    {
+        delete cat;
+        return false;
+    }
+
+    QMutexLocker lock(&catalogMutex);
+    catalog = QSharedPointer<const ShaderCatalogFile>(cat);
+    return true;
+}
+
+QSharedPointer<const ShaderCatalogFile>
+    ShadertoyApi::Private::currentCatalog(QSet<QString>* loose) const
+{
+    QMutexLocker lock(&catalogMutex);
+    if (loose)
+        *loose = looseIds;
+    return catalog;
+}
 
 bool ShadertoyApi::loadShaderList()
 {
     ST_DEBUG2("ShadertoyApi::loadShaderList()");
 
+    // the packed cache replaces listing the directory,
+    // json files are only scanned by packShaderCache()
+    if (p_->openCatalog())
+    {
+        p_->shaderIds = p_->catalog->ids();
+        for (const QString& id : p_->looseIds)
+            if (p_->catalog->indexOf(id) < 0)
+                p_->shaderIds << id;
+        return !p_->shaderIds.isEmpty();
+    }
+
     QDir dir(p_->cacheUrlShader);
 
     dir.setFilter(QDir::Files | QDir::NoDotAndDotDot
@@ -396,33 +1078,210 @@ void ShadertoyApi::loadAllShaders()
 {
     ST_DEBUG2("ShadertoyApi::loadAllShaders()");
 
-    for (auto& id : p_->shaderIds)
-        p_->loadShader(id);
+    if (isLoading())
+    {
+        ST_DEBUG("ShadertoyApi::loadAllShaders() already in progress");
+        return;
+    }
+
+    if (!p_->loadWatcher)
+    {
+        p_->loadWatcher = new QFutureWatcher<LoadResult>();
+        connect(p_->loadWatcher, &QFutureWatcher<LoadResult>::resultsReadyAt,
+                this, [=](int begin, int end){ p_->onLoadResults(begin, end); });
+        connect(p_->loadWatcher, &QFutureWatcher<LoadResult>::finished,
+                this, [=](){ p_->onLoadFinished(); });
+    }
+
+    if (!p_->catalog && !p_->manifestLoaded)
+    {
+        p_->manifest.load(p_->cacheUrlManifest);
+        p_->manifestLoaded = true;
+    }
+
+    p_->loadPending.clear();
+    p_->manifestUpdates.clear();
+    p_->loadStats = LoadStats();
+    p_->loadStats.numFiles = p_->shaderIds.size();
+    p_->loadTimer.start();
+
+    p_->loadWatcher->setFuture(QtConcurrent::mapped(
+                p_->shaderIds,
+                LoadShaderFunctor(p_->cacheUrlShader, p_->catalog,
+                                  p_->looseIds,
+                                  &p_->manifest)));
+}
+
+void ShadertoyApi::Private::onLoadResults(int begin, int end)
+{
+    for (int i = begin; i < end; ++i)
+    {
+        const LoadResult r = loadWatcher->resultAt(i);
+        if (r.ok)
+        {
+            ++loadStats.numLoaded;
+            loadPending << r.shader;
+            if (r.updateManifest)
+                manifestUpdates << qMakePair(r.shader.info().id, r.entry);
+        }
+        else
+            ++loadStats.numFailed;
+    }
+    loadStats.seconds = double(loadTimer.nsecsElapsed()) / 1.e9;
+
+    if (loadPending.size() >= loadBatchSize)
+        flushLoadResults();
+
+    if (loadStats.numFiles)
+        emit p->loadProgress(
+                100. * (loadStats.numLoaded + loadStats.numFailed)
+                        / loadStats.numFiles);
+}
+
+void ShadertoyApi::Private::flushLoadResults()
+{
+    for (const ShadertoyShader& s : loadPending)
+    {
+        insertShader(s);
+        changedIds << s.info().id;
+    }
+    loadPending.clear();
+
+    emitListChanged();
+}
+
+void ShadertoyApi::Private::onLoadFinished()
+{
+    flushLoadResults();
+
+    // manifest is read by the workers, so update it at the end
+    if (!catalog)
+    {
+        for (const auto& u : manifestUpdates)
+            manifest.insert(u.first, u.second);
+        manifestUpdates.clear();
+        manifest.retain(shaderIds.toSet());
+        if (manifest.isModified())
+            manifest.save(cacheUrlManifest);
+    }
+
+    loadStats.seconds = double(loadTimer.nsecsElapsed()) / 1.e9;
+    ST_INFO("ShadertoyApi:: loaded " << loadStats.numLoaded << " of "
+            << loadStats.numFiles << " shaders in " << loadStats.seconds
+            << " sec (" << loadStats.filesPerSecond() << " files/sec, "
+            << loadStats.numFailed << " failed)");
+
+    emit p->loadFinished();
+
+    p->rebuildSearchIndex();
+}
+
+void ShadertoyApi::rebuildSearchIndex()
+{
+    ST_DEBUG2("ShadertoyApi::rebuildSearchIndex()");
+
+    if (isIndexing())
+    {
+        p_->indexRestart = true;
+        return;
+    }
+
+    if (!p_->indexWatcher)
+    {
+        p_->indexWatcher = new QFutureWatcher<void>();
+        connect(p_->indexWatcher, &QFutureWatcher<void>::finished,
+                this, [=](){ p_->onIndexFinished(); });
+    }
+
+    // snapshot for the worker thread
+    const QList<ShadertoyShader> shaders = p_->shaderMap.values();
+    const QString path = p_->cacheUrlShader;
+    const QSharedPointer<const ShaderCatalogFile> catalog = p_->catalog;
+    const QSet<QString> loose = p_->looseIds;
+    ShaderSearchIndex* build = p_->indexBuild = new ShaderSearchIndex();
+    QAtomicInt* abort = &p_->indexAbort;
+
+    p_->indexAdded.clear();
+    p_->indexAbort = 0;
+    p_->indexTimer.start();
 
-    emit shaderListChanged();
+    p_->indexWatcher->setFuture(QtConcurrent::run([=]()
+    {
+        for (const ShadertoyShader& s : shaders)
+        {
+            if (abort->load())
+                return;
+            if (!s.isInfoOnly())
+                build->add(s);
+            else
+            {
+                // lazy loaded or restored from manifest
+                auto full = loadCachedShader(
+                            path, catalog.data(), loose, s.info().id);
+                if (full.isValid())
+                    build->add(full);
+            }
+        }
+    }));
+}
+
+void ShadertoyApi::Private::onIndexFinished()
+{
+    searchIndex.swap(*indexBuild);
+    delete indexBuild;
+    indexBuild = nullptr;
+
+    // re-add what was downloaded in the meantime
+    for (const QString& id : indexAdded)
+    {
+        auto shader = p->getShader(id);
+        if (shader.isValid())
+            searchIndex.add(shader);
+    }
+    indexAdded.clear();
+
+    ST_INFO("ShadertoyApi:: indexed " << searchIndex.numShaders()
+            << " shaders in " << indexTimer.elapsed() << " ms ("
+            << (searchIndex.memoryUsage() >> 10) << " KiB)");
+
+    emit p->searchIndexChanged();
+
+    if (indexRestart)
+    {
+        indexRestart = false;
+        p->rebuildSearchIndex();
+    }
 }
 
 bool ShadertoyApi::loadShader(const QString& id)
 {
     ST_DEBUG2("ShadertoyApi::loadShader('" << id << "')");
 
-    if (!p_->loadShader(id))
+    if (!p_->loadShader(id).isValid())
         return false;
 
-    emit shaderListChanged();
+    p_->changedIds << id;
+    p_->emitListChanged();
     return true;
 }
 
-bool ShadertoyApi::Private::loadShader(const QString& id)
+ShadertoyShader ShadertoyApi::Private::loadShader(const QString& id)
 {
     ST_DEBUG2("ShadertoyApi::Private::loadShader('" << id << "')");
 
-    QString fn = cacheUrlShader + shaderIdToFilename(id) + ".json";
+    auto shader = loadCachedShader(
+                cacheUrlShader, catalog.data(), looseIds, id);
+    if (shader.isValid())
+        insertShader(shader);
+    return shader;
+}
 
-    if (!QFileInfo(id).exists(fn))
+ShadertoyShader ShadertoyApi::loadShaderFile(const QString& fn)
+{
+    if (!QFileInfo(fn).exists())
     {
         ST_DEBUG2("Shader does not exist '" << fn << "'");
-        return false;
+        return ShadertoyShader();
     }
 
     QFile file(fn);
@@ -430,26 +1289,104 @@ bool ShadertoyApi::Private::loadShader(const QString& id)
     {
         ST_ERROR("Could not open shader file '" << file.fileName() << "', "
                  << file.errorString());
-        return false;
+        return ShadertoyShader();
     }
 
-    auto data = file.readAll();
-    auto obj = QJsonDocument::fromJson(data).object();
+    return parseShaderJson(file.readAll(), fn);
+}
+
 
-    ShadertoyShader shader;
-    if (!shader.setJsonData(obj) || !shader.isValid())
+
+bool ShadertoyApi::packShaderCache()
+{
+    ST_DEBUG2("ShadertoyApi::packShaderCache()");
+
+    // add/replace everything from json directory
+    QDir dir(p_->cacheUrlShader);
+    dir.setFilter(QDir::Files | QDir::NoDotAndDotDot | QDir::Readable);
+    dir.setNameFilters(QStringList() << "*.json");
+    QStringList files;
+    for (const QString& fn : dir.entryList())
+        files << dir.filePath(fn);
+
+    return p_->writeCatalog(files);
+}
+
+bool ShadertoyApi::Private::writeCatalog(const QStringList& jsonFiles)
+{
+    QMap<QString, QJsonObject> shaders;
+
+    // keep content of previous catalog
+    ShaderCatalogFile prev;
+    const ShaderCatalogFile* cat = catalog.data();
+    if (!cat && QFileInfo(cacheUrlCatalog).exists()
+             && prev.open(cacheUrlCatalog))
+        cat = &prev;
+    if (cat)
+        for (int i=0; i<cat->count(); ++i)
+            shaders.insert(cat->id(i), cat->jsonData(i));
+
+    for (const QString& fn : jsonFiles)
     {
-        ST_ERROR("Error parsing json file '" << file.fileName() << "'");
-        return false;
+        QFile file(fn);
+        if (!file.open(QFile::Text | QFile::ReadOnly))
+        {
+            ST_ERROR("Could not open shader file '" << file.fileName()
+                     << "', " << file.errorString());
+            continue;
+        }
+        auto obj = QJsonDocument::fromJson(file.readAll()).object();
+        auto id = obj.value("info").toObject().value("id").toString();
+        if (id.isEmpty())
+        {
+            ST_ERROR("No shader id in json file '" << file.fileName() << "'");
+            continue;
+        }
+        shaders.insert(id, obj);
+    }
+
+    // release the mapping of the old file, readers in
+    // other threads keep their reference until they are done
+    const bool wasOpen = !catalog.isNull();
+    {
+        QMutexLocker lock(&catalogMutex);
+        catalog.reset();
     }
+    prev.close();
 
-    ST_DEBUG2("ShadertoyApi: insert shader '" << shader.info().id << "'");
+    const bool ok = ShaderCatalogFile::write(cacheUrlCatalog, shaders);
+    if (ok)
+    {
+        QMutexLocker lock(&catalogMutex);
+        looseIds.clear();
+    }
 
-    shaderMap[shader.info().id] = shader;
-    return shader.isValid();
+    if (wasOpen && !openCatalog())
+        ST_ERROR("ShadertoyApi:: could not reopen the catalog '"
+                 << cacheUrlCatalog << "'");
+    return ok;
 }
 
+bool ShadertoyApi::unpackShaderCache()
+{
+    ST_DEBUG2("ShadertoyApi::unpackShaderCache()");
+
+    ShaderCatalogFile cat;
+    if (!cat.open(p_->cacheUrlCatalog))
+        return false;
 
+    bool ok = true;
+    for (int i=0; i<cat.count(); ++i)
+    {
+        if (!p_->storeJson(shaderIdToFilename(cat.id(i)) + ".json",
+                           cat.jsonData(i)))
+        {
+            ST_ERROR("Could not store shader '" << cat.id(i) << "'");
+            ok = false;
+        }
+    }
+    return ok;
+}
 
 void ShadertoyApi::mergeWithWeb()
 {
@@ -505,9 +1442,42 @@ bool ShadertoyApi::Private::saveImage(const QString& fn, const QImage& img)
     return true;
 }
 
+ThumbnailStore* ShadertoyApi::thumbnailStore()
+{
+    if (!p_->thumbnailStore)
+    {
+        auto store = new ThumbnailStore();
+        if (!store->open(p_->cacheUrlThumbnails))
+        {
+            delete store;
+            return nullptr;
+        }
+        p_->thumbnailStore = store;
+    }
+    return p_->thumbnailStore;
+}
+
+ProgramBinaryCache* ShadertoyApi::programCache()
+{
+    return &p_->programCache;
+}
+
+int ShadertoyApi::importSnapshots()
+{
+    ST_DEBUG2("ShadertoyApi::importSnapshots()");
+
+    auto store = thumbnailStore();
+    return store ? store->importDirectory(p_->cacheUrlSnapshot) : -1;
+}
+
+QString ShadertoyApi::snapshotFilename(const QString& id) const
+{
+    return p_->cacheUrlSnapshot + shaderIdToFilename(id) + ".png";
+}
+
 QImage ShadertoyApi::getSnapshot(const QString &id, bool renderIfNotCached)
 {
-    QString fn = p_->cacheUrlSnapshot + shaderIdToFilename(id) + ".png";
+    const QString fn = snapshotFilename(id);
     if (QFileInfo(fn).exists())
     {
         QImage img = p_->loadImage(fn);
@@ -518,6 +1488,13 @@ QImage ShadertoyApi::getSnapshot(const QString &id, bool renderIfNotCached)
     if (!renderIfNotCached)
         return QImage();
 
+    if (isRenderBlocked(id))
+    {
+        ST_WARN("Not rendering blocked shader '" << id << "', "
+                << p_->blocklist.value(id));
+        return QImage();
+    }
+
     auto shader = getShader(id);
     if (!shader.isValid())
     {
@@ -534,13 +1511,131 @@ QImage ShadertoyApi::getSnapshot(const QString &id, bool renderIfNotCached)
     QImage img = p_->renderer->renderToImage(QSize(256,256));
     if (!img.isNull())
     {
-        ST_DEBUG2("Saving image " << fn);
-        if (!QDir(".").mkpath(p_->cacheUrlSnapshot))
-        {
-            ST_ERROR("Can't create directory " << p_->cacheUrlSnapshot);
-        }
-        else
-            p_->saveImage(fn, img);
+        saveSnapshot(id, img);
+        storeSnapshot(id, img);
     }
     return img;
 }
+
+bool ShadertoyApi::saveSnapshot(const QString& id, const QImage& img) const
+{
+    const QString fn = snapshotFilename(id);
+    ST_DEBUG2("Saving image " << fn);
+    if (!QDir(".").mkpath(p_->cacheUrlSnapshot))
+    {
+        ST_ERROR("Can't create directory " << p_->cacheUrlSnapshot);
+        return false;
+    }
+    return p_->saveImage(fn, img);
+}
+
+void ShadertoyApi::Private::loadBlocklist() const
+{
+    if (blocklistLoaded)
+        return;
+    blocklistLoaded = true;
+
+    QFile file(cacheUrlBlocklist);
+    if (!file.open(QFile::ReadOnly | QFile::Text))
+        return;
+
+    QTextStream s(&file);
+    while (!s.atEnd())
+    {
+        const QString line = s.readLine().trimmed();
+        if (line.isEmpty())
+            continue;
+        const int sep = line.indexOf(' ');
+        if (sep < 0)
+            blocklist.insert(line, QString());
+        else
+            blocklist.insert(line.left(sep), line.mid(sep + 1));
+    }
+}
+
+bool ShadertoyApi::isRenderBlocked(const QString& id) const
+{
+    p_->loadBlocklist();
+    return p_->blocklist.contains(id);
+}
+
+const QHash<QString, QString>& ShadertoyApi::renderBlocklist() const
+{
+    p_->loadBlocklist();
+    return p_->blocklist;
+}
+
+void ShadertoyApi::blockRender(const QString& id, const QString& reason)
+{
+    ST_WARN("Blocking shader '" << id << "' from rendering, " << reason);
+
+    p_->loadBlocklist();
+    if (p_->blocklist.contains(id))
+        return;
+    p_->blocklist.insert(id, reason);
+
+    QFile file(p_->cacheUrlBlocklist);
+    if (!file.open(QFile::Append | QFile::Text))
+    {
+        ST_ERROR("Can't write blocklist '" << file.fileName() << "': "
+                 << file.errorString());
+        return;
+    }
+    QTextStream s(&file);
+    s << id << " " << reason << "\n";
+}
+
+void ShadertoyApi::clearRenderBlocklist()
+{
+    p_->blocklist.clear();
+    p_->blocklistLoaded = true;
+    QFile::remove(p_->cacheUrlBlocklist);
+}
+
+const ShaderValidationResults& ShadertoyApi::validationResults() const
+{
+    if (!p_->validationLoaded)
+    {
+        p_->validation.load(p_->cacheUrlValidation);
+        p_->validationLoaded = true;
+    }
+    return p_->validation;
+}
+
+void ShadertoyApi::setValidationResults(
+        const QVector<ShaderValidationResults::Entry>& entries,
+        const QString& driver)
+{
+    if (entries.isEmpty())
+        return;
+
+    validationResults();
+    QStringList ids;
+    if (!driver.isEmpty() && driver != p_->validation.driver())
+    {
+        // results of the previous driver are dropped
+        if (p_->validation.size())
+            ids = p_->shaderIds;
+        p_->validation.setDriver(driver);
+    }
+    for (const ShaderValidationResults::Entry& e : entries)
+    {
+        p_->validation.insert(e);
+        ids << e.id;
+    }
+    emit validationChanged(ids);
+}
+
+bool ShadertoyApi::saveValidationResults()
+{
+    if (!p_->validation.isModified())
+        return true;
+    return p_->validation.save(p_->cacheUrlValidation);
+}
+
+void ShadertoyApi::storeSnapshot(const QString& id, const QImage& img)
+{
+    if (auto store = thumbnailStore())
+        store->append(id, img);
+    emit snapshotChanged(id);
+}
@@ -13,33 +13,126 @@
 
 #include <QObject>
 #include <QImage>
+#include <QHash>
+#include <QVector>
+
+#include "ShaderValidationResults.h"
 
 class QNetworkReply;
 class ShadertoyShader;
+class DownloadScheduler;
+class ShaderSearchIndex;
+class ThumbnailStore;
+class ProgramBinaryCache;
+
+/** Wrapper around the Shadertoy web-API.
 
-/** Wrapper around the Shadertoy web-API */
+    Components should use the shared instance from acquire(),
+    so that the shader list, the network connection and the
+    decoded textures exist only once in the application.
+*/
 class ShadertoyApi : public QObject
 {
     Q_OBJECT
 public:
+    /** Statistics of the last loadAllShaders() run */
+    struct LoadStats
+    {
+        LoadStats() : numFiles(0), numLoaded(0), numFailed(0), seconds(0.) { }
+        int numFiles, numLoaded, numFailed;
+        double seconds;
+        /** Number of files read and parsed per second */
+        double filesPerSecond() const
+            { return seconds > 0. ? (numLoaded + numFailed) / seconds : 0.; }
+    };
+
     ShadertoyApi(QObject* parent = nullptr);
     ~ShadertoyApi();
 
+    /** Returns the shared instance and increases it's reference count.
+        The instance is created on first use.
+        Each call must be matched by a call to release().
+        Must be called from the gui thread, or from another thread
+        while the gui thread holds a reference. */
+    static ShadertoyApi* acquire();
+    /** Decreases the reference count of the shared instance
+        and deletes it when no longer used. */
+    void release();
+
+    /** Human-readable report of the memory held by the
+        shared instance and what separate instances would use */
+    QString memoryReport() const;
+
     /** All known IDs, from web or local */
     const QStringList& shaderIds() const;
     /** Is the shader id known? */
     bool hasShader(const QString& id) const;
-    /** Receive shader for ID, or invalid shader if unknown */
-    ShadertoyShader getShader(const QString& id) const;
+    /** Receive shader for ID, or invalid shader if unknown.
+        Shaders restored from the cache manifest, or all shaders in
+        lazy loading mode, only contain the info. If @p loadBody is true,
+        their json is loaded on demand. */
+    ShadertoyShader getShader(const QString& id, bool loadBody = true) const;
+
+    /** In lazy loading mode only the info of each shader is kept,
+        the render passes are loaded from disk on demand and kept
+        in a least-recently-used cache, see shaderCacheBudget(). */
+    bool isLazyLoading() const;
+    /** Memory budget of the lazy loading cache in bytes */
+    qint64 shaderCacheBudget() const;
+    /** Memory budget of the decoded textures in bytes, default 128 MiB */
+    qint64 textureCacheBudget() const;
+    /** Approximate memory used by the lazy loading cache in bytes */
+    qint64 shaderCacheUsage() const;
+
+    /** The directory of the json file cache */
+    const QString& shaderCachePath() const;
+    /** The filename of the packed shader cache */
+    const QString& catalogFilename() const;
+    /** Shaders are read from the packed catalogFilename()
+        instead of the json files in shaderCachePath() */
+    bool isCatalogUsed() const;
+
+    /** Base url of the shadertoy server, default https://www.shadertoy.com */
+    const QString& serverUrl() const;
+    /** Statistics of the current or last download batch, or NULL
+        if nothing was downloaded yet */
+    const DownloadScheduler* downloads() const;
+
+    /** Trigram index over the text of all shaders,
+        see rebuildSearchIndex() */
+    const ShaderSearchIndex& searchIndex() const;
+    /** rebuildSearchIndex() is in progress */
+    bool isIndexing() const;
+
+    /** loadAllShaders() is still in progress */
+    bool isLoading() const;
+    /** Statistics of the last (or current) loadAllShaders() call */
+    const LoadStats& loadStats() const;
 
     /** Converts shader id to case-insensitive filename */
     static QString shaderIdToFilename(const QString& id);
 
+    /** Returns the shader with render passes from the lazy loading
+        cache or from disk, without changing the shader list.
+        Bodies read from disk are kept in the cache.
+        Returns an invalid shader on any error.
+        <b>Threadsafe</b> */
+    ShadertoyShader loadShaderBody(const QString& id) const;
+
+    /** Reads and parses a shader json file.
+        Returns an invalid shader on any error.
+        <b>Threadsafe</b> */
+    static ShadertoyShader loadShaderFile(const QString& filename);
+
 signals:
 
     /** All internal changes are reflected here */
     void shaderListChanged();
 
+    /** The shaders with @p ids have been inserted or replaced,
+        emitted right before shaderListChanged() */
+    void shadersChanged(const QStringList& ids);
+
     /** The shaderId() list is updated */
     void shaderListReceived();
     /** A shader has been downloaded and saved */
@@ -52,6 +145,21 @@ signals:
     void downloadProgress(double percent);
     void mergeFinished();
 
+    /** Progress of loadAllShaders() */
+    void loadProgress(double percent);
+    /** loadAllShaders() is finished, see loadStats() */
+    void loadFinished();
+
+    /** A new snapshot of @p id has been rendered, see storeSnapshot() */
+    void snapshotChanged(const QString& id);
+
+    /** The searchIndex() has been rebuilt.
+        Document numbers from before are invalid. */
+    void searchIndexChanged();
+
+    /** New validationResults() for the shaders @p ids */
+    void validationChanged(const QStringList& ids);
+
 public slots:
 
     // ----- web api -------
@@ -72,25 +180,117 @@ public slots:
 
     void stopRequests();
 
+    /** Changes the server for api requests and assets.
+        For testing, this can be a local stub server that replays
+        recorded responses of 'api/v1/shaders' and 'api/v1/shaders/<id>' */
+    void setServerUrl(const QString& url);
+    /** Maximum number of parallel web requests */
+    void setMaxParallelDownloads(int num);
+
     /** Get the texture asset, block until loaded.
+        Decoded textures are kept in a least-recently-used cache,
+        all users of the same src share the image data.
+        <b>Threadsafe</b>
         @todo currently only works when already downloaded */
     QImage getTextureBlocking(const QString& src) const;
 
     // ---- offline api ----
 
-    /** Load the shaderId() list from cache */
+    /** Switches lazy loading mode.
+        When enabled, all loaded render passes are moved
+        into the cache and shaderListChanged() is emitted. */
+    void setLazyLoading(bool enable);
+    /** Sets the memory budget of the lazy loading cache in bytes.
+        Least recently used shaders are dropped to stay below. */
+    void setShaderCacheBudget(qint64 bytes);
+    /** Sets the memory budget of the decoded textures in bytes.
+        Least recently used textures are dropped to stay below,
+        images that were handed out stay valid. */
+    void setTextureCacheBudget(qint64 bytes);
+
+    /** Load the shaderId() list from cache. With a packed catalog,
+        only the catalog is read and the json directory is not listed,
+        see packShaderCache(). */
     bool loadShaderList();
-    /** Tries to load all shaders in the list from cache */
+    /** Tries to load all shaders in the list from cache.
+        Files are read and parsed on the global thread pool and merged
+        into the list in batches, each batch emits shaderListChanged().
+        The function returns immediately, loadFinished() is emitted
+        at the end. */
     void loadAllShaders();
     /** Loads a specific shader by ID from cache */
     bool loadShader(const QString& id);
 
+    /** Builds the searchIndex() of all shaders in a background thread.
+        Called automatically at the end of loadAllShaders(),
+        downloaded shaders are added immediately. */
+    void rebuildSearchIndex();
+
+    /** Writes all shaders from the json cache directory into the packed
+        catalog file. Shaders already in the catalog are kept, json files
+        replace them. If the catalog file exists, shaders are read from
+        it instead of parsing the json files, so json files added later
+        are only used after packing again. Shaders downloaded while the
+        catalog is open are packed on destruction.
+        The catalog is opened again after writing. */
+    bool packShaderCache();
+    /** Writes all shaders of the packed catalog into the
+        json cache directory */
+    bool unpackShaderCache();
+
     /** Get a snapshot for a specific shader.
         First tries to load a png from the ./snapshot directory.
         Then tries to render a snapshot when @ü renderIfNotCached is true,
         and saves the png for further use */
     QImage getSnapshot(const QString& id, bool renderIfNotCached);
 
+    /** The packed thumbnails of all snapshots, opened or created
+        on first call. Rendered snapshots are appended automatically.
+        Returns NULL if the file can not be opened. */
+    ThumbnailStore* thumbnailStore();
+
+    /** The on-disk cache of linked shader programs,
+        used by all renderers. <b>Threadsafe</b> */
+    ProgramBinaryCache* programCache();
+
+    /** Appends all snapshot pngs that are not yet in the
+        thumbnailStore(). Returns the number of imported images,
+        or -1 on error. */
+    int importSnapshots();
+
+    /** Filename of the cached snapshot png, which might not exist.
+        <b>Threadsafe</b> */
+    QString snapshotFilename(const QString& id) const;
+
+    /** Writes @p img as the snapshot png of @p id.
+        <b>Threadsafe</b> */
+    bool saveSnapshot(const QString& id, const QImage& img) const;
+
+    /** Appends a rendered snapshot to the thumbnailStore()
+        and emits snapshotChanged() */
+    void storeSnapshot(const QString& id, const QImage& img);
+
+    /** The shader crashed or hung a render process before and
+        is not rendered by getSnapshot() or the batch jobs */
+    bool isRenderBlocked(const QString& id) const;
+    /** All blocked shader ids with the reason */
+    const QHash<QString, QString>& renderBlocklist() const;
+    /** Adds @p id to the blocklist file, see isRenderBlocked() */
+    void blockRender(const QString& id, const QString& reason);
+    void clearRenderBlocklist();
+
+    /** Compile results of ShaderValidator, loaded on first use */
+    const ShaderValidationResults& validationResults() const;
+    /** Inserts results and emits validationChanged().
+        A non-empty @p driver that differs from the driver of the
+        stored results removes all of them first. */
+    void setValidationResults(
+            const QVector<ShaderValidationResults::Entry>& entries,
+            const QString& driver = QString());
+    /** Writes the validationResults() if modified,
+        also done on destruction */
+    bool saveValidationResults();
+
 
 private slots:
 
@@ -38,6 +38,9 @@ struct ShadertoyOffscreenRenderer::Private
         , fbo       (nullptr)
         , renderer  (nullptr)
         , shaderChanged (false)
+        , ownSurface    (true)
+        , globalTime    (0.f)
+        , frameNumber   (0)
     { }
 
     ~Private()
@@ -47,7 +50,8 @@ struct ShadertoyOffscreenRenderer::Private
             fbo->release();
         delete fbo;
         delete context;
-        delete surface;
+        if (ownSurface)
+            delete surface;
     }
 
     bool init(const QSize& res);
@@ -62,7 +66,9 @@ struct ShadertoyOffscreenRenderer::Private
     QOpenGLContext* context;
     FramebufferObject* fbo;
     ShadertoyRenderer* renderer;
-    bool shaderChanged;
+    bool shaderChanged, ownSurface;
+    float globalTime;
+    int frameNumber;
 };
 
 ShadertoyOffscreenRenderer::ShadertoyOffscreenRenderer(QObject *parent)
@@ -77,6 +83,30 @@ ShadertoyOffscreenRenderer::~ShadertoyOffscreenRenderer()
 }
 
 
+void ShadertoyOffscreenRenderer::setSurface(QOffscreenSurface* surface)
+{
+    Q_ASSERT(!p_->context);
+    if (p_->ownSurface)
+        delete p_->surface;
+    p_->surface = surface;
+    p_->ownSurface = false;
+}
+
+QString ShadertoyOffscreenRenderer::errorString() const
+{
+    return p_->renderer ? p_->renderer->errorString() : QString();
+}
+
+void ShadertoyOffscreenRenderer::setGlobalTime(float seconds)
+{
+    p_->globalTime = seconds;
+}
+
+void ShadertoyOffscreenRenderer::setFrameNumber(int frame)
+{
+    p_->frameNumber = frame;
+}
+
 void ShadertoyOffscreenRenderer::setShader(const ShadertoyShader& s)
 {
     p_->shader = s;
@@ -97,21 +127,30 @@ bool ShadertoyOffscreenRenderer::renderSound(
     return p_->renderSound(res, buffer);
 }
 
+QOffscreenSurface* ShadertoyOffscreenRenderer::createSurface()
+{
+    auto surface = new QOffscreenSurface(nullptr);
+
+    QSurfaceFormat fmt;
+    fmt.setRenderableType(QSurfaceFormat::OpenGLES);
+    surface->setFormat(fmt);
+    surface->create();
+    if (!surface->isValid())
+    {
+        ST_ERROR("Offscreen surface is not created");
+        delete surface;
+        return nullptr;
+    }
+    return surface;
+}
+
 bool ShadertoyOffscreenRenderer::Private::init(const QSize& res)
 {
     if (!surface)
     {
-        surface = new QOffscreenSurface(nullptr);
-
-        QSurfaceFormat fmt;
-        fmt.setRenderableType(QSurfaceFormat::OpenGLES);
-        surface->setFormat(fmt);
-        surface->create();
-        if (!surface->isValid())
-        {
-            ST_ERROR("Offscreen surface is not created");
+        surface = createSurface();
+        if (!surface)
             return false;
-        }
     }
 
     if (!context)
@@ -183,6 +222,8 @@ bool ShadertoyOffscreenRenderer::Private::render(const QSize& res)
     if (!makeCurrent())
         return false;
 
+    renderer->setGlobalTime(globalTime);
+    renderer->setFrameNumber(frameNumber);
     return renderer->render(*fbo, false);
 }
 
@@ -24,6 +24,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
 #include <QObject>
 #include <QImage>
 
+class QOffscreenSurface;
 class ShadertoyShader;
 
 class ShadertoyOffscreenRenderer : public QObject
@@ -33,12 +34,30 @@ public:
     explicit ShadertoyOffscreenRenderer(QObject *parent = 0);
     ~ShadertoyOffscreenRenderer();
 
+    /** Uses @p surface instead of creating one on first render.
+        Surfaces must be created in the gui thread, so a renderer
+        living in a worker thread needs one from outside.
+        No ownership is taken. Must be called before the first render. */
+    void setSurface(QOffscreenSurface* surface);
+
+    /** Creates a surface in the format the renderer uses,
+        or returns NULL on failure. Must be called from the gui thread. */
+    static QOffscreenSurface* createSurface();
+
+    /** Description of the last compile or render error */
+    QString errorString() const;
+
 signals:
 
 public slots:
 
     void setShader(const ShadertoyShader& s);
 
+    /** iGlobalTime of the next render, default 0 */
+    void setGlobalTime(float seconds);
+    /** iFrame of the next render, default 0 */
+    void setFrameNumber(int frame);
+
     QImage renderToImage(const QSize& resolution);
 
     bool renderSound(const QSize& res, std::vector<float>& buffer);
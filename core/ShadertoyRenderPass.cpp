@@ -23,49 +23,46 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
 #include "ShadertoyShader.h"
 #include "log.h"
 
-ShadertoyRenderPass::ShadertoyRenderPass()
-    : p_inputs  (4)
-{
+namespace {
 
-}
+    ShadertoyRenderPass::Type parsePassType(const QString& t)
+    {
+        if (t == "buffer")
+            return ShadertoyRenderPass::T_BUFFER;
+        else if (t == "sound")
+            return ShadertoyRenderPass::T_SOUND;
+        else if (t == "image")
+            return ShadertoyRenderPass::T_IMAGE;
+        else
+            return ShadertoyRenderPass::T_NONE;
+    }
 
-ShadertoyRenderPass::Type ShadertoyRenderPass::type() const
-{
-    const QString t = typeName();
-    if (t == "buffer")
-        return T_BUFFER;
-    else if (t == "sound")
-        return T_SOUND;
-    else if (t == "image")
-        return T_IMAGE;
-    else
-        return T_NONE;
-}
+} // namespace
 
-QString ShadertoyRenderPass::typeName() const
+ShadertoyRenderPass::ShadertoyRenderPass()
+    : p_inputs      (4)
+    , p_type_       (T_NONE)
+    , p_outputId_   (-1)
 {
-    return p_json.value("type").toString();
-}
 
-QString ShadertoyRenderPass::name() const
-{
-    QString s = p_json.value("name").toString();
-    return s.isEmpty() ? typeName() : s;
 }
 
-int ShadertoyRenderPass::outputId() const
+QString ShadertoyRenderPass::typeName() const
 {
-    // XXX Takes the first output id (no multi-target yet)
-    auto outputs = p_json.value("outputs").toArray();
-    if (outputs.isEmpty())
-        return -1;
-    else
-        return outputs[0].toObject().value("id").toInt();
+    return p_json.value("type").toString();
 }
 
-const QString& ShadertoyRenderPass::fragmentSource() const
+QJsonObject ShadertoyRenderPass::jsonData() const
 {
-    return p_fragSrc;
+    QJsonArray ins;
+    for (const ShadertoyInput& inp : p_inputs)
+        if (inp.isValid())
+            ins.append(inp.jsonData());
+
+    auto o = p_json;
+    o.insert("code", QJsonValue(p_fragSrc));
+    o.insert("inputs", ins);
+    return o;
 }
 
 
@@ -74,6 +71,17 @@ void ShadertoyRenderPass::setJsonData(const QJsonObject& o)
     p_json = o;
     p_fragSrc = p_json.value("code").toString();
 
+    const QString t = typeName();
+    p_type_ = parsePassType(t);
+    p_name_ = p_json.value("name").toString();
+    if (p_name_.isEmpty())
+        p_name_ = t;
+
+    // XXX Takes the first output id (no multi-target yet)
+    auto outputs = p_json.value("outputs").toArray();
+    p_outputId_ = outputs.isEmpty()
+            ? -1 : outputs[0].toObject().value("id").toInt();
+
     p_inputs.clear();
 
     auto ins = p_json.value("inputs").toArray();
@@ -81,36 +89,36 @@ void ShadertoyRenderPass::setJsonData(const QJsonObject& o)
     {
         ShadertoyInput inp;
         inp.setJsonData( inv.toObject() );
+        if (inp.channel() < 0)
+        {
+            ST_WARN("ShadertoyRenderPass: input '" << inp.typeName()
+                    << "' of pass '" << p_name_ << "' has invalid channel "
+                    << inp.channel() << ", ignored");
+            continue;
+        }
 
         p_inputs.resize(std::max(p_inputs.size(), inp.channel()+1));
         p_inputs[inp.channel()] = inp;
     }
+
+    // don't keep the code and inputs twice
+    p_json.remove("code");
+    p_json.remove("inputs");
 }
 
 void ShadertoyRenderPass::setFragmentSource(const QString& s)
 {
-    p_json.insert("code", QJsonValue(s));
     p_fragSrc = s;
 }
 
 void ShadertoyRenderPass::setInput(size_t idx, const ShadertoyInput& inp)
 {
-    QJsonArray ins = p_json.value("inputs").toArray();
-
     // Todo: append or insert
-    if ((int)idx >= ins.count())
+    if ((int)idx >= p_inputs.size())
     {
         ST_WARN("ShadertoyRenderPass::setInput(" << idx << ") out of range");
         return;
     }
 
-    p_inputs.resize(std::max((int)idx+1, p_inputs.size()));
     p_inputs[idx] = inp;
-
-    for (int i=0; i<ins.size(); ++i)
-        if (ins[idx].toObject().value("channel").toInt() == (int)idx)
-            ins[i] = inp.jsonData();
 }
-
-
-
@@ -10,6 +10,7 @@
 
 #include <iostream>
 #include <chrono>
+#include <algorithm>
 
 #include <QOpenGLContext>
 #include <QOpenGLFunctions>
@@ -20,10 +21,12 @@
 #include <QOpenGLShader>
 #include <QOpenGLShaderProgram>
 #include <QOpenGLTexture>
+#include <QVector3D>
 #include <QVector4D>
 #include <QMatrix4x4>
 #include <QImage>
 #include <QSet>
+#include <QMap>
 #include <QCamera>
 #include <QCameraInfo>
 #include <QCameraImageCapture>
@@ -32,12 +35,86 @@
 #include "ShadertoyShader.h"
 #include "ShadertoyApi.h"
 #include "FramebufferObject.h"
+#include "ProgramBinaryCache.h"
+#include "ShaderRenderGraph.h"
 #include "log.h"
 
 #define ST_RENDER_ERROR(qstring__) \
     errorStr = qstring__; \
     ST_ERROR("ShadertoyRenderer: " << errorStr);
 
+/** Evaluates one OpenGL call of the pass loop and counts it
+    in FrameStats::numGlCalls. A Qt wrapper counts as one call. */
+#define ST_GL_COUNT(call__) (++frameStats.numGlCalls, call__)
+
+namespace {
+
+    const char*
+              vertSrc =
+"#ifdef GL_ES\n"
+"precision highp int;\n"
+"precision highp float;\n"
+"#endif\n"
+"\n"
+"uniform mat4 mvp_matrix;\n"
+"attribute vec4 a_position;\n"
+"\n"
+"void main()\n"
+"{\n"
+"    gl_Position = mvp_matrix * a_position;\n"
+"}\n"
+            , *fragSrc1 =
+"#extension GL_OES_standard_derivatives : enable\n"
+"#ifdef GL_ES\n"
+"precision highp int;\n"
+"precision highp float;\n"
+"#endif\n"
+"uniform vec3  iResolution;              // resolution of output texture in pixels\n"
+"uniform float iGlobalTime;              // scene time in seconds\n"
+"uniform float iTimeDelta;               // time between this and last frame\n"
+"uniform int   iFrame;                   // current frame counter\n"
+"uniform float iChannelTime[4];          // playback of channel in seconds\n"
+"uniform vec3  iChannelResolution[4];    // resolution per channel in pixels\n"
+"uniform vec4  iMouse;                   // xy = pos in pixels, zw = buttons\n"
+"uniform vec4  iDate;                    // year, month, day, time in seconds\n"
+"uniform float iSampleRate;              // sound sampling rate in Hertz\n"
+"uniform vec4  _ST_eyeMod_;\n"
+                , *fragSrc2 =
+"void main()\n"
+"{\n"
+"    mainImage(gl_FragColor, gl_FragCoord.xy);\n"
+"}\n"
+            , *fragSrcSound =
+"void main()\n"
+"{\n"
+"   vec2 _pix_ = floor(gl_FragCoord.xy);\n"
+"   float _pos_ = _pix_.x + iResolution.x * _pix_.y;\n"
+"   vec2 _sam_ = mainSound(_pos_ / iSampleRate);\n"
+"   gl_FragColor = vec4(_sam_.x,_sam_.y, 0.,1.);\n"
+"}\n"
+            , *fragSrcFisheye =
+"void main()\n"
+"{\n"
+"    vec2 _uv_ = (gl_FragCoord.xy - .5*iResolution.xy) / iResolution.y * 2.;\n"
+"    vec3 _ro_ = vec3(0.);\n"
+"    vec3 _rd_ = normalize(vec3(_uv_, -2. + length(_uv_)));\n"
+"    mainVR(gl_FragColor, gl_FragCoord.xy, _ro_, _rd_);\n"
+"}\n"
+            , *fragSrcCrossEye =
+"void main()\n"
+"{\n"
+"    vec2 _res_ = iResolution.xy * vec2(.5, 1.);\n"
+"    float _side_ = gl_FragCoord.x < _res_.x ? -1. : 1.;\n"
+"    vec2 _uv_ = (vec2(mod(gl_FragCoord.x, _res_.x), gl_FragCoord.y) - .5*_res_.xy) / _res_.y * 2.;\n"
+"\n"
+"    vec3 _ro_ = vec3(-_side_*_ST_eyeMod_.x, 0., 0.);\n"
+"    vec3 _rd_ = normalize(vec3(_uv_,-1.));\n"
+"\n"
+"    mainVR(gl_FragColor, gl_FragCoord, _ro_, _rd_);\n"
+"}\n"
+    ;
+
+} // namespace
 
 struct ShadertoyRenderer::Private
 {
@@ -47,7 +124,7 @@ struct ShadertoyRenderer::Private
         , projectionMode(P_RECT)
         , prevRenderTime(0.)
         , messuredFps   (0.)
-        , api           (new ShadertoyApi(p))
+        , api           (ShadertoyApi::acquire())
         , context       (nullptr)
         , surface       (nullptr)
         , bufVert       (nullptr)
@@ -67,6 +144,7 @@ struct ShadertoyRenderer::Private
         , needsRecompile(true)
         , doUseCamera   (true)
         , doAssetsAsync (false)
+        , doKeepBuffers (true)
     {
         connect(api, SIGNAL(textureReceived(QString,QImage)),
                 p, SLOT(p_onTexture_(QString,QImage)),
@@ -77,6 +155,7 @@ struct ShadertoyRenderer::Private
     }
 
     struct RenderPass;
+    struct Program;
 
     static double systemTime();
     bool createGl();
@@ -91,24 +170,37 @@ struct ShadertoyRenderer::Private
     bool renderSound(FramebufferObject& fbo);
     bool prepare(bool continuous);
     bool drawQuad(RenderPass& pass, FramebufferObject* dstFbo = nullptr);
+    /** The projection mode @p pass is compiled for */
+    Projection passProjection(const RenderPass& pass) const
+    {
+        return pass.type == ShadertoyRenderPass::T_IMAGE
+                ? projectionMode : P_RECT;
+    }
+    /** The program of @p pass for the current projection mode,
+        compiled on first use. Returns NULL on errors. */
+    Program* program(RenderPass& pass);
+    bool compileProgram(const RenderPass& pass, Projection proj, Program& prog);
+    /** Uploads the uniform at @p loc unless @p last equals @p value */
+    template <typename T>
+    void setUniform(Program& prog, int loc, T& last, const T& value);
 
 
-    struct RenderPass
+    /** One compiled variant of a pass */
+    struct Program
     {
-        ShadertoyRenderPass::Type type;
+        Program() : shader(nullptr), uploaded(false) { }
+        /** NULL if the variant failed to compile */
         QOpenGLShaderProgram* shader;
-        FramebufferObject* fbo;
-        QOpenGLTexture* tex[4];
-        bool ownsTexture[4];
-        QString src[4], name;
-        bool vFlip[4];
-        QOpenGLTexture::WrapMode wrapMode[4];
-        QOpenGLTexture::Filter filterType[4];
-        QImage img[4];
-        int outputId,
-            inputId[4];
-        ShadertoyInput::Type inputType[4];
-        RenderPass* inputPass[4];
+
+        /** The uniform values the program currently has,
+            valid when @c uploaded is set */
+        bool uploaded;
+        QMatrix4x4 lastMvp;
+        QVector3D lastResolution;
+        QVector4D lastMouse, lastDate, lastEyeMod;
+        float lastTime, lastTimeDelta, lastSampleRate;
+        int lastFrame;
+        GLfloat lastChannelRes[4*3];
 
         int mvp_matrix,
             a_position,
@@ -125,6 +217,28 @@ struct ShadertoyRenderer::Private
             iEyeMod;
     };
 
+    struct RenderPass
+    {
+        ShadertoyRenderPass::Type type;
+        /** Source of the lazily compiled variants */
+        ShadertoyRenderPass source;
+        /** Compiled programs by Projection, only the
+            image pass uses other modes than P_RECT */
+        QMap<int, Program> programs;
+        FramebufferObject* fbo;
+        QOpenGLTexture* tex[4];
+        bool ownsTexture[4];
+        QString src[4], name;
+        bool vFlip[4];
+        QOpenGLTexture::WrapMode wrapMode[4];
+        QOpenGLTexture::Filter filterType[4];
+        QImage img[4];
+        int outputId,
+            inputId[4];
+        ShadertoyInput::Type inputType[4];
+        RenderPass* inputPass[4];
+    };
+
     const static GLfloat quadVertices[];
     const static GLushort quadIndices[];
 
@@ -133,6 +247,7 @@ struct ShadertoyRenderer::Private
     QSize resolution;
     Projection projectionMode;
     QString errorStr;
+    FrameStats frameStats;
     double prevRenderTime,
            deltaRenderTime,
            messuredFps;
@@ -158,7 +273,7 @@ struct ShadertoyRenderer::Private
     QCamera* camera;
     QCameraImageCapture* cameraCapture;
 
-    bool needsRecompile, doUseCamera, doAssetsAsync;
+    bool needsRecompile, doUseCamera, doAssetsAsync, doKeepBuffers;
 };
 
 const GLfloat ShadertoyRenderer::Private::quadVertices[] =
@@ -201,6 +316,7 @@ ShadertoyRenderer::~ShadertoyRenderer()
 {
     ST_DEBUG_CTOR("~ShadertoyRenderer");
     p_->destroyGl();
+    p_->api->release();
     delete p_;
 }
 
@@ -216,6 +332,11 @@ const QSize& ShadertoyRenderer::resolution() const
     return p_->resolution;
 }
 
+const ShadertoyRenderer::FrameStats& ShadertoyRenderer::frameStats() const
+{
+    return p_->frameStats;
+}
+
 void ShadertoyRenderer::setShader(const ShadertoyShader& s)
 {
     ST_DEBUG2("ShadertoyRenderer::setShader()");
@@ -234,8 +355,13 @@ void ShadertoyRenderer::setResolution(const QSize& s)
 {
     if (p_->resolution == s)
         return;
+    // buffer fbos follow in drawQuad()
     p_->resolution = s;
-    p_->needsRecompile = true;
+}
+
+void ShadertoyRenderer::setKeepBuffersOnResize(bool enable)
+{
+    p_->doKeepBuffers = enable;
 }
 
 void ShadertoyRenderer::setMouse(const QPoint &pos, bool leftKey, bool rightKey)
@@ -297,14 +423,47 @@ void ShadertoyRenderer::setDate(const QDateTime& dt)
 void ShadertoyRenderer::setEyeDistance(float d) { p_->eyeDistance = d; }
 void ShadertoyRenderer::setEyeRotation(float d) { p_->eyeRotation = d; }
 
+QString ShadertoyRenderer::vertexSource()
+{
+    return vertSrc;
+}
+
+QString ShadertoyRenderer::fragmentSource(
+        const ShadertoyRenderPass& pass, Projection proj)
+{
+    // per-pass texture input uniforms
+    QString src = fragSrc1;
+    for (size_t j=0; j<4; ++j)
+    {
+        src += "uniform sampler";
+        if (j < pass.numInputs()
+            && pass.input(j).type() == ShadertoyInput::T_CUBEMAP)
+            src += "Cube";
+        else
+            src += "2D";
+        src += QString(" iChannel%1;\n").arg(j);
+    }
+
+    src += "#line 1\n" + pass.fragmentSource() + "\n";
+    if (pass.type() == ShadertoyRenderPass::T_SOUND)
+        src += fragSrcSound;
+    else if (proj == P_RECT)
+        src += fragSrc2;
+    else if (proj == P_CROSS_EYE)
+        src += fragSrcCrossEye;
+    else
+        src += fragSrcFisheye;
+    return src;
+}
+
 void ShadertoyRenderer::setGlobalTime(float ti) { p_->globalTime = ti; }
 void ShadertoyRenderer::setFrameNumber(int f) { p_->frameNumber = f; }
 void ShadertoyRenderer::setProjectionMode(Projection p)
 {
     if (p_->projectionMode == p)
         return;
+    // the variant is compiled or picked in drawQuad()
     p_->projectionMode = p;
-    p_->needsRecompile = true;
 }
 
 
@@ -333,71 +492,6 @@ bool ShadertoyRenderer::Private::createGl()
 {
     ST_DEBUG2("ShadertoyRenderer::createGl()");
 
-    const QString
-              vertSrc =
-"#ifdef GL_ES\n"
-"precision highp int;\n"
-"precision highp float;\n"
-"#endif\n"
-"\n"
-"uniform mat4 mvp_matrix;\n"
-"attribute vec4 a_position;\n"
-"\n"
-"void main()\n"
-"{\n"
-"    gl_Position = mvp_matrix * a_position;\n"
-"}\n"
-            , fragSrc1 =
-"#extension GL_OES_standard_derivatives : enable\n"
-"#ifdef GL_ES\n"
-"precision highp int;\n"
-"precision highp float;\n"
-"#endif\n"
-"uniform vec3  iResolution;              // resolution of output texture in pixels\n"
-"uniform float iGlobalTime;              // scene time in seconds\n"
-"uniform float iTimeDelta;               // time between this and last frame\n"
-"uniform int   iFrame;                   // current frame counter\n"
-"uniform float iChannelTime[4];          // playback of channel in seconds\n"
-"uniform vec3  iChannelResolution[4];    // resolution per channel in pixels\n"
-"uniform vec4  iMouse;                   // xy = pos in pixels, zw = buttons\n"
-"uniform vec4  iDate;                    // year, month, day, time in seconds\n"
-"uniform float iSampleRate;              // sound sampling rate in Hertz\n"
-"uniform vec4  _ST_eyeMod_;\n"
-                , fragSrc2 =
-"void main()\n"
-"{\n"
-"    mainImage(gl_FragColor, gl_FragCoord.xy);\n"
-"}\n"
-            , fragSrcSound =
-"void main()\n"
-"{\n"
-"   vec2 _pix_ = floor(gl_FragCoord.xy);\n"
-"   float _pos_ = _pix_.x + iResolution.x * _pix_.y;\n"
-"   vec2 _sam_ = mainSound(_pos_ / iSampleRate);\n"
-"   gl_FragColor = vec4(_sam_.x,_sam_.y, 0.,1.);\n"
-"}\n"
-            , fragSrcFisheye =
-"void main()\n"
-"{\n"
-"    vec2 _uv_ = (gl_FragCoord.xy - .5*iResolution.xy) / iResolution.y * 2.;\n"
-"    vec3 _ro_ = vec3(0.);\n"
-"    vec3 _rd_ = normalize(vec3(_uv_, -2. + length(_uv_)));\n"
-"    mainVR(gl_FragColor, gl_FragCoord.xy, _ro_, _rd_);\n"
-"}\n"
-            , fragSrcCrossEye =
-"void main()\n"
-"{\n"
-"    vec2 _res_ = iResolution.xy * vec2(.5, 1.);\n"
-"    float _side_ = gl_FragCoord.x < _res_.x ? -1. : 1.;\n"
-"    vec2 _uv_ = (vec2(mod(gl_FragCoord.x, _res_.x), gl_FragCoord.y) - .5*_res_.xy) / _res_.y * 2.;\n"
-"\n"
-"    vec3 _ro_ = vec3(-_side_*_ST_eyeMod_.x, 0., 0.);\n"
-"    vec3 _rd_ = normalize(vec3(_uv_,-1.));\n"
-"\n"
-"    mainVR(gl_FragColor, gl_FragCoord, _ro_, _rd_);\n"
-"}\n"
-    ;
-
     errorStr.clear();
 
     if (!context)
@@ -422,28 +516,20 @@ bool ShadertoyRenderer::Private::createGl()
 
     // --- create shader passes ---
 
-    auto stpasses = shadertoy.sortedRenderPasses();
+    // culled passes are neither compiled nor drawn
+    const ShaderRenderGraph graph(shadertoy);
+    // index into 'passes' per graph node
+    QVector<int> passIndex(graph.numPasses(), -1);
 
-    for (const ShadertoyRenderPass& pass : stpasses)
+    for (int node : graph.order())
     {
-        // -- create per-pass texture input uniform code --
-
-        QString fragSrc1b;
-        for (size_t j=0; j<4; ++j)
-        {
-            fragSrc1b += "uniform sampler";
-            if (j < pass.numInputs()
-                && pass.input(j).type() == ShadertoyInput::T_CUBEMAP)
-                fragSrc1b += "Cube";
-            else
-                fragSrc1b += "2D";
-            fragSrc1b += QString(" iChannel%1;\n").arg(j);
-        }
+        const ShadertoyRenderPass& pass = graph.passes()[node];
+        passIndex[node] = int(passes.size());
 
         // -- create objects and install at once --
         // so destroyGl() can dealloc it all on errors below
         RenderPass rpNew;
-        rpNew.shader = new QOpenGLShaderProgram();
+        rpNew.source = pass;
         rpNew.fbo = nullptr;
         //if (pass.type() != ShadertoyRenderPass::T_IMAGE)
         //    rpNew.fbo = new FramebufferObject(context);
@@ -510,106 +596,22 @@ bool ShadertoyRenderer::Private::createGl()
             }
         }
 
-        // -- compile shader --
-
-        auto vert = new QOpenGLShader(QOpenGLShader::Vertex, rp.shader);
-        if (!vert->compileSourceCode(vertSrc))
-        {
-            ST_RENDER_ERROR(tr("vertex compile failed (pass: %1):\n%2")
-                           .arg(pass.name())
-                           .arg(vert->log())
-                           );
-            destroyGl();
-            return false;
-        }
-
-        auto frag = new QOpenGLShader(QOpenGLShader::Fragment, rp.shader);
-        QString src =
-            fragSrc1 + fragSrc1b + "#line 1\n" + pass.fragmentSource() + "\n";
-        if (pass.type() == ShadertoyRenderPass::T_SOUND)
-        {
-            src += fragSrcSound;
-        }
-        else
-        {
-            if (projectionMode == P_RECT)
-                src += fragSrc2;
-            else if (projectionMode == P_CROSS_EYE)
-                src += fragSrcCrossEye;
-            else
-                src += fragSrcFisheye;
-        }
-        if (!frag->compileSourceCode(src))
-        {
-            ST_RENDER_ERROR(tr("compile failed (pass: %1):\n%2")
-                           .arg(pass.name())
-                           .arg(frag->log())
-                           );
-            destroyGl();
-            return false;
-        }
-
-
-        // -- link shader --
+        // -- compile for the current projection mode --
 
-        if (   !rp.shader->addShader(vert)
-            || !rp.shader->addShader(frag)
-            || !rp.shader->link())
+        if (!program(rp))
         {
-            ST_RENDER_ERROR(tr("link failed:\n") + rp.shader->log());
             destroyGl();
             return false;
         }
-        rp.shader->bind();
-
-        // -- get attributes and uniforms --
-
-        rp.a_position = rp.shader->attributeLocation("a_position");
-        rp.mvp_matrix = rp.shader->uniformLocation("mvp_matrix");
-        rp.iResolution = rp.shader->uniformLocation("iResolution");
-        rp.iGlobalTime = rp.shader->uniformLocation("iGlobalTime");
-        rp.iTimeDelta = rp.shader->uniformLocation("iTimeDelta");
-        rp.iFrame = rp.shader->uniformLocation("iFrame");
-        rp.iChannelTime = rp.shader->uniformLocation("iChannelTime[0]");
-        rp.iChannelResolution =
-                rp.shader->uniformLocation("iChannelResolution[0]");
-        rp.iMouse = rp.shader->uniformLocation("iMouse");
-        rp.iDate = rp.shader->uniformLocation("iDate");
-        rp.iSampleRate = rp.shader->uniformLocation("iSampleRate");
-        rp.iEyeMod = rp.shader->uniformLocation("_ST_eyeMod_");
-        for (int j=0; j<4; ++j)
-        {
-            rp.iChannel[j] = rp.shader->uniformLocation(
-                                    QString("iChannel%1").arg(j));
-            if (rp.iChannel[j] >= 0)
-                rp.shader->setUniformValue(rp.iChannel[j], j);
-        }
-
-        ST_CHECK_GL( gl->glUseProgram(0) );
     }
 
     ST_DEBUG3("ShadertoyRenderer::createGl() shaders compiled");
 
-    // assign correct index into 'passes'
-    // for inputs connected to output ids
-    for (RenderPass& p : passes)
-    {
-        //ST_DEBUG2("checking pass " << p.name);
-        for (int i=0; i<4; ++i)
-        if (p.inputId[i] >= 0)
-        {
-            //ST_DEBUG2("checking input " << i << " = " << p.inputId[i]);
-            for (size_t j=0; j<passes.size(); ++j)
-            {
-                //ST_DEBUG2(j << "->" << passes[j].outputId);
-                if (passes[j].outputId == p.inputId[i])
-                {
-                    p.inputPass[i] = &passes[j];
-                    //ST_DEBUG2("assigned output " << j);
-                }
-            }
-        }
-    }
+    // connect buffer inputs along the graph's edges
+    for (const ShaderRenderGraph::Edge& e : graph.edges())
+        if (passIndex[e.from] >= 0 && passIndex[e.to] >= 0)
+            passes[passIndex[e.to]].inputPass[e.channel] =
+                    &passes[passIndex[e.from]];
 
     // -------- create screen quad geometry ----------
 
@@ -632,6 +634,124 @@ bool ShadertoyRenderer::Private::createGl()
 }
 
 
+ShadertoyRenderer::Private::Program* ShadertoyRenderer::Private::program(
+        RenderPass& pass)
+{
+    const Projection proj = passProjection(pass);
+    auto i = pass.programs.find(proj);
+    if (i != pass.programs.end())
+        return i.value().shader ? &i.value() : nullptr;
+
+    ST_DEBUG2("ShadertoyRenderer: compiling pass " << pass.name
+              << " for projection " << proj);
+
+    // a failed variant is remembered and not compiled again
+    Program& prog = pass.programs[proj];
+    prog.shader = new QOpenGLShaderProgram();
+    if (!compileProgram(pass, proj, prog))
+    {
+        delete prog.shader;
+        prog.shader = nullptr;
+        return nullptr;
+    }
+    return &prog;
+}
+
+bool ShadertoyRenderer::Private::compileProgram(
+        const RenderPass& pass, Projection proj, Program& prog)
+{
+    auto gl = context->functions();
+
+    // -- load or compile shader --
+
+    const QString vertSource = ShadertoyRenderer::vertexSource(),
+                  fragSource = ShadertoyRenderer::fragmentSource(
+                                        pass.source, proj);
+    auto programCache = api->programCache();
+    const QByteArray programKey =
+            ProgramBinaryCache::key(vertSource, fragSource);
+
+    if (!programCache->load(prog.shader, programKey))
+    {
+        auto vert = new QOpenGLShader(QOpenGLShader::Vertex, prog.shader);
+        if (!vert->compileSourceCode(vertSource))
+        {
+            ST_RENDER_ERROR(tr("vertex compile failed (pass: %1):\n%2")
+                           .arg(pass.name)
+                           .arg(vert->log())
+                           );
+            return false;
+        }
+
+        auto frag = new QOpenGLShader(QOpenGLShader::Fragment, prog.shader);
+        if (!frag->compileSourceCode(fragSource))
+        {
+            ST_RENDER_ERROR(tr("compile failed (pass: %1):\n%2")
+                           .arg(pass.name)
+                           .arg(frag->log())
+                           );
+            return false;
+        }
+
+
+        // -- link shader --
+
+        if (   !prog.shader->addShader(vert)
+            || !prog.shader->addShader(frag)
+            || !prog.shader->link())
+        {
+            ST_RENDER_ERROR(tr("link failed:\n") + prog.shader->log());
+            return false;
+        }
+
+        programCache->store(prog.shader, programKey);
+    }
+    prog.shader->bind();
+
+    // -- get attributes and uniforms --
+
+    prog.a_position = prog.shader->attributeLocation("a_position");
+    prog.mvp_matrix = prog.shader->uniformLocation("mvp_matrix");
+    prog.iResolution = prog.shader->uniformLocation("iResolution");
+    prog.iGlobalTime = prog.shader->uniformLocation("iGlobalTime");
+    prog.iTimeDelta = prog.shader->uniformLocation("iTimeDelta");
+    prog.iFrame = prog.shader->uniformLocation("iFrame");
+    prog.iChannelTime = prog.shader->uniformLocation("iChannelTime[0]");
+    prog.iChannelResolution =
+            prog.shader->uniformLocation("iChannelResolution[0]");
+    prog.iMouse = prog.shader->uniformLocation("iMouse");
+    prog.iDate = prog.shader->uniformLocation("iDate");
+    prog.iSampleRate = prog.shader->uniformLocation("iSampleRate");
+    prog.iEyeMod = prog.shader->uniformLocation("_ST_eyeMod_");
+    for (int j=0; j<4; ++j)
+    {
+        prog.iChannel[j] = prog.shader->uniformLocation(
+                                QString("iChannel%1").arg(j));
+        if (prog.iChannel[j] >= 0)
+            prog.shader->setUniformValue(prog.iChannel[j], j);
+    }
+
+    ST_CHECK_GL( gl->glUseProgram(0) );
+    return true;
+}
+
+
+template <typename T>
+void ShadertoyRenderer::Private::setUniform(
+        Program& prog, int loc, T& last, const T& value)
+{
+    if (loc < 0)
+        return;
+    if (prog.uploaded && last == value)
+    {
+        ++frameStats.numUniformsSkipped;
+        return;
+    }
+    last = value;
+    ST_GL_COUNT( prog.shader->setUniformValue(loc, value) );
+    ++frameStats.numUniformUploads;
+}
+
 void ShadertoyRenderer::Private::destroyGl()
 {
     ST_DEBUG2("ShadertoyRenderer::destroyGl()");
@@ -671,9 +791,12 @@ void ShadertoyRenderer::Private::destroyGl()
 
     for (RenderPass& rp : passes)
     {
-        if (rp.shader && rp.shader->isLinked())
-            rp.shader->release();
-        delete rp.shader;
+        for (Program& prog : rp.programs)
+        {
+            if (prog.shader && prog.shader->isLinked())
+                prog.shader->release();
+            delete prog.shader;
+        }
 
         if (rp.fbo)
             rp.fbo->release();
@@ -684,13 +807,19 @@ void ShadertoyRenderer::Private::destroyGl()
 
 void ShadertoyRenderer::p_onTexture_(const QString &src, const QImage &img)
 {
+    // the api is shared, so the texture might be for someone else
+    bool used = false;
     for (Private::RenderPass& pass : p_->passes)
     {
         for (int i=0; i<4; ++i)
             if (pass.src[i] == src)
+            {
                 pass.img[i] = img;
+                used = true;
+            }
     }
-    emit rerender();
+    if (used)
+        emit rerender();
 }
 
 void ShadertoyRenderer::p_onAsset_(const QString &src)
@@ -803,6 +932,8 @@ bool ShadertoyRenderer::Private::renderSound(
 
 bool ShadertoyRenderer::Private::prepare(bool continuous)
 {
+    frameStats = FrameStats();
+
     if (!p->isReady() || needsRecompile)
     {
         destroyGl();
@@ -834,6 +965,11 @@ bool ShadertoyRenderer::Private::prepare(bool continuous)
     if (shadertoy.info().usesCamera)
         updateCameraTexture();
 
+    // before any pass binds the buffers as input
+    for (RenderPass& rp : passes)
+        if (rp.fbo && rp.fbo->size() != resolution)
+            rp.fbo->resize(resolution, doKeepBuffers);
+
     return true;
 }
 
@@ -845,7 +981,11 @@ bool ShadertoyRenderer::Private::drawQuad(
 
     auto gl = context->functions();
 
-    if (!pass.shader->bind())
+    Program* prog = program(pass);
+    if (!prog)
+        return false;
+
+    if (!ST_GL_COUNT( prog->shader->bind() ))
     {
         ST_RENDER_ERROR("Could not bind shader");
         return false;
@@ -857,7 +997,7 @@ bool ShadertoyRenderer::Private::drawQuad(
 
     for (int i=0; i<4; ++i)
     {
-        ST_CHECK_GL( gl->glActiveTexture(GL_TEXTURE0 + i) );
+        ST_CHECK_GL( ST_GL_COUNT( gl->glActiveTexture(GL_TEXTURE0 + i) ) );
         channelRes[i*3+0] = 0.f;
         channelRes[i*3+1] = 0.f;
         channelRes[i*3+2] = 1.f;
@@ -896,8 +1036,8 @@ bool ShadertoyRenderer::Private::drawQuad(
                                       << ").fbo[id="
                                       << pass.inputId[i] << ", tex=" << texName
                                       << "] to slot " << i);
-                            ST_CHECK_GL( gl->glBindTexture(GL_TEXTURE_2D,
-                                                           texName) );
+                            ST_CHECK_GL( ST_GL_COUNT(
+                                    gl->glBindTexture(GL_TEXTURE_2D, texName) ) );
                             channelRes[i*3+0] = opass->fbo->size().width();
                             channelRes[i*3+1] = opass->fbo->size().height();
                             channelRes[i*3+2] = opass->fbo->size().height() > 0
@@ -922,59 +1062,75 @@ bool ShadertoyRenderer::Private::drawQuad(
 
         ST_DEBUG3("pass(" << pass.name << "): bind texture "
                   << pass.tex[i] << " to slot " << i);
-        ST_CHECK_GL( pass.tex[i]->bind() );
+        ST_CHECK_GL( ST_GL_COUNT( pass.tex[i]->bind() ) );
 
-        ST_CHECK_GL( pass.tex[i]->setMinMagFilters(
+        ST_CHECK_GL( ST_GL_COUNT( pass.tex[i]->setMinMagFilters(
                          pass.filterType[i],
                          pass.filterType[i] == QOpenGLTexture::Nearest
-                         ? QOpenGLTexture::Nearest : QOpenGLTexture::Linear) );
-        ST_CHECK_GL( pass.tex[i]->setWrapMode(pass.wrapMode[i]) );
+                         ? QOpenGLTexture::Nearest : QOpenGLTexture::Linear) ) );
+        ST_CHECK_GL( ST_GL_COUNT( pass.tex[i]->setWrapMode(pass.wrapMode[i]) ) );
 
     }
 
 
     // --- bind geometry ---
 
-    if (!bufVert->bind())
+    if (!ST_GL_COUNT( bufVert->bind() ))
     {
         ST_RENDER_ERROR("Could not bind vertex buffer");
         return false;
     }
-    if (!bufIdx->bind())
+    if (!ST_GL_COUNT( bufIdx->bind() ))
     {
         ST_RENDER_ERROR("Could not bind index buffer");
         return false;
     }
 
-
     // --- update attributes and uniforms ---
 
-    pass.shader->setUniformValue(pass.mvp_matrix, projection);
-    pass.shader->setUniformValue(pass.iResolution,
-                                 float(resolution.width()),
-                                 float(resolution.height()),
-                                 float(resolution.width()) / resolution.height());
-    pass.shader->setUniformValue(pass.iMouse, mouseData);
-    pass.shader->setUniformValue(pass.iGlobalTime, globalTime);
-    pass.shader->setUniformValue(pass.iFrame, frameNumber);
-    pass.shader->setUniformValue(pass.iTimeDelta, float(deltaRenderTime));
-    pass.shader->setUniformValue(pass.iDate, dateData);
-    pass.shader->setUniformValue(pass.iEyeMod, eyeDistance, eyeRotation);
-    pass.shader->setUniformValueArray(
-                pass.iChannelResolution, channelRes, 4, 3);
-    pass.shader->setUniformValue(pass.iSampleRate, 44100.f);
+    // uniforms are program state, most values
+    // are the same as in the last frame
+    setUniform(*prog, prog->mvp_matrix, prog->lastMvp, projection);
+    setUniform(*prog, prog->iResolution, prog->lastResolution,
+               QVector3D(resolution.width(), resolution.height(),
+                         float(resolution.width()) / resolution.height()));
+    setUniform(*prog, prog->iMouse, prog->lastMouse, mouseData);
+    setUniform(*prog, prog->iGlobalTime, prog->lastTime, globalTime);
+    setUniform(*prog, prog->iFrame, prog->lastFrame, frameNumber);
+    setUniform(*prog, prog->iTimeDelta, prog->lastTimeDelta,
+               float(deltaRenderTime));
+    setUniform(*prog, prog->iDate, prog->lastDate, dateData);
+    // _ST_eyeMod_ is a vec4, a vec2 upload would be an error
+    setUniform(*prog, prog->iEyeMod, prog->lastEyeMod,
+               QVector4D(eyeDistance, eyeRotation, 0.f, 0.f));
+    setUniform(*prog, prog->iSampleRate, prog->lastSampleRate, 44100.f);
+    if (prog->iChannelResolution >= 0)
+    {
+        if (prog->uploaded && std::equal(channelRes, channelRes + 4*3,
+                                         prog->lastChannelRes))
+            ++frameStats.numUniformsSkipped;
+        else
+        {
+            std::copy(channelRes, channelRes + 4*3, prog->lastChannelRes);
+            ST_GL_COUNT( prog->shader->setUniformValueArray(
+                             prog->iChannelResolution, channelRes, 4, 3) );
+            ++frameStats.numUniformUploads;
+        }
+    }
+    prog->uploaded = true;
 
     // -- bind vertex array --
 
-    pass.shader->enableAttributeArray(pass.a_position);
-    pass.shader->setAttributeBuffer(pass.a_position, GL_FLOAT, 0, 2, 0);
+    ST_GL_COUNT( prog->shader->enableAttributeArray(prog->a_position) );
+    ST_GL_COUNT( prog->shader->setAttributeBuffer(
+                     prog->a_position, GL_FLOAT, 0, 2, 0) );
 
     // --- render ---
 
     // use given framebuffer
     if (dstFbo)
     {
-        dstFbo->bind();
+        ST_GL_COUNT( dstFbo->bind() );
     }
     else
     // use internal framebuffer for "Buf X" stages
@@ -986,20 +1142,22 @@ bool ShadertoyRenderer::Private::drawQuad(
         if (pass.fbo->size() != resolution)
             pass.fbo->create(resolution);
 
-        pass.fbo->bind();
+        ST_GL_COUNT( pass.fbo->bind() );
     }
 
-    ST_CHECK_GL( gl->glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT) );
-    ST_CHECK_GL(
-        gl->glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, nullptr) );
+    ST_CHECK_GL( ST_GL_COUNT(
+        gl->glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT) ) );
+    ST_CHECK_GL( ST_GL_COUNT(
+        gl->glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, nullptr) ) );
+    ++frameStats.numDraws;
 
     if (dstFbo)
-        dstFbo->unbind();
+        ST_GL_COUNT( dstFbo->unbind() );
     else
     if (pass.type == ShadertoyRenderPass::T_BUFFER && pass.fbo)
     {
-        pass.fbo->swapTexture();
-        pass.fbo->unbind();
+        ST_GL_COUNT( pass.fbo->swapTexture() );
+        ST_GL_COUNT( pass.fbo->unbind() );
     }
 
     return true;
@@ -16,6 +16,7 @@
 class QOpenGLContext;
 class QSurface;
 class ShadertoyShader;
+class ShadertoyRenderPass;
 class FramebufferObject;
 
 /** A self-contained class to render ShadertoyShader instances.
@@ -34,6 +35,21 @@ public:
         P_CROSS_EYE
     };
 
+    /** OpenGL work of the last render() call */
+    struct FrameStats
+    {
+        FrameStats() : numDraws(0), numGlCalls(0),
+                       numUniformUploads(0), numUniformsSkipped(0) { }
+        int numDraws,
+        /** All calls in the pass loop, including the uniform uploads
+            and framebuffer binds, counted at each call site.
+            Calls through Qt wrappers count as one. */
+            numGlCalls,
+            numUniformUploads,
+        /** Uniforms not uploaded since the program has the value */
+            numUniformsSkipped;
+    };
+
     explicit ShadertoyRenderer(QObject *parent = 0);
     explicit ShadertoyRenderer(QOpenGLContext* ctx, QObject *parent = 0);
     explicit ShadertoyRenderer(QOpenGLContext* ctx, QSurface*,
@@ -55,6 +71,15 @@ public:
 
     const QSize& resolution() const;
 
+    const FrameStats& frameStats() const;
+
+    /** The vertex shader of all passes */
+    static QString vertexSource();
+    /** The complete fragment shader of @p pass, as compiled for
+        the projection mode @p proj */
+    static QString fragmentSource(const ShadertoyRenderPass& pass,
+                                  Projection proj = P_RECT);
+
 signals:
 
     /** Emitted when a texture is loaded */
@@ -74,10 +99,19 @@ public slots:
 
     /** Sets/changes the resolution for the shader and all
         it's buffers. If the resolution changes, the next call
-        to render() will recompile everything. */
+        to render() reallocates the buffer passes' framebuffers,
+        the compiled programs and textures are kept. */
     void setResolution(const QSize& );
 
-    /** Sets the projection mode using the VR hook */
+    /** Scale the contents of the buffer passes to the new resolution
+        in setResolution(), so feedback effects survive a resize.
+        Otherwise the buffers start black. Default is true. */
+    void setKeepBuffersOnResize(bool enable);
+
+    /** Sets the projection mode using the VR hook.
+        Each mode is compiled once for the image pass on first use,
+        switching back is instant. Buffer passes always render
+        rectangular and keep their contents. */
     void setProjectionMode(Projection p);
 
     /** Sets mouse state */
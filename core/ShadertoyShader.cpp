@@ -22,15 +22,25 @@ QString ShadertoyShaderInfo::getUrl() const
 
 
 ShadertoyShader::ShadertoyShader(const QString& id)
+    : p_infoOnly_   (false)
 {
     p_info_.id = id;
 }
 
+ShadertoyShader ShadertoyShader::fromInfo(const ShadertoyShaderInfo& info)
+{
+    ShadertoyShader s;
+    s.p_info_ = info;
+    s.p_infoOnly_ = true;
+    return s;
+}
+
 bool ShadertoyShader::setJsonData(const QJsonObject& o)
 {
     p_json = o;
     p_passes_.clear();
     p_error_.clear();
+    p_infoOnly_ = false;
 
     // --- read info field ---
 
@@ -56,6 +66,7 @@ bool ShadertoyShader::setJsonData(const QJsonObject& o)
         p_info_.tags << t.toString();
 
     p_info_.numChars = 0; // will be counted below
+    p_info_.numPasses = 0;
     p_info_.usesTextures = false;
     p_info_.usesBuffers = false;
     p_info_.usesMusic = false;
@@ -63,6 +74,7 @@ bool ShadertoyShader::setJsonData(const QJsonObject& o)
     p_info_.usesCamera = false;
     p_info_.usesMicrophone = false;
     p_info_.usesKeyboard = false;
+    p_info_.usesMouse = false;
     p_info_.hasSound = false;
 
     // --- read render passes ---
@@ -94,6 +106,8 @@ bool ShadertoyShader::setJsonData(const QJsonObject& o)
 
         // -- update info --
 
+        p_info_.numPasses = p_passes_.size();
+
         p_info_.numChars += pass.fragmentSource().size();
 
         /** @todo "iMouse" could be commented out */
@@ -136,9 +150,44 @@ bool ShadertoyShader::setJsonData(const QJsonObject& o)
         }
     }
 
+    // the passes keep their own json, don't hold it twice
+    p_json.remove("renderpass");
+
     return true;
 }
 
+QJsonObject ShadertoyShader::jsonData() const
+{
+    if (p_infoOnly_)
+        return p_json;
+
+    QJsonArray rp;
+    for (const ShadertoyRenderPass& pass : p_passes_)
+        rp.append(pass.jsonData());
+
+    auto o = p_json;
+    o.insert("renderpass", rp);
+    return o;
+}
+
+size_t ShadertoyShader::memoryUsage() const
+{
+    // strings are utf-16, the info strings are also held in the json
+    size_t bytes = sizeof(ShadertoyShader)
+            + 4 * (p_info_.name.size() + p_info_.username.size()
+                   + p_info_.description.size());
+    for (const QString& tag : p_info_.tags)
+        bytes += 4 * tag.size();
+
+    for (const ShadertoyRenderPass& pass : p_passes_)
+        bytes += sizeof(ShadertoyRenderPass)
+                + 2 * pass.fragmentSource().size()
+                // rough size of the remaining pass/input json
+                + 256 * (1 + pass.numInputs());
+
+    return bytes;
+}
+
 QVector<ShadertoyRenderPass> ShadertoyShader::sortedRenderPasses() const
 {
     auto passes = p_passes_;
@@ -177,17 +226,12 @@ bool ShadertoyShader::containsString(const QString& s) const
 void ShadertoyShader::setRenderPass(
         size_t index, const ShadertoyRenderPass &pass)
 {
-    auto rp = p_json.value("renderpass").toArray();
-
     // XXX Todo: append or insert
-    if ((int)index >= rp.size())
+    if ((int)index >= p_passes_.size())
     {
         ST_WARN("ShadertoyShader::setRenderPass("<<index<<") out of range");
         return;
     }
 
-    p_passes_.resize(std::max(p_passes_.size(), (int)index+1));
     p_passes_[index] = pass;
-
-    rp[index] = pass.jsonData();
 }
@@ -16,7 +16,9 @@
 #include <QJsonObject>
 #include <QVector>
 
-/** Json-wrapper for a shadertoy input */
+/** Json-wrapper for a shadertoy input.
+    The json is parsed once in setJsonData(),
+    the getters return the typed fields. */
 class ShadertoyInput
 {
 public:
@@ -47,17 +49,19 @@ public:
         W_REPEAT
     };
 
+    ShadertoyInput();
+
     const QJsonObject& jsonData() const { return p_json; }
 
-    bool isValid() const { return type() != T_NONE; }
+    bool isValid() const { return p_type_ != T_NONE; }
 
-    int channel() const;
-    int id() const;
-    Type type() const;
-    FilterType filterType() const;
-    WrapMode wrapMode() const;
-    bool vFlip() const;
-    QString source() const;
+    int channel() const { return p_channel_; }
+    int id() const { return p_id_; }
+    Type type() const { return p_type_; }
+    FilterType filterType() const { return p_filterType_; }
+    WrapMode wrapMode() const { return p_wrapMode_; }
+    bool vFlip() const { return p_vFlip_; }
+    const QString& source() const { return p_source_; }
     QString typeName() const;
     QString filterTypeName() const;
     QString wrapModeName() const;
@@ -71,7 +75,7 @@ public:
 
     // --- setter ---
 
-    void setJsonData(const QJsonObject& o) { p_json = o; }
+    void setJsonData(const QJsonObject& o);
 
     void setChannel(int);
     void setId(int);
@@ -83,11 +87,19 @@ public:
 
 private:
     QJsonObject p_json;
+    int p_channel_, p_id_;
+    Type p_type_;
+    FilterType p_filterType_;
+    WrapMode p_wrapMode_;
+    bool p_vFlip_;
+    QString p_source_;
 };
 
 
 
-/** Json-wrapper for a single render pass */
+/** Json-wrapper for a single render pass.
+    The json is parsed once in setJsonData(),
+    the getters return the typed fields. */
 class ShadertoyRenderPass
 {
 public:
@@ -105,15 +117,19 @@ public:
 
     // ----- getter -----
 
-    const QJsonObject& jsonData() const { return p_json; }
+    /** The complete json object of the pass, including the code
+        and inputs. These are only kept once in fragmentSource() and
+        input() and inserted here on each call. */
+    QJsonObject jsonData() const;
 
-    bool isValid() const { return type() != T_NONE; }
+    bool isValid() const { return p_type_ != T_NONE; }
 
-    Type type() const;
+    Type type() const { return p_type_; }
     QString typeName() const;
-    QString name() const;
-    int outputId() const;
-    const QString& fragmentSource() const;
+    /** The name, or the typeName() if no name is given */
+    const QString& name() const { return p_name_; }
+    int outputId() const { return p_outputId_; }
+    const QString& fragmentSource() const { return p_fragSrc; }
 
     size_t numInputs() const { return p_inputs.size(); }
     const ShadertoyInput& input(size_t idx) const { return p_inputs[idx]; }
@@ -130,7 +146,9 @@ private:
     friend class ShadertoyShader;
     QJsonObject p_json;
     QVector<ShadertoyInput> p_inputs;
-    QString p_fragSrc;
+    QString p_fragSrc, p_name_;
+    Type p_type_;
+    int p_outputId_;
 };
 
 
@@ -144,6 +162,8 @@ struct ShadertoyShaderInfo
     QStringList tags;
     /** Number of characters of all passes (including comments) */
     size_t numChars;
+    /** Number of render passes */
+    int numPasses;
     /** Uses textures (not buffers) */
     bool usesTextures,
          usesBuffers,
@@ -167,14 +187,29 @@ class ShadertoyShader
 public:
     ShadertoyShader(const QString& id = "");
 
+    /** Creates a shader that only contains the info and no render passes.
+        Used for cache entries whose json has not been parsed. */
+    static ShadertoyShader fromInfo(const ShadertoyShaderInfo& info);
+
     // ----- getter -----
 
-    bool isValid() const { return !p_passes_.isEmpty() && p_error_.isEmpty(); }
+    bool isValid() const
+        { return (p_infoOnly_ || !p_passes_.isEmpty()) && p_error_.isEmpty(); }
+
+    /** Only info() is present, the json data and render passes
+        are not loaded. */
+    bool isInfoOnly() const { return p_infoOnly_; }
 
-    const QJsonObject& jsonData() { return p_json; }
+    /** The complete json object of the shader.
+        The render passes are only kept once in renderPass()
+        and inserted here on each call. */
+    QJsonObject jsonData() const;
 
     const ShadertoyShaderInfo& info() const { return p_info_; }
 
+    /** Approximate number of bytes held by this shader */
+    size_t memoryUsage() const;
+
     size_t numRenderPasses() const { return p_passes_.size(); }
     const ShadertoyRenderPass& renderPass(size_t idx) const
         { return p_passes_[idx]; }
@@ -194,6 +229,7 @@ private:
     QVector<ShadertoyRenderPass> p_passes_;
     QString p_error_;
     ShadertoyShaderInfo p_info_;
+    bool p_infoOnly_;
 };
 
 #endif // SHADERTOYSHADER_H
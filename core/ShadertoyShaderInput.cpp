@@ -19,10 +19,49 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
 ****************************************************************************/
 
 #include <QTextStream>
+#include <QJsonObject>
 
 #include "ShadertoyShader.h"
 #include "log.h"
 
+namespace {
+
+    ShadertoyInput::Type parseInputType(const QString& ctype)
+    {
+        if (ctype == "keyboard")
+            return ShadertoyInput::T_KEYBOARD;
+        else if (ctype == "musicstream")
+            return ShadertoyInput::T_MUSICSTREAM;
+        else if (ctype == "music")
+            return ShadertoyInput::T_MUSIC;
+        else if (ctype == "microphone")
+            return ShadertoyInput::T_MICROPHONE;
+        else if (ctype == "webcam")
+            return ShadertoyInput::T_CAMERA;
+        else if (ctype == "buffer")
+            return ShadertoyInput::T_BUFFER;
+        else if (ctype == "video")
+            return ShadertoyInput::T_VIDEO;
+        else if (ctype == "cubemap")
+            return ShadertoyInput::T_CUBEMAP;
+        else if (ctype == "texture")
+            return ShadertoyInput::T_TEXTURE;
+        else
+            return ShadertoyInput::T_NONE;
+    }
+
+    ShadertoyInput::FilterType parseFilterType(const QString& ftype)
+    {
+        if (ftype == "linear")
+            return ShadertoyInput::F_LINEAR;
+        else if (ftype == "mipmap")
+            return ShadertoyInput::F_MIPMAP;
+        else
+            return ShadertoyInput::F_NEAREST;
+    }
+
+} // namespace
+
 QString ShadertoyInput::toString() const
 {
     QString str;
@@ -66,19 +105,30 @@ bool ShadertoyInput::hasVFlipSetting() const
 }
 
 
-int ShadertoyInput::channel() const
+ShadertoyInput::ShadertoyInput()
+    : p_channel_    (0)
+    , p_id_         (0)
+    , p_type_       (T_NONE)
+    , p_filterType_ (F_NEAREST)
+    , p_wrapMode_   (W_CLAMP)
+    , p_vFlip_      (false)
 {
-    return p_json.value("channel").toInt();
 }
 
-int ShadertoyInput::id() const
+void ShadertoyInput::setJsonData(const QJsonObject& o)
 {
-    return p_json.value("id").toInt();
-}
+    p_json = o;
 
-QString ShadertoyInput::source() const
-{
-    return p_json.value("src").toString();
+    p_channel_ = p_json.value("channel").toInt();
+    p_id_ = p_json.value("id").toInt();
+    p_source_ = p_json.value("src").toString();
+    p_type_ = parseInputType(typeName());
+
+    auto sampler = p_json.value("sampler").toObject();
+    p_filterType_ = parseFilterType(sampler.value("filter").toString());
+    p_wrapMode_ = sampler.value("wrap").toString() == "repeat"
+            ? W_REPEAT : W_CLAMP;
+    p_vFlip_ = sampler.value("vflip").toString() == "true";
 }
 
 QString ShadertoyInput::typeName() const
@@ -86,82 +136,35 @@ QString ShadertoyInput::typeName() const
     return p_json.value("ctype").toString();
 }
 
-ShadertoyInput::Type ShadertoyInput::type() const
-{
-    const QString ctype = typeName();
-    if (ctype == "keyboard")
-        return ShadertoyInput::T_KEYBOARD;
-    else if (ctype == "musicstream")
-        return ShadertoyInput::T_MUSICSTREAM;
-    else if (ctype == "music")
-        return ShadertoyInput::T_MUSIC;
-    else if (ctype == "microphone")
-        return ShadertoyInput::T_MICROPHONE;
-    else if (ctype == "webcam")
-        return ShadertoyInput::T_CAMERA;
-    else if (ctype == "buffer")
-        return ShadertoyInput::T_BUFFER;
-    else if (ctype == "video")
-        return ShadertoyInput::T_VIDEO;
-    else if (ctype == "cubemap")
-        return ShadertoyInput::T_CUBEMAP;
-    else if (ctype == "texture")
-        return ShadertoyInput::T_TEXTURE;
-    else
-        return ShadertoyInput::T_NONE;
-}
-
 QString ShadertoyInput::filterTypeName() const
 {
     auto sampler = p_json.value("sampler").toObject();
     return sampler.value("filter").toString();
 }
 
-ShadertoyInput::FilterType ShadertoyInput::filterType() const
-{
-    const QString ftype = filterTypeName();
-
-    if (ftype == "linear")
-        return ShadertoyInput::F_LINEAR;
-    else if (ftype == "mipmap")
-        return ShadertoyInput::F_MIPMAP;
-    else
-        return ShadertoyInput::F_NEAREST;
-}
-
 QString ShadertoyInput::wrapModeName() const
 {
     auto sampler = p_json.value("sampler").toObject();
     return sampler.value("wrap").toString();
 }
 
-ShadertoyInput::WrapMode ShadertoyInput::wrapMode() const
-{
-    if (wrapModeName() == "repeat")
-        return ShadertoyInput::W_REPEAT;
-    else
-        return ShadertoyInput::W_CLAMP;
-}
-
-bool ShadertoyInput::vFlip() const
-{
-    auto sampler = p_json.value("sampler").toObject();
-    return sampler.value("vflip").toString() == "true";
-}
-
 
 void ShadertoyInput::setChannel(int c)
 {
     p_json.insert("channel", c);
+    p_channel_ = c;
 }
 
 void ShadertoyInput::setId(int c)
 {
     p_json.insert("id", c);
+    p_id_ = c;
 }
 
 void ShadertoyInput::setType(Type t)
 {
+    p_type_ = t;
+
     switch (t)
     {
         case ShadertoyInput::T_TEXTURE:
@@ -183,7 +186,7 @@ void ShadertoyInput::setType(Type t)
         case ShadertoyInput::T_CUBEMAP:
             p_json.insert("ctype", "cubemap"); break;
         case ShadertoyInput::T_NONE:
-            return;
+            p_json.remove("ctype"); break;
     }
 }
 
@@ -203,6 +206,7 @@ void ShadertoyInput::setFilterType(FilterType t)
             return;
     }
     p_json.insert("sampler", sampler);
+    p_filterType_ = t;
 }
 
 void ShadertoyInput::setWrapMode(WrapMode m)
@@ -219,6 +223,7 @@ void ShadertoyInput::setWrapMode(WrapMode m)
             return;
     }
     p_json.insert("sampler", sampler);
+    p_wrapMode_ = m;
 }
 
 void ShadertoyInput::setVFlip(bool e)
@@ -226,11 +231,13 @@ void ShadertoyInput::setVFlip(bool e)
     auto sampler = p_json.value("sampler").toObject();
     sampler.insert("vflip", e ? "true" : "false");
     p_json.insert("sampler", sampler);
+    p_vFlip_ = e;
 }
 
 void ShadertoyInput::setSource(const QString& s)
 {
     p_json.insert("src", s);
+    p_source_ = s;
 }
 
 
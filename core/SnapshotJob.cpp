@@ -0,0 +1,367 @@
+/***************************************************************************
+
+Copyright (C) 2016  stefan.berke @ modular-audio-graphics.com
+
+This source is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either
+version 3.0 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this software; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+****************************************************************************/
+
+#include <algorithm>
+
+#include <QImage>
+#include <QFileInfo>
+#include <QVector>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QWaitCondition>
+#include <QThread>
+#include <QThreadPool>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QtConcurrent/QtConcurrentRun>
+
+#include "SnapshotJob.h"
+#include "ShadertoyApi.h"
+#include "ShadertoyShader.h"
+#include "ShadertoyOffscreenRenderer.h"
+#include "log.h"
+
+struct SnapshotJob::Private
+{
+    Private(SnapshotJob* p)
+        : p             (p)
+        , api           (ShadertoyApi::acquire())
+        , numThreads    (std::max(1, QThread::idealThreadCount()))
+        , running       (false)
+        , resolution    (256, 256)
+        , overwrite     (false)
+        , paused        (false)
+        , numWorkers    (0)
+        , generation    (0)
+    { }
+
+    /** What a worker needs to render the next shader */
+    struct Task
+    {
+        QString id;
+        QSize resolution;
+        bool overwrite;
+        int generation;
+    };
+
+    void startWorkers();
+    void work(QOffscreenSurface* surface);
+    /** Blocks while paused, returns false when the queue is empty */
+    bool takeNext(Task& t);
+    void updateTime() { stats.seconds = double(timer.nsecsElapsed()) / 1.e9; }
+
+    SnapshotJob* p;
+    ShadertoyApi* api;
+    int numThreads;
+    /** A batch is in progress and finished() is still to be sent */
+    bool running;
+
+    Stats stats;
+    QElapsedTimer timer;
+    /** All created surfaces, they must be deleted in the gui thread */
+    QVector<QOffscreenSurface*> surfaces;
+
+    /** Guards the members below */
+    mutable QMutex mutex;
+    QWaitCondition resumed;
+    QStringList queue;
+    QSize resolution;
+    bool overwrite, paused;
+    int numWorkers;
+    /** Surfaces not used by a worker */
+    QVector<QOffscreenSurface*> idleSurfaces;
+    /** Increased by cancel(), drops the results in progress */
+    QAtomicInt generation;
+
+    QThreadPool pool;
+};
+
+SnapshotJob::SnapshotJob(QObject* parent)
+    : QObject       (parent)
+    , p_            (new Private(this))
+{
+    ST_DEBUG_CTOR("SnapshotJob()");
+}
+
+SnapshotJob::~SnapshotJob()
+{
+    ST_DEBUG_CTOR("~SnapshotJob()");
+    cancel();
+    p_->pool.waitForDone();
+    qDeleteAll(p_->surfaces);
+    p_->api->release();
+    delete p_;
+}
+
+int SnapshotJob::numThreads() const { return p_->numThreads; }
+const SnapshotJob::Stats& SnapshotJob::stats() const { return p_->stats; }
+
+const QSize& SnapshotJob::resolution() const
+{
+    // only changed in this thread
+    return p_->resolution;
+}
+
+bool SnapshotJob::isOverwrite() const
+{
+    QMutexLocker lock(&p_->mutex);
+    return p_->overwrite;
+}
+
+bool SnapshotJob::isPaused() const
+{
+    QMutexLocker lock(&p_->mutex);
+    return p_->paused;
+}
+
+bool SnapshotJob::isIdle() const
+{
+    QMutexLocker lock(&p_->mutex);
+    return p_->queue.isEmpty() && !p_->numWorkers;
+}
+
+int SnapshotJob::numQueued() const
+{
+    QMutexLocker lock(&p_->mutex);
+    return p_->queue.size();
+}
+
+double SnapshotJob::progress() const
+{
+    const Stats& s = p_->stats;
+    return s.numRequests ? 100. * s.numDone() / s.numRequests : 100.;
+}
+
+void SnapshotJob::setNumThreads(int num)
+{
+    p_->numThreads = std::max(1, num);
+    if (p_->running)
+        p_->startWorkers();
+}
+
+void SnapshotJob::setResolution(const QSize& res)
+{
+    QMutexLocker lock(&p_->mutex);
+    p_->resolution = res;
+}
+
+void SnapshotJob::setOverwrite(bool enable)
+{
+    QMutexLocker lock(&p_->mutex);
+    p_->overwrite = enable;
+}
+
+void SnapshotJob::enqueue(const QStringList& ids)
+{
+    ST_DEBUG2("SnapshotJob::enqueue(" << ids.size() << " ids)");
+
+    if (ids.isEmpty())
+        return;
+
+    if (!p_->running)
+    {
+        p_->stats = Stats();
+        p_->timer.start();
+        p_->running = true;
+    }
+    p_->stats.numRequests += ids.size();
+
+    {
+        QMutexLocker lock(&p_->mutex);
+        for (const QString& id : ids)
+        {
+            if (p_->api->isRenderBlocked(id))
+                ++p_->stats.numSkipped;
+            else
+                p_->queue << id;
+        }
+    }
+    p_->startWorkers();
+
+    // everything skipped
+    p_onWorkerDone_();
+}
+
+void SnapshotJob::pause()
+{
+    QMutexLocker lock(&p_->mutex);
+    p_->paused = true;
+}
+
+void SnapshotJob::resume()
+{
+    QMutexLocker lock(&p_->mutex);
+    p_->paused = false;
+    p_->resumed.wakeAll();
+}
+
+void SnapshotJob::cancel()
+{
+    ST_DEBUG2("SnapshotJob::cancel()");
+
+    QMutexLocker lock(&p_->mutex);
+    p_->generation.fetchAndAddOrdered(1);
+    p_->queue.clear();
+    p_->paused = false;
+    p_->resumed.wakeAll();
+}
+
+void SnapshotJob::Private::startWorkers()
+{
+    QMutexLocker lock(&mutex);
+
+    if (!numWorkers && !QOpenGLContext::supportsThreadedOpenGL())
+        ST_WARN("SnapshotJob: the platform does not support "
+                "OpenGL in worker threads");
+
+    pool.setMaxThreadCount(numThreads);
+    while (numWorkers < numThreads && numWorkers < queue.size())
+    {
+        QOffscreenSurface* surface;
+        if (!idleSurfaces.isEmpty())
+            surface = idleSurfaces.takeLast();
+        else
+        {
+            surface = ShadertoyOffscreenRenderer::createSurface();
+            if (!surface)
+                break;
+            surfaces << surface;
+        }
+
+        ++numWorkers;
+        QtConcurrent::run(&pool, [=](){ work(surface); });
+    }
+
+    if (numWorkers || queue.isEmpty())
+        return;
+
+    ST_ERROR("SnapshotJob: no offscreen surface, dropping "
+             << queue.size() << " shaders");
+    stats.numFailed += queue.size();
+    queue.clear();
+    lock.unlock();
+
+    running = false;
+    updateTime();
+    emit p->finished();
+}
+
+bool SnapshotJob::Private::takeNext(Task& t)
+{
+    QMutexLocker lock(&mutex);
+
+    while (paused && !queue.isEmpty())
+        resumed.wait(&mutex);
+
+    if (queue.isEmpty())
+        return false;
+
+    t.id = queue.takeFirst();
+    t.resolution = resolution;
+    t.overwrite = overwrite;
+    t.generation = generation.load();
+    return true;
+}
+
+void SnapshotJob::Private::work(QOffscreenSurface* surface)
+{
+    {
+        // context and renderer live in this thread
+        ShadertoyOffscreenRenderer renderer;
+        renderer.setSurface(surface);
+
+        Task t;
+        while (takeNext(t))
+        {
+            // a null image without error means skipped
+            QImage img;
+            QString error;
+            if (t.overwrite || !QFileInfo(api->snapshotFilename(t.id)).exists())
+            {
+                const ShadertoyShader shader = api->loadShaderBody(t.id);
+                if (!shader.isValid())
+                    error = QString("shader not loaded");
+                else
+                {
+                    renderer.setShader(shader);
+                    img = renderer.renderToImage(t.resolution);
+                    if (img.isNull())
+                        error = QString("render failed");
+                    else if (!api->saveSnapshot(t.id, img))
+                        error = QString("png not saved");
+                }
+            }
+
+            QMetaObject::invokeMethod(p, "p_onRendered_", Qt::QueuedConnection,
+                                      Q_ARG(QString, t.id),
+                                      Q_ARG(QImage, img),
+                                      Q_ARG(QString, error),
+                                      Q_ARG(int, t.generation));
+        }
+    }
+
+    {
+        QMutexLocker lock(&mutex);
+        --numWorkers;
+        idleSurfaces << surface;
+    }
+    QMetaObject::invokeMethod(p, "p_onWorkerDone_", Qt::QueuedConnection);
+}
+
+void SnapshotJob::p_onRendered_(const QString& id, const QImage& img,
+                                const QString& error, int generation)
+{
+    if (generation != p_->generation.load())
+        return;
+
+    if (!error.isEmpty())
+    {
+        ++p_->stats.numFailed;
+        ST_WARN("SnapshotJob: '" << id << "' failed, " << error);
+        emit snapshotFailed(id, error);
+    }
+    else if (img.isNull())
+        ++p_->stats.numSkipped;
+    else
+    {
+        ++p_->stats.numRendered;
+        p_->api->storeSnapshot(id, img);
+        emit snapshotReady(id);
+    }
+
+    p_->updateTime();
+    emit progressChanged(progress());
+}
+
+void SnapshotJob::p_onWorkerDone_()
+{
+    if (!p_->running || !isIdle())
+        return;
+
+    p_->running = false;
+    p_->updateTime();
+    ST_DEBUG2("SnapshotJob: " << p_->stats.numRendered << " rendered, "
+              << p_->stats.numSkipped << " skipped, "
+              << p_->stats.numFailed << " failed in "
+              << p_->stats.seconds << " sec");
+    emit finished();
+}
@@ -0,0 +1,124 @@
+/***************************************************************************
+
+Copyright (C) 2016  stefan.berke @ modular-audio-graphics.com
+
+This source is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either
+version 3.0 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this software; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+****************************************************************************/
+
+#ifndef SNAPSHOTJOB_H
+#define SNAPSHOTJOB_H
+
+#include <QObject>
+#include <QSize>
+#include <QStringList>
+
+class QImage;
+class ShadertoyApi;
+
+/** Renders snapshots of many shaders in worker threads.
+
+    Each worker owns an offscreen OpenGL context and renderer and takes
+    ids from a shared queue until it is empty. The pngs are written by
+    the workers, the rendered images are added to the thumbnail store
+    in the gui thread, see ShadertoyApi::storeSnapshot().
+    Shaders that already have a snapshot png are skipped,
+    unless setOverwrite() is enabled, as well as shaders on the
+    render blocklist, see ShadertoyApi::isRenderBlocked().
+
+    The job can be paused, which lets the workers finish their current
+    shader and wait, or cancelled, which drops the queue.
+
+    With a software OpenGL like Mesa's llvmpipe the workers scale with
+    the number of cores. llvmpipe rasterizes each context with
+    LP_NUM_THREADS threads itself, so with several workers this
+    variable should be set to 1 before the first context is created.
+    On a headless box the contexts need a display, e.g. from Xvfb.
+*/
+class SnapshotJob : public QObject
+{
+    Q_OBJECT
+public:
+    struct Stats
+    {
+        Stats() : numRequests(0), numRendered(0), numSkipped(0),
+                  numFailed(0), seconds(0.) { }
+        int numRequests, numRendered, numSkipped, numFailed;
+        double seconds;
+        int numDone() const { return numRendered + numSkipped + numFailed; }
+        double imagesPerSecond() const
+            { return seconds > 0. ? numRendered / seconds : 0.; }
+    };
+
+    explicit SnapshotJob(QObject* parent = nullptr);
+    /** Cancels the job and waits for the workers */
+    ~SnapshotJob();
+
+    // --- getter ---
+
+    /** Default is QThread::idealThreadCount() */
+    int numThreads() const;
+    /** Default is 256x256 */
+    const QSize& resolution() const;
+    bool isOverwrite() const;
+    bool isPaused() const;
+    /** No shaders are queued or rendered */
+    bool isIdle() const;
+    int numQueued() const;
+    /** Statistics of the current or last batch */
+    const Stats& stats() const;
+    /** Percent of the current batch that is done */
+    double progress() const;
+
+    // --- setter ---
+
+    /** Applies to workers started afterwards */
+    void setNumThreads(int num);
+    void setResolution(const QSize& res);
+    /** Render shaders that already have a snapshot png */
+    void setOverwrite(bool enable);
+
+public slots:
+
+    /** Appends @p ids to the queue and starts the workers */
+    void enqueue(const QStringList& ids);
+
+    /** Workers finish their current shader and wait */
+    void pause();
+    void resume();
+    /** Drops the queue and all results still in progress */
+    void cancel();
+
+signals:
+
+    /** A snapshot of @p id has been rendered and saved */
+    void snapshotReady(const QString& id);
+    void snapshotFailed(const QString& id, const QString& error);
+    void progressChanged(double percent);
+    /** All queued shaders are done or the job was cancelled */
+    void finished();
+
+private slots:
+
+    void p_onRendered_(const QString& id, const QImage& img,
+                       const QString& error, int generation);
+    void p_onWorkerDone_();
+
+private:
+    struct Private;
+    Private* p_;
+};
+
+#endif // SNAPSHOTJOB_H
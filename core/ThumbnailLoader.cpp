@@ -0,0 +1,296 @@
+/***************************************************************************
+
+Copyright (C) 2016  stefan.berke @ modular-audio-graphics.com
+
+This source is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either
+version 3.0 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this software; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+****************************************************************************/
+
+#include <algorithm>
+
+#include <QImage>
+#include <QImageReader>
+#include <QCache>
+#include <QSet>
+#include <QVector>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThreadPool>
+#include <QAtomicInt>
+#include <QtConcurrent/QtConcurrentRun>
+
+#include "ThumbnailLoader.h"
+#include "ThumbnailStore.h"
+#include "log.h"
+
+struct ThumbnailLoader::Private
+{
+    Private(ThumbnailLoader* p)
+        : p             (p)
+        , size          (48, 48)
+        , store         (nullptr)
+        , cache         (16 << 10)
+        , maxQueued     (256)
+        , numWorkers    (0)
+        , generation    (0)
+    {
+        pool.setMaxThreadCount(2);
+    }
+
+    struct Request
+    {
+        QString id, filename;
+    };
+
+    void pump();
+    void work();
+    QImage decode(const Request& r, const QSize& size) const;
+    int cost(const QPixmap& pix) const
+        { return std::max(1, pix.width() * pix.height() * 4 >> 10); }
+    /** The store if it has tiles of the thumbnail size */
+    ThumbnailStore* usableStore() const
+        { return store && store->tileSize() == size ? store : nullptr; }
+
+    ThumbnailLoader* p;
+    QSize size;
+    ThumbnailStore* store;
+
+    /** Cost in KiB */
+    QCache<QString, QPixmap> cache;
+    /** Requested and not yet finished */
+    QSet<QString> pending, missing;
+
+    /** Guards the members below */
+    mutable QMutex mutex;
+    /** Last requested at the end */
+    QVector<Request> queue;
+    int maxQueued, numWorkers;
+    QSize workSize;
+    /** Increased by clear(), drops results of older requests */
+    QAtomicInt generation;
+
+    QThreadPool pool;
+};
+
+ThumbnailLoader::ThumbnailLoader(QObject* parent)
+    : QObject       (parent)
+    , p_            (new Private(this))
+{
+    ST_DEBUG_CTOR("ThumbnailLoader()");
+    p_->workSize = p_->size;
+}
+
+ThumbnailLoader::~ThumbnailLoader()
+{
+    ST_DEBUG_CTOR("~ThumbnailLoader()");
+    {
+        QMutexLocker lock(&p_->mutex);
+        p_->queue.clear();
+    }
+    p_->pool.waitForDone();
+    delete p_;
+}
+
+const QSize& ThumbnailLoader::thumbnailSize() const { return p_->size; }
+qint64 ThumbnailLoader::cacheBudget() const
+    { return qint64(p_->cache.maxCost()) << 10; }
+qint64 ThumbnailLoader::cacheUsage() const
+    { return qint64(p_->cache.totalCost()) << 10; }
+bool ThumbnailLoader::isMissing(const QString& id) const
+    { return p_->missing.contains(id); }
+
+int ThumbnailLoader::maxQueued() const
+{
+    QMutexLocker lock(&p_->mutex);
+    return p_->maxQueued;
+}
+
+void ThumbnailLoader::setThumbnailSize(const QSize& size)
+{
+    if (size == p_->size)
+        return;
+    p_->size = size;
+    clear();
+    QMutexLocker lock(&p_->mutex);
+    p_->workSize = size;
+}
+
+void ThumbnailLoader::setCacheBudget(qint64 bytes)
+{
+    p_->cache.setMaxCost(int(std::max(qint64(1), bytes >> 10)));
+}
+
+void ThumbnailLoader::setMaxQueued(int num)
+{
+    QMutexLocker lock(&p_->mutex);
+    p_->maxQueued = std::max(1, num);
+}
+
+void ThumbnailLoader::setMaxThreads(int num)
+{
+    p_->pool.setMaxThreadCount(std::max(1, num));
+}
+
+void ThumbnailLoader::setStore(ThumbnailStore* store)
+{
+    p_->store = store;
+}
+
+void ThumbnailLoader::remove(const QString& id)
+{
+    p_->cache.remove(id);
+    p_->missing.remove(id);
+}
+
+void ThumbnailLoader::clear()
+{
+    p_->generation.fetchAndAddOrdered(1);
+    p_->cache.clear();
+    p_->pending.clear();
+    p_->missing.clear();
+    QMutexLocker lock(&p_->mutex);
+    p_->queue.clear();
+}
+
+QPixmap ThumbnailLoader::thumbnail(const QString& id, const QString& filename)
+{
+    if (QPixmap* pix = p_->cache.object(id))
+        return *pix;
+
+    if (p_->missing.contains(id))
+        return QPixmap();
+
+    // mapped tiles need no decoding
+    if (auto store = p_->usableStore())
+    {
+        const QImage img = store->image(id);
+        if (!img.isNull())
+        {
+            const QPixmap pix = QPixmap::fromImage(img);
+            p_->cache.insert(id, new QPixmap(pix), p_->cost(pix));
+            return pix;
+        }
+    }
+
+    QMutexLocker lock(&p_->mutex);
+
+    if (p_->pending.contains(id))
+    {
+        // requested again, so it is still visible, move to the top
+        for (int i=p_->queue.size()-1; i>=0; --i)
+            if (p_->queue[i].id == id)
+            {
+                Private::Request r = p_->queue[i];
+                p_->queue.remove(i);
+                p_->queue << r;
+                break;
+            }
+        return QPixmap();
+    }
+
+    Private::Request r;
+    r.id = id;
+    r.filename = filename;
+    p_->queue << r;
+    p_->pending.insert(id);
+
+    // drop the oldest requests, they scrolled out of view
+    if (p_->queue.size() > p_->maxQueued)
+    {
+        const int num = p_->queue.size() - p_->maxQueued;
+        for (int i=0; i<num; ++i)
+            p_->pending.remove(p_->queue[i].id);
+        p_->queue.remove(0, num);
+    }
+
+    p_->pump();
+    return QPixmap();
+}
+
+void ThumbnailLoader::Private::pump()
+{
+    // mutex is locked
+    while (numWorkers < pool.maxThreadCount() && !queue.isEmpty()
+           && numWorkers < queue.size())
+    {
+        ++numWorkers;
+        QtConcurrent::run(&pool, [=](){ work(); });
+    }
+}
+
+void ThumbnailLoader::Private::work()
+{
+    for (;;)
+    {
+        Request r;
+        QSize s;
+        int gen;
+        {
+            QMutexLocker lock(&mutex);
+            if (queue.isEmpty())
+            {
+                --numWorkers;
+                return;
+            }
+            r = queue.takeLast();
+            s = workSize;
+            gen = generation.load();
+        }
+
+        const QImage img = decode(r, s);
+        QMetaObject::invokeMethod(p, "p_onDecoded_", Qt::QueuedConnection,
+                                  Q_ARG(QString, r.id), Q_ARG(QImage, img),
+                                  Q_ARG(int, gen));
+    }
+}
+
+QImage ThumbnailLoader::Private::decode(
+        const Request& r, const QSize& size) const
+{
+    QImageReader reader(r.filename);
+    if (!reader.canRead())
+        return QImage();
+
+    // let the decoder produce the final size where it can
+    reader.setScaledSize(size);
+    QImage img = reader.read();
+    if (img.isNull())
+        ST_DEBUG2("ThumbnailLoader: could not read '" << r.filename << "', "
+                  << reader.errorString());
+    return img;
+}
+
+void ThumbnailLoader::p_onDecoded_(
+        const QString& id, const QImage& img, int generation)
+{
+    if (generation != p_->generation.load())
+        return;
+    p_->pending.remove(id);
+
+    if (img.isNull())
+    {
+        p_->missing.insert(id);
+        return;
+    }
+
+    if (auto store = p_->usableStore())
+        store->append(id, img);
+
+    // QPixmap must be created in the gui thread
+    auto pix = new QPixmap(QPixmap::fromImage(img));
+    p_->cache.insert(id, pix, p_->cost(*pix));
+
+    emit thumbnailReady(id);
+}
@@ -0,0 +1,101 @@
+/***************************************************************************
+
+Copyright (C) 2016  stefan.berke @ modular-audio-graphics.com
+
+This source is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either
+version 3.0 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this software; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+****************************************************************************/
+
+#ifndef THUMBNAILLOADER_H
+#define THUMBNAILLOADER_H
+
+#include <QObject>
+#include <QPixmap>
+#include <QSize>
+
+class QImage;
+class ThumbnailStore;
+
+/** Decodes thumbnail images in worker threads.
+
+    thumbnail() returns a cached pixmap or a null pixmap and queues the
+    file for decoding. Decoding asks the image reader for the final
+    size directly. Requests are served last-in-first-out, so the rows
+    a view painted most recently, which are the visible ones, come
+    first. Requests beyond maxQueued() are dropped, starting with the
+    oldest.
+
+    Decoded pixmaps are kept in an LRU cache with a memory budget.
+    thumbnailReady() is emitted for each finished image.
+
+    With a ThumbnailStore of the same tile size, stored tiles are
+    returned directly and decoded files are appended to the store.
+*/
+class ThumbnailLoader : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ThumbnailLoader(QObject* parent = nullptr);
+    ~ThumbnailLoader();
+
+    // --- getter ---
+
+    const QSize& thumbnailSize() const;
+    /** Maximum memory of the cached pixmaps in bytes */
+    qint64 cacheBudget() const;
+    /** Memory of the cached pixmaps in bytes */
+    qint64 cacheUsage() const;
+    int maxQueued() const;
+
+    /** Returns the cached thumbnail, or a null pixmap and starts
+        loading @p filename if not already done. */
+    QPixmap thumbnail(const QString& id, const QString& filename);
+
+    /** The image file could not be read, thumbnail() will not
+        try again until clear() or remove() */
+    bool isMissing(const QString& id) const;
+
+    // --- setter ---
+
+    /** Changing the size clears the cache */
+    void setThumbnailSize(const QSize& size);
+    void setCacheBudget(qint64 bytes);
+    void setMaxQueued(int num);
+    void setMaxThreads(int num);
+    /** Uses the tiles of @p store, no ownership is taken */
+    void setStore(ThumbnailStore* store);
+
+public slots:
+
+    /** Drops the cached thumbnail of @p id */
+    void remove(const QString& id);
+    /** Drops all cached thumbnails and queued requests */
+    void clear();
+
+signals:
+
+    /** The thumbnail of @p id can be requested with thumbnail() */
+    void thumbnailReady(const QString& id);
+
+private slots:
+
+    void p_onDecoded_(const QString& id, const QImage& img, int generation);
+
+private:
+    struct Private;
+    Private* p_;
+};
+
+#endif // THUMBNAILLOADER_H
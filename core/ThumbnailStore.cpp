@@ -0,0 +1,367 @@
+/***************************************************************************
+
+Copyright (C) 2016  stefan.berke @ modular-audio-graphics.com
+
+This source is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either
+version 3.0 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this software; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+****************************************************************************/
+
+#include <cstring>
+#include <algorithm>
+
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QImageReader>
+
+#include "ThumbnailStore.h"
+#include "log.h"
+
+namespace {
+
+    const char storeMagic[8] = { 'S','T','T','H','U','M','B','\0' };
+    const quint32 byteOrderMark = 0x01020304;
+    const quint32 tileMarker = 0x454c4954; // "TILE"
+
+    struct Header
+    {
+        char magic[8];
+        quint32 byteOrder, version, tileWidth, tileHeight,
+                imageFormat, bytesPerLine;
+    };
+
+    struct RecordHeader
+    {
+        char id[16];
+        quint32 marker, reserved;
+        quint64 reserved2;
+    };
+
+    static_assert(sizeof(Header) == 32, "unexpected padding in Header");
+    static_assert(sizeof(RecordHeader) == 32,
+                  "unexpected padding in RecordHeader");
+
+    const QImage::Format tileFormat = QImage::Format_RGB888;
+
+    /** Smallest region mapped for appended records */
+    const qint64 minMapChunk = qint64(4) << 20;
+
+    /** Zero-padded latin1 id, truncated to 16 chars */
+    void copyId(char* dst, const QString& id)
+    {
+        std::memset(dst, 0, 16);
+        auto l1 = id.toLatin1();
+        std::memcpy(dst, l1.constData(), std::min(l1.size(), 16));
+    }
+
+} // namespace
+
+const int ThumbnailStore::version = 1;
+
+ThumbnailStore::ThumbnailStore()
+    : p_file_           (nullptr)
+    , p_bytesPerLine_   (0)
+    , p_size_           (0)
+    , p_mapped_         (0)
+{
+    ST_DEBUG_CTOR("ThumbnailStore()");
+}
+
+ThumbnailStore::~ThumbnailStore()
+{
+    ST_DEBUG_CTOR("~ThumbnailStore()");
+    close();
+}
+
+qint64 ThumbnailStore::recordSize() const
+{
+    return sizeof(RecordHeader) + qint64(p_tileSize_.height()) * p_bytesPerLine_;
+}
+
+void ThumbnailStore::close()
+{
+    if (p_file_)
+    {
+        for (uchar* m : p_maps_)
+            p_file_->unmap(m);
+        delete p_file_;
+    }
+    p_file_ = nullptr;
+    p_maps_.clear();
+    p_tiles_.clear();
+    p_size_ = 0;
+    p_mapped_ = 0;
+    p_filename_.clear();
+}
+
+bool ThumbnailStore::create(const QString& filename, const QSize& tileSize)
+{
+    ST_DEBUG("Creating thumbnail store '" << filename << "'");
+
+    QFile file(filename);
+    if (!file.open(QFile::WriteOnly))
+    {
+        ST_ERROR("Could not create thumbnail store '" << filename << "', "
+                 << file.errorString());
+        return false;
+    }
+
+    Header header;
+    std::memcpy(header.magic, storeMagic, 8);
+    header.byteOrder = byteOrderMark;
+    header.version = version;
+    header.tileWidth = tileSize.width();
+    header.tileHeight = tileSize.height();
+    header.imageFormat = tileFormat;
+    header.bytesPerLine = (tileSize.width() * 3 + 3) & ~3;
+    if (file.write(reinterpret_cast<const char*>(&header), sizeof(Header))
+            != qint64(sizeof(Header)))
+    {
+        ST_ERROR("Could not write thumbnail store '" << filename << "', "
+                 << file.errorString());
+        return false;
+    }
+    return true;
+}
+
+bool ThumbnailStore::open(const QString& filename, const QSize& tileSize)
+{
+    ST_DEBUG2("ThumbnailStore::open('" << filename << "')");
+
+    close();
+
+    if (!QFileInfo(filename).exists() && !create(filename, tileSize))
+        return false;
+
+    p_file_ = new QFile(filename);
+    if (!p_file_->open(QFile::ReadWrite))
+    {
+        ST_ERROR("Could not open thumbnail store '" << filename << "', "
+                 << p_file_->errorString());
+        close();
+        return false;
+    }
+
+    p_size_ = p_file_->size();
+    Header header;
+    if (p_size_ < qint64(sizeof(Header))
+        || p_file_->read(reinterpret_cast<char*>(&header), sizeof(Header))
+                != qint64(sizeof(Header))
+        || std::memcmp(header.magic, storeMagic, 8) != 0
+        || header.byteOrder != byteOrderMark)
+    {
+        ST_ERROR("'" << filename << "' is not a thumbnail store "
+                 "or has a different byte order");
+        close();
+        return false;
+    }
+    if (header.version != quint32(version)
+        || header.imageFormat != quint32(tileFormat))
+    {
+        ST_ERROR("Thumbnail store '" << filename << "' has unsupported "
+                 "version " << header.version);
+        close();
+        return false;
+    }
+
+    p_tileSize_ = QSize(header.tileWidth, header.tileHeight);
+    p_bytesPerLine_ = header.bytesPerLine;
+    if (p_tileSize_.isEmpty()
+        || p_bytesPerLine_ < p_tileSize_.width() * 3)
+    {
+        ST_ERROR("Thumbnail store '" << filename << "' has a corrupt header");
+        close();
+        return false;
+    }
+    p_filename_ = filename;
+
+    // ignore a partly written last record
+    const qint64 num = (p_size_ - qint64(sizeof(Header))) / recordSize();
+    p_size_ = qint64(sizeof(Header)) + num * recordSize();
+    p_mapped_ = p_size_;
+
+    if (num)
+    {
+        uchar* data = p_file_->map(0, p_size_);
+        if (!data)
+        {
+            ST_ERROR("Could not map thumbnail store '" << filename << "', "
+                     << p_file_->errorString());
+            close();
+            return false;
+        }
+        p_maps_ << data;
+
+        p_tiles_.reserve(int(num));
+        for (qint64 i=0; i<num; ++i)
+        {
+            const qint64 offset = qint64(sizeof(Header)) + i * recordSize();
+            addRecord(data + offset, offset);
+        }
+    }
+
+    ST_DEBUG2("ThumbnailStore: mapped " << p_tiles_.size() << " tiles");
+    return true;
+}
+
+void ThumbnailStore::addRecord(const uchar* record, qint64 offset)
+{
+    auto h = reinterpret_cast<const RecordHeader*>(record);
+    if (h->marker != tileMarker)
+        return;
+    Tile t;
+    t.pixels = record + sizeof(RecordHeader);
+    t.offset = offset + qint64(sizeof(RecordHeader));
+    p_tiles_.insert(QString::fromLatin1(h->id, int(qstrnlen(h->id, 16))), t);
+}
+
+QImage ThumbnailStore::image(const QString& id) const
+{
+    auto i = p_tiles_.constFind(id);
+    if (i == p_tiles_.constEnd())
+        return QImage();
+    if (i.value().pixels)
+        return QImage(i.value().pixels,
+                      p_tileSize_.width(), p_tileSize_.height(),
+                      p_bytesPerLine_, tileFormat);
+
+    // not mapped yet
+    const QByteArray data = p_file_->seek(i.value().offset)
+            ? p_file_->read(qint64(p_tileSize_.height()) * p_bytesPerLine_)
+            : QByteArray();
+    if (data.size() != p_tileSize_.height() * p_bytesPerLine_)
+    {
+        ST_ERROR("Could not read tile '" << id << "' from thumbnail store '"
+                 << p_filename_ << "', " << p_file_->errorString());
+        return QImage();
+    }
+    QImage img(p_tileSize_, tileFormat);
+    for (int y=0; y<img.height(); ++y)
+        std::memcpy(img.scanLine(y), data.constData() + y * p_bytesPerLine_,
+                    img.width() * 3);
+    return img;
+}
+
+bool ThumbnailStore::append(const QString& id, const QImage& img)
+{
+    if (!p_file_ || img.isNull())
+        return false;
+
+    ST_DEBUG2("ThumbnailStore::append('" << id << "')");
+
+    if (!writeRecord(id, img))
+        return false;
+    return p_size_ - p_mapped_ < mapChunkSize() || mapRecords();
+}
+
+bool ThumbnailStore::writeRecord(const QString& id, const QImage& img)
+{
+    QImage tile = img.scaled(p_tileSize_, Qt::IgnoreAspectRatio,
+                             Qt::SmoothTransformation)
+                     .convertToFormat(tileFormat);
+
+    QByteArray record(int(recordSize()), 0);
+    auto h = reinterpret_cast<RecordHeader*>(record.data());
+    copyId(h->id, id);
+    h->marker = tileMarker;
+    for (int y=0; y<tile.height(); ++y)
+        std::memcpy(record.data() + sizeof(RecordHeader) + y * p_bytesPerLine_,
+                    tile.constScanLine(y), tile.width() * 3);
+
+    // one write, a crash leaves at most a partial record at the end
+    if (!p_file_->seek(p_size_)
+        || p_file_->write(record) != record.size()
+        || !p_file_->flush())
+    {
+        ST_ERROR("Could not append to thumbnail store '" << p_filename_
+                 << "', " << p_file_->errorString());
+        return false;
+    }
+
+    Tile t;
+    t.pixels = nullptr;
+    t.offset = p_size_ + qint64(sizeof(RecordHeader));
+    p_tiles_.insert(id, t);
+
+    p_size_ += record.size();
+    return true;
+}
+
+qint64 ThumbnailStore::mapChunkSize() const
+{
+    return std::max(minMapChunk, p_mapped_ / 2);
+}
+
+bool ThumbnailStore::mapRecords()
+{
+    const qint64 begin = p_mapped_;
+    if (begin >= p_size_)
+        return true;
+
+    uchar* data = p_file_->map(begin, p_size_ - begin);
+    if (!data)
+    {
+        ST_ERROR("Could not map thumbnail store '" << p_filename_ << "', "
+                 << p_file_->errorString());
+        return false;
+    }
+    p_maps_ << data;
+    p_mapped_ = p_size_;
+
+    for (qint64 i=0; i < (p_size_ - begin) / recordSize(); ++i)
+        addRecord(data + i * recordSize(), begin + i * recordSize());
+    return true;
+}
+
+int ThumbnailStore::importDirectory(const QString& path)
+{
+    ST_DEBUG2("ThumbnailStore::importDirectory('" << path << "')");
+
+    if (!p_file_)
+        return -1;
+
+    QDir dir(path);
+    dir.setFilter(QDir::Files | QDir::NoDotAndDotDot | QDir::Readable);
+    dir.setNameFilters(QStringList() << "*.png");
+
+    int num = 0;
+    for (const QString& fn : dir.entryList())
+    {
+        // the inverse of ShadertoyApi::shaderIdToFilename()
+        const QString id = fn.left(fn.size() - 4).remove('_');
+        if (contains(id))
+            continue;
+
+        QImageReader reader(dir.filePath(fn));
+        reader.setScaledSize(p_tileSize_);
+        const QImage img = reader.read();
+        if (img.isNull())
+        {
+            ST_WARN("Could not import '" << dir.filePath(fn) << "', "
+                    << reader.errorString());
+            continue;
+        }
+        if (!writeRecord(id, img))
+            break;
+        ++num;
+    }
+
+    if (!mapRecords())
+        return -1;
+
+    ST_INFO("ThumbnailStore: imported " << num << " images from '"
+            << path << "' into '" << p_filename_ << "'");
+    return num;
+}
@@ -0,0 +1,139 @@
+/***************************************************************************
+
+Copyright (C) 2016  stefan.berke @ modular-audio-graphics.com
+
+This source is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either
+version 3.0 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this software; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+****************************************************************************/
+
+#ifndef THUMBNAILSTORE_H
+#define THUMBNAILSTORE_H
+
+#include <QString>
+#include <QSize>
+#include <QHash>
+#include <QImage>
+#include <QVector>
+
+class QFile;
+
+/** Memory-mapped file of fixed-size, pre-scaled thumbnail tiles.
+
+    Layout (host byte order, all offsets from file start):
+    @code
+    header      char magic[8] "STTHUMB", u32 byteOrderMark, u32 version,
+                u32 tileWidth, u32 tileHeight, u32 imageFormat,
+                u32 bytesPerLine
+    records     { char id[16], u32 marker "TILE", u32 reserved,
+                  u64 reserved, pixels[tileHeight * bytesPerLine] }
+    @endcode
+
+    Records are only appended, a later record for the same id replaces
+    the earlier one. All records have the same size, so the id index is
+    built by stepping over the record headers when opening. A record
+    that was not completely written is ignored and overwritten by the
+    next append().
+
+    Tiles are stored as QImage::Format_RGB888, since snapshots are
+    opaque. image() returns them without decoding or copying.
+
+    Appended records are mapped in chunks: once the unmapped end of
+    the file is larger than mapChunkSize(), it is mapped as one more
+    region. The chunk grows with the mapped size, so the number of
+    regions stays logarithmic in the file size. Tiles in the unmapped
+    end are read from the file by image().
+
+    Not threadsafe, use from a single thread.
+*/
+class ThumbnailStore
+{
+public:
+    ThumbnailStore();
+    ~ThumbnailStore();
+
+    // ---- reading ----
+
+    /** Opens and maps the file, or creates an empty store with
+        @p tileSize. An existing file keeps its tile size.
+        Returns false on any error or if the format is not supported. */
+    bool open(const QString& filename, const QSize& tileSize = QSize(48, 48));
+    /** Unmaps the file, all images from image() become invalid */
+    void close();
+
+    bool isOpen() const { return p_file_ != nullptr; }
+    const QString& filename() const { return p_filename_; }
+    const QSize& tileSize() const { return p_tileSize_; }
+
+    /** Number of distinct ids */
+    int count() const { return p_tiles_.size(); }
+    bool contains(const QString& id) const { return p_tiles_.contains(id); }
+    /** Size of the file in bytes */
+    qint64 fileSize() const { return p_size_; }
+
+    /** The tile of @p id pointing into the mapped file, or a null image.
+        The image stays valid until close().
+        Recently appended tiles are read and copied. */
+    QImage image(const QString& id) const;
+
+    // ---- writing ----
+
+    /** Scales @p img to the tile size and appends it to the file,
+        replacing a previous tile of @p id. */
+    bool append(const QString& id, const QImage& img);
+
+    /** Appends all png files of a snapshot directory that are not
+        yet in the store, using ShadertoyApi's file naming.
+        Returns the number of imported images, or -1 on error. */
+    int importDirectory(const QString& path);
+
+    static const int version;
+
+private:
+    ThumbnailStore(const ThumbnailStore&) = delete;
+    void operator=(const ThumbnailStore&) = delete;
+
+    bool create(const QString& filename, const QSize& tileSize);
+    /** Writes a record at the end without mapping it */
+    bool writeRecord(const QString& id, const QImage& img);
+    /** Maps the records from the end of the mapped part
+        to the end of the file */
+    bool mapRecords();
+    /** Minimum size of the unmapped end before it is mapped */
+    qint64 mapChunkSize() const;
+    void addRecord(const uchar* record, qint64 offset);
+    qint64 recordSize() const;
+
+    struct Tile
+    {
+        /** Start of the pixels, NULL if not mapped yet */
+        const uchar* pixels;
+        /** File offset of the pixels */
+        qint64 offset;
+    };
+
+    QString p_filename_;
+    QFile* p_file_;
+    QSize p_tileSize_;
+    int p_bytesPerLine_;
+    qint64 p_size_;
+    /** End of the mapped part of the file */
+    qint64 p_mapped_;
+    /** Mapped regions, the first covers the file at open(),
+        one more for each chunk and importDirectory() */
+    QVector<uchar*> p_maps_;
+    QHash<QString, Tile> p_tiles_;
+};
+
+#endif // THUMBNAILSTORE_H
@@ -6,7 +6,8 @@ HEADERS += \
     gui/RenderpassView.h \
     gui/MainWindow.h \
     $$PWD/gui/ShaderInfoView.h \
-    $$PWD/gui/AudioPlayer.h
+    $$PWD/gui/AudioPlayer.h \
+    $$PWD/gui/TableBenchmark.h
 
 SOURCES += \
     gui/main.cpp \
@@ -17,4 +18,5 @@ SOURCES += \
     gui/RenderpassView.cpp \
     gui/MainWindow.cpp \
     $$PWD/gui/ShaderInfoView.cpp \
-    $$PWD/gui/AudioPlayer.cpp
+    $$PWD/gui/AudioPlayer.cpp \
+    $$PWD/gui/TableBenchmark.cpp
@@ -30,6 +30,13 @@
 #include "core/ShaderListModel.h"
 #include "core/ShaderSortModel.h"
 #include "core/ShadertoyOffscreenRenderer.h"
+#include "core/Benchmark.h"
+#include "core/DownloadScheduler.h"
+#include "core/SnapshotJob.h"
+#include "core/RenderProcessPool.h"
+#include "core/ShaderValidator.h"
+#include "core/ProgramBinaryCache.h"
+#include "core/ShaderRenderGraph.h"
 #include "RenderpassView.h"
 #include "ShadertoyRenderWidget.h"
 #include "ShaderInfoView.h"
@@ -37,12 +44,16 @@
 #include "Settings.h"
 #include "LogView.h"
 #include "AudioPlayer.h"
+#include "TableBenchmark.h"
 
 struct MainWindow::Private
 {
     Private(MainWindow* p)
         : win           (p)
         , audioPlayer   (new AudioPlayer(p))
+        , snapshotJob   (nullptr)
+        , renderPool    (nullptr)
+        , validator     (nullptr)
     { }
 
     void createWidgets();
@@ -55,12 +66,22 @@ struct MainWindow::Private
     void setShader(const ShadertoyShader&);
 
     void onShaderEdited();
+    /** Creates the job on first use */
+    SnapshotJob* snapshots();
+    /** Creates the pool on first use */
+    RenderProcessPool* renderProcesses();
+    /** Creates the validator on first use */
+    ShaderValidator* validation();
+    void showSnapshotProgress(double percent);
 
     MainWindow* win;
 
     ShaderListModel* shaderList;
     ShaderSortModel* shaderSortModel;
     AudioPlayer* audioPlayer;
+    SnapshotJob* snapshotJob;
+    RenderProcessPool* renderPool;
+    ShaderValidator* validator;
 
     int curDownShader;
 
@@ -134,6 +155,15 @@ void MainWindow::Private::createWidgets()
     lv = new QVBoxLayout(w);
 
         tableFilterEdit = new QLineEdit(win);
+        tableFilterEdit->setPlaceholderText(tr("search"));
+        tableFilterEdit->setToolTip(
+            tr("Text to search in the shaders and their sources, "
+               "alternatives separated by ';'\n"
+               "Fields: user: name: tag: id: desc:\n"
+               "Numbers: likes views passes chars flags "
+               "with > >= < <= = or a..b\n"
+               "date:2016..  date:2016-03  uses:buffers  has:sound\n"
+               "A leading '-' negates a clause"));
         lv->addWidget(tableFilterEdit);
         connect(tableFilterEdit, &QLineEdit::textChanged, [=]()
         {
@@ -146,8 +176,32 @@ void MainWindow::Private::createWidgets()
         shaderTable->setSortingEnabled(true);
         shaderSortModel = new ShaderSortModel(shaderTable);
         shaderSortModel->setFilterRole(Qt::DisplayRole);
+        connect(shaderSortModel, &ShaderSortModel::filterStarted, [=]()
+        {
+            win->statusBar()->showMessage(tr("searching..."));
+        });
+        connect(shaderSortModel, &ShaderSortModel::filterFinished,
+                [=](int num, double ms)
+        {
+            win->statusBar()->showMessage(
+                    tr("%1 shaders found in %2 ms")
+                        .arg(num).arg(ms, 0, 'f', 1));
+        });
 
         shaderList = new ShaderListModel(shaderTable);
+        shaderList->api()->setShaderCacheBudget(qint64(
+                Settings::instance().value(
+                    Settings::keyShaderCacheBudget, 64).toInt()) << 20);
+        shaderList->api()->setLazyLoading(
+                Settings::instance().value(
+                    Settings::keyLazyLoading, false).toBool());
+        if (Settings::instance().contains(Settings::keyServerUrl))
+            shaderList->api()->setServerUrl(
+                    Settings::instance().value(
+                        Settings::keyServerUrl).toString());
+        shaderList->api()->setMaxParallelDownloads(
+                Settings::instance().value(
+                    Settings::keyMaxDownloads, 6).toInt());
         shaderSortModel->setSourceModel(shaderList);
         shaderTable->setModel(shaderSortModel);
 
@@ -184,14 +238,129 @@ void MainWindow::Private::createWidgets()
     progressBar = new QProgressBar(win);
     progressBar->setVisible(false);
     win->statusBar()->addPermanentWidget(progressBar);
-    connect(shaderList->api(), &ShadertoyApi::downloadProgress, [=](int p)
+    connect(shaderList->api(), &ShadertoyApi::downloadProgress, win, [=](int p)
+    {
+        progressBar->setValue(p);
+    });
+    connect(shaderList->api(), &ShadertoyApi::mergeFinished, win, [=]()
+    {
+        progressBar->setVisible(false);
+        if (auto dl = shaderList->api()->downloads())
+        {
+            const auto& stats = dl->stats();
+            win->statusBar()->showMessage(
+                tr("downloaded %1 files in %2 sec (%3 KiB/sec, "
+                   "%4 retries, %5 failed)")
+                    .arg(stats.numFinished)
+                    .arg(stats.seconds, 0, 'f', 2)
+                    .arg(int(stats.bytesPerSecond() / 1024.))
+                    .arg(stats.numRetries)
+                    .arg(stats.numFailed));
+        }
+    });
+    connect(shaderList->api(), &ShadertoyApi::loadProgress, win, [=](int p)
     {
+        progressBar->setVisible(true);
         progressBar->setValue(p);
     });
-    connect(shaderList->api(), &ShadertoyApi::mergeFinished, [=]()
+    connect(shaderList->api(), &ShadertoyApi::loadFinished, win, [=]()
+    {
+        progressBar->setVisible(false);
+        const auto& stats = shaderList->api()->loadStats();
+        win->statusBar()->showMessage(
+                tr("loaded %1 shaders in %2 sec (%3 files/sec, %4 failed)")
+                    .arg(stats.numLoaded)
+                    .arg(stats.seconds, 0, 'f', 2)
+                    .arg(int(stats.filesPerSecond()))
+                    .arg(stats.numFailed));
+    });
+}
+
+SnapshotJob* MainWindow::Private::snapshots()
+{
+    if (snapshotJob)
+        return snapshotJob;
+
+    snapshotJob = new SnapshotJob(win);
+    connect(snapshotJob, &SnapshotJob::progressChanged, win, [=](double p)
+    {
+        showSnapshotProgress(p);
+    });
+    connect(snapshotJob, &SnapshotJob::finished, win, [=]()
+    {
+        progressBar->setVisible(false);
+        const auto& stats = snapshotJob->stats();
+        win->statusBar()->showMessage(
+                tr("rendered %1 snapshots in %2 sec (%3 per sec, "
+                   "%4 skipped, %5 failed)")
+                    .arg(stats.numRendered)
+                    .arg(stats.seconds, 0, 'f', 2)
+                    .arg(stats.imagesPerSecond(), 0, 'f', 1)
+                    .arg(stats.numSkipped)
+                    .arg(stats.numFailed));
+    });
+    return snapshotJob;
+}
+
+RenderProcessPool* MainWindow::Private::renderProcesses()
+{
+    if (renderPool)
+        return renderPool;
+
+    renderPool = new RenderProcessPool(win);
+    connect(renderPool, &RenderProcessPool::progressChanged, win,
+            [=](double p)
+    {
+        showSnapshotProgress(p);
+    });
+    connect(renderPool, &RenderProcessPool::finished, win, [=]()
+    {
+        progressBar->setVisible(false);
+        const auto& stats = renderPool->stats();
+        win->statusBar()->showMessage(
+                tr("rendered %1 snapshots in %2 sec (%3 per sec, "
+                   "%4 skipped, %5 failed, %6 crashes, %7 timeouts)")
+                    .arg(stats.numRendered)
+                    .arg(stats.seconds, 0, 'f', 2)
+                    .arg(stats.imagesPerSecond(), 0, 'f', 1)
+                    .arg(stats.numSkipped)
+                    .arg(stats.numFailed)
+                    .arg(stats.numCrashes)
+                    .arg(stats.numTimeouts));
+    });
+    return renderPool;
+}
+
+ShaderValidator* MainWindow::Private::validation()
+{
+    if (validator)
+        return validator;
+
+    validator = new ShaderValidator(win);
+    connect(validator, &ShaderValidator::progressChanged, win, [=](double p)
+    {
+        showSnapshotProgress(p);
+    });
+    connect(validator, &ShaderValidator::finished, win, [=]()
     {
         progressBar->setVisible(false);
+        const auto& stats = validator->stats();
+        win->statusBar()->showMessage(
+                tr("validated %1 shaders in %2 sec (%3 ok, %4 failed, "
+                   "%5 unchanged)")
+                    .arg(stats.numRequests)
+                    .arg(stats.seconds, 0, 'f', 2)
+                    .arg(stats.numOk)
+                    .arg(stats.numFailed)
+                    .arg(stats.numSkipped));
     });
+    return validator;
+}
+
+void MainWindow::Private::showSnapshotProgress(double percent)
+{
+    progressBar->setVisible(true);
+    progressBar->setValue(int(percent));
 }
 
 void MainWindow::Private::createMenu()
@@ -204,6 +373,22 @@ void MainWindow::Private::createMenu()
     connect(a, &QAction::triggered, [=]()
         { shaderList->api()->loadAllShaders(); });
 
+    a = menu->addAction(tr("Pack shaders into catalog file"));
+    connect(a, &QAction::triggered, [=]()
+    {
+        if (!shaderList->api()->packShaderCache())
+            QMessageBox::critical(win, tr("catalog"),
+                                  tr("failed to write the catalog file"));
+    });
+
+    a = menu->addAction(tr("Unpack catalog file to json files"));
+    connect(a, &QAction::triggered, [=]()
+    {
+        if (!shaderList->api()->unpackShaderCache())
+            QMessageBox::critical(win, tr("catalog"),
+                                  tr("failed to unpack the catalog file"));
+    });
+
     menu->addSeparator();
 
     a = menu->addAction(tr("Merge with shadertoy.com"));
@@ -217,6 +402,32 @@ void MainWindow::Private::createMenu()
     a = menu->addAction(tr("Stop web request"));
     connect(a, &QAction::triggered, [=](){ shaderList->api()->stopRequests(); });
 
+    menu->addSeparator();
+
+    a = menu->addAction(tr("Validate all shaders"));
+    a->setStatusTip(tr("Compiles all shaders in the background, "
+                       "unchanged shaders are skipped"));
+    connect(a, &QAction::triggered, [=]()
+    {
+        progressBar->setValue(0);
+        progressBar->setVisible(true);
+        validation()->validate(shaderList->shaderIds());
+    });
+
+    a = menu->addAction(tr("Revalidate all shaders"));
+    connect(a, &QAction::triggered, [=]()
+    {
+        progressBar->setValue(0);
+        progressBar->setVisible(true);
+        validation()->setForce(true);
+        validation()->validate(shaderList->shaderIds());
+        validation()->setForce(false);
+    });
+
+    a = menu->addAction(tr("Stop validation"));
+    connect(a, &QAction::triggered, [=]()
+        { if (validator) validator->cancel(); });
+
 
     // ########## Options ############
     menu = win->menuBar()->addMenu(tr("Options"));
@@ -228,6 +439,16 @@ void MainWindow::Private::createMenu()
         shaderList->setEnableThumbnails(e);
     });
 
+    a = menu->addAction(tr("Load shader sources on demand"));
+    a->setCheckable(true);
+    a->setChecked(Settings::instance().value(
+                      Settings::keyLazyLoading, false).toBool());
+    connect(a, &QAction::triggered, [=](bool e)
+    {
+        shaderList->api()->setLazyLoading(e);
+        Settings::instance().setValue(Settings::keyLazyLoading, e);
+    });
+
 
     // ########## VIEW ############
     viewMenu = win->menuBar()->addMenu(tr("View"));
@@ -264,16 +485,125 @@ void MainWindow::Private::createMenu()
                                   tr("failed to render audio"));
     });
 
+    a = menu->addAction(tr("show render graph"));
+    connect(a, &QAction::triggered, [=]()
+    {
+        const ShaderRenderGraph graph(passView->shader());
+        QMessageBox::information(win, tr("render graph"), graph.toString());
+    });
+
     a = menu->addAction(tr("create snapshots"));
     connect(a, &QAction::triggered, [=]()
     {
-        auto ids = shaderList->shaderIds();
-        for (auto& id : ids)
-        {
-            qDebug() << "rendering" << id;
-            QImage img = shaderList->api()->getSnapshot(id, true);
-            qDebug() << (img.isNull() ? "FAILED" : "ok");
-        }
+        renderProcesses()->enqueue(shaderList->shaderIds());
+    });
+
+    a = menu->addAction(tr("create snapshots in threads"));
+    connect(a, &QAction::triggered, [=]()
+    {
+        snapshots()->enqueue(shaderList->shaderIds());
+    });
+
+    auto pauseAction = a = menu->addAction(tr("pause snapshots"));
+    a->setCheckable(true);
+    connect(a, &QAction::triggered, [=](bool e)
+    {
+        if (renderPool)
+            e ? renderPool->pause() : renderPool->resume();
+        if (snapshotJob)
+            e ? snapshotJob->pause() : snapshotJob->resume();
+    });
+
+    a = menu->addAction(tr("cancel snapshots"));
+    connect(a, &QAction::triggered, [=]()
+    {
+        pauseAction->setChecked(false);
+        if (renderPool)
+            renderPool->cancel();
+        if (snapshotJob)
+            snapshotJob->cancel();
+    });
+
+    a = menu->addAction(tr("clear render blocklist"));
+    connect(a, &QAction::triggered, [=]()
+    {
+        const int num = shaderList->api()->renderBlocklist().size();
+        shaderList->api()->clearRenderBlocklist();
+        win->statusBar()->showMessage(
+                tr("%1 shaders removed from the blocklist").arg(num));
+    });
+
+    a = menu->addAction(tr("import snapshots into thumbnail store"));
+    connect(a, &QAction::triggered, [=]()
+    {
+        const int num = shaderList->api()->importSnapshots();
+        QMessageBox::information(win, tr("thumbnails"),
+                num < 0 ? tr("import failed")
+                        : tr("%1 snapshots imported").arg(num));
+    });
+
+    a = menu->addAction(tr("clear program binary cache"));
+    connect(a, &QAction::triggered, [=]()
+    {
+        auto cache = shaderList->api()->programCache();
+        const auto stats = cache->stats();
+        cache->clear();
+        win->statusBar()->showMessage(
+                tr("%1 program binaries removed (%2 hits, %3 misses, "
+                   "%4 rejected)")
+                    .arg(stats.numFiles)
+                    .arg(stats.numHits)
+                    .arg(stats.numMisses)
+                    .arg(stats.numRejected));
+    });
+
+    a = menu->addAction(tr("benchmark catalog startup"));
+    connect(a, &QAction::triggered, [=]()
+    {
+        auto api = shaderList->api();
+        QMessageBox::information(win, tr("benchmark"),
+                Benchmark::catalogStartup(api->shaderCachePath(),
+                                          api->catalogFilename()));
+    });
+
+    a = menu->addAction(tr("benchmark descriptor scan"));
+    connect(a, &QAction::triggered, [=]()
+    {
+        auto api = shaderList->api();
+        QMessageBox::information(win, tr("benchmark"),
+                Benchmark::descriptorScan(api->shaderCachePath(),
+                                          api->catalogFilename()));
+    });
+
+    a = menu->addAction(tr("benchmark current query"));
+    connect(a, &QAction::triggered, [=]()
+    {
+        auto api = shaderList->api();
+        QMessageBox::information(win, tr("benchmark"),
+                Benchmark::queryEvaluation(api->shaderCachePath(),
+                                           api->catalogFilename(),
+                                           tableFilterEdit->text()));
+    });
+
+    a = menu->addAction(tr("check download scheduler"));
+    connect(a, &QAction::triggered, [=]()
+    {
+        QMessageBox::information(win, tr("download scheduler"),
+                Benchmark::downloadScheduler());
+    });
+
+    a = menu->addAction(tr("benchmark table scrolling"));
+    connect(a, &QAction::triggered, [=]()
+    {
+        QMessageBox::information(win, tr("benchmark"),
+                TableBenchmark::scrolling(shaderSortModel));
+    });
+
+    a = menu->addAction(tr("memory report"));
+    connect(a, &QAction::triggered, [=]()
+    {
+        QMessageBox::information(win, tr("memory"),
+                                 shaderList->api()->memoryReport());
     });
 
     a = menu->addAction(tr("dump window state"));
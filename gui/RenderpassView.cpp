@@ -30,7 +30,7 @@ struct RenderPassView::Private
 {
     Private(RenderPassView*p)
         : p             (p)
-        , api           (new ShadertoyApi(p))
+        , api           (ShadertoyApi::acquire())
         , ignoreChange  (false)
     {
         connect(api, SIGNAL(textureReceived(QString,QImage)),
@@ -76,6 +76,7 @@ RenderPassView::RenderPassView(QWidget *parent)
 
 RenderPassView::~RenderPassView()
 {
+    p_->api->release();
     delete p_;
 }
 
@@ -300,13 +301,15 @@ QPixmap RenderPassView::Private::getPixmap(const QString& src)
 
 void RenderPassView::p_onTexture_(const QString &src, const QImage &img)
 {
-    p_->pixmaps.insert(src, QPixmap::fromImage(img.scaled(64,64)));
-
+    // the api is shared, so the texture might be for someone else
     for (size_t i=0; i<4; ++i)
     {
         Private::InputWidget& iw = p_->inputWidgets[i];
-        if (iw.src == src)
-            iw.imgLabel->setPixmap(p_->pixmaps[src]);
+        if (iw.src != src)
+            continue;
+        if (!p_->pixmaps.contains(src))
+            p_->pixmaps.insert(src, QPixmap::fromImage(img.scaled(64,64)));
+        iw.imgLabel->setPixmap(p_->pixmaps[src]);
     }
 }
 
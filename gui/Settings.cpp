@@ -20,6 +20,10 @@
 namespace { static Settings* instance_ = nullptr; }
 
 const QString Settings::keyAppkey = "AppKey";
+const QString Settings::keyLazyLoading = "LazyLoading";
+const QString Settings::keyShaderCacheBudget = "ShaderCacheBudgetMB";
+const QString Settings::keyServerUrl = "ServerUrl";
+const QString Settings::keyMaxDownloads = "MaxParallelDownloads";
 
 Settings::Settings()
 {
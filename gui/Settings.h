@@ -25,6 +25,14 @@ class Settings
 public:
 
     static const QString keyAppkey;
+    /** bool, ShadertoyApi::setLazyLoading() */
+    static const QString keyLazyLoading;
+    /** int, ShadertoyApi::setShaderCacheBudget() in megabytes */
+    static const QString keyShaderCacheBudget;
+    /** string, ShadertoyApi::setServerUrl() */
+    static const QString keyServerUrl;
+    /** int, ShadertoyApi::setMaxParallelDownloads() */
+    static const QString keyMaxDownloads;
 
     /** Global instance */
     static Settings& instance();
@@ -313,6 +313,15 @@ QWidget* ShadertoyRenderWidget::createPlaybar(QWidget*parent)
                 [=]()
         {
             label->setText(QString("%1 fps").arg(messuredFps()));
+            if (p_->render)
+            {
+                const auto& s = p_->render->frameStats();
+                label->setToolTip(tr("%1 draws, %2 gl calls\n"
+                                     "%3 uniforms uploaded, %4 unchanged")
+                                  .arg(s.numDraws).arg(s.numGlCalls)
+                                  .arg(s.numUniformUploads)
+                                  .arg(s.numUniformsSkipped));
+            }
         });
 
     return container;
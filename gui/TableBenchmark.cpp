@@ -0,0 +1,168 @@
+/***************************************************************************
+
+Copyright (C) 2016  stefan.berke @ modular-audio-graphics.com
+
+This source is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either
+version 3.0 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this software; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+****************************************************************************/
+
+#include <algorithm>
+
+#include <QAbstractTableModel>
+#include <QTableView>
+#include <QScrollBar>
+#include <QImage>
+#include <QElapsedTimer>
+#include <QTextStream>
+
+#include "TableBenchmark.h"
+#ifdef ST_ALLOC_COUNTER
+#   include "core/AllocationCounter.h"
+#endif
+#include "core/log.h"
+
+namespace {
+
+    /** Allocations so far, zero without CONFIG+=alloc_counter */
+    quint64 allocationCount()
+    {
+#ifdef ST_ALLOC_COUNTER
+        return AllocationCounter::count();
+#else
+        return 0;
+#endif
+    }
+
+    quint64 allocationBytes()
+    {
+#ifdef ST_ALLOC_COUNTER
+        return AllocationCounter::bytes();
+#else
+        return 0;
+#endif
+    }
+
+    /** Repeats the rows of a model and counts data() calls */
+    class RepeatModel : public QAbstractTableModel
+    {
+    public:
+        RepeatModel(QAbstractItemModel* src, int numRows)
+            : src_      (src)
+            , numRows_  (src->rowCount() ? numRows : 0)
+            , numCalls_ (0)
+        { }
+
+        quint64 numCalls() const { return numCalls_; }
+
+        int rowCount(const QModelIndex& parent) const override
+            { return parent.isValid() ? 0 : numRows_; }
+        int columnCount(const QModelIndex& parent) const override
+            { return parent.isValid() ? 0 : src_->columnCount(); }
+
+        QVariant data(const QModelIndex& index, int role) const override
+        {
+            ++numCalls_;
+            return src_->data(src_->index(index.row() % src_->rowCount(),
+                                          index.column()), role);
+        }
+
+        QVariant headerData(int section, Qt::Orientation o,
+                            int role) const override
+        {
+            if (o == Qt::Horizontal)
+                return src_->headerData(section, o, role);
+            return QAbstractTableModel::headerData(section, o, role);
+        }
+
+    private:
+        QAbstractItemModel* src_;
+        int numRows_;
+        mutable quint64 numCalls_;
+    };
+
+} // namespace
+
+QString TableBenchmark::scrolling(
+        QAbstractItemModel* model, int numRows, int numFrames)
+{
+    QString report;
+    QTextStream s(&report);
+
+    if (!model || !model->rowCount())
+    {
+        s << "no rows in model\n";
+        return report;
+    }
+
+    RepeatModel repeat(model, numRows);
+    QTableView view;
+    view.setAttribute(Qt::WA_DontShowOnScreen);
+    view.resize(1024, 768);
+    view.setModel(&repeat);
+    view.show();
+
+    QImage img(view.viewport()->size(), QImage::Format_ARGB32_Premultiplied);
+    QScrollBar* bar = view.verticalScrollBar();
+    const int pageStep = std::max(1, bar->pageStep());
+
+    auto frame = [&](int k)
+    {
+        // a page per frame, wrapping at the end
+        bar->setValue(int(qint64(k) * pageStep
+                          % std::max(1, bar->maximum() + 1)));
+        view.viewport()->render(&img);
+    };
+
+    // warm up caches and layouts
+    for (int k=0; k<5; ++k)
+        frame(k);
+
+    quint64 minAllocs = ~quint64(0), maxAllocs = 0, sumAllocs = 0;
+    const quint64 bytes = allocationBytes();
+    const quint64 calls = repeat.numCalls();
+    QElapsedTimer timer;
+    timer.start();
+    for (int k=0; k<numFrames; ++k)
+    {
+        const quint64 a = allocationCount();
+        frame(k);
+        const quint64 n = allocationCount() - a;
+        minAllocs = std::min(minAllocs, n);
+        maxAllocs = std::max(maxAllocs, n);
+        sumAllocs += n;
+    }
+    const double ms = double(timer.nsecsElapsed()) / 1.e6;
+    const int frames = std::max(1, numFrames);
+    const quint64 sumBytes = allocationBytes() - bytes;
+
+    s << repeat.rowCount(QModelIndex()) << " rows (" << model->rowCount()
+      << " distinct), " << numFrames << " frames of "
+      << img.width() << "x" << img.height() << "\n"
+      << "time per frame:        " << ms / frames << " ms\n"
+      << "data() per frame:      "
+      << double(repeat.numCalls() - calls) / frames << "\n";
+#ifdef ST_ALLOC_COUNTER
+    s << AllocationCounter::countedFunction() << " calls per frame: "
+      << double(sumAllocs) / frames
+      << " (min " << minAllocs << ", max " << maxAllocs << "), "
+      << double(sumBytes) / frames << " bytes\n";
+#else
+    Q_UNUSED(sumBytes);
+    s << "allocations are only counted with qmake CONFIG+=alloc_counter\n";
+#endif
+
+    ST_INFO("TableBenchmark::scrolling()\n" << report);
+    return report;
+}
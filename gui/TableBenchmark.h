@@ -0,0 +1,42 @@
+/***************************************************************************
+
+Copyright (C) 2016  stefan.berke @ modular-audio-graphics.com
+
+This source is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either
+version 3.0 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this software; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+****************************************************************************/
+
+#ifndef TABLEBENCHMARK_H
+#define TABLEBENCHMARK_H
+
+#include <QString>
+
+class QAbstractItemModel;
+
+/** Namespace for static functions measuring view performance.
+    Each function returns a human-readable report. */
+struct TableBenchmark
+{
+    /** Scrolls an offscreen QTableView over @p model and repaints it
+        for each of @p numFrames frames. The rows of the model are
+        repeated to get @p numRows rows.
+        Reports the time, data() calls and heap allocations per
+        frame. Allocations are counted with qmake CONFIG+=alloc_counter,
+        see AllocationCounter. */
+    static QString scrolling(QAbstractItemModel* model,
+                             int numRows = 50000, int numFrames = 200);
+};
+
+#endif // TABLEBENCHMARK_H
@@ -16,6 +16,7 @@
 #include <QAbstractItemModel>
 #include <QVector>
 #include <QDateTime>
+#include <QTimer>
 
 #include "TablePlotView.h"
 #include "core/log.h"
@@ -25,12 +26,20 @@ struct TablePlotView::Private
     Private(TablePlotView* p)
         : p         (p)
         , model     (nullptr)
-    { }
+        , updateTimer(new QTimer(p))
+    {
+        // at most one recompute per frame
+        updateTimer->setSingleShot(true);
+        updateTimer->setInterval(16);
+        connect(updateTimer, &QTimer::timeout, [=](){ updateFromModel(); });
+    }
 
     void createWidgets();
     void connectModel();
     void updateCombos();
     void updateFromModel();
+    void scheduleUpdate()
+        { if (!updateTimer->isActive()) updateTimer->start(); }
     void freeValues();
     void getData(int column1, int column2);
     double toDouble(const QVariant&) const;
@@ -51,6 +60,7 @@ struct TablePlotView::Private
 
     QComboBox *cbX, *cbY;
     QWidget *plotWidget;
+    QTimer* updateTimer;
 };
 
 TablePlotView::TablePlotView(QWidget *parent)
@@ -105,25 +115,25 @@ void TablePlotView::Private::connectModel()
     cons.clear();
 
     cons << connect(model, &QAbstractItemModel::dataChanged,
-                    [=](){ updateFromModel(); });
+                    [=](){ scheduleUpdate(); });
     cons << connect(model, &QAbstractItemModel::modelReset,
-                    [=](){ updateFromModel(); });
+                    [=](){ scheduleUpdate(); });
     cons << connect(model, &QAbstractItemModel::columnsInserted,
-                    [=](){ updateFromModel(); });
+                    [=](){ scheduleUpdate(); });
     cons << connect(model, &QAbstractItemModel::columnsMoved,
-                    [=](){ updateFromModel(); });
+                    [=](){ scheduleUpdate(); });
     cons << connect(model, &QAbstractItemModel::columnsRemoved,
-                    [=](){ updateFromModel(); });
+                    [=](){ scheduleUpdate(); });
     cons << connect(model, &QAbstractItemModel::rowsInserted,
-                    [=](){ updateFromModel(); });
+                    [=](){ scheduleUpdate(); });
     cons << connect(model, &QAbstractItemModel::rowsMoved,
-                    [=](){ updateFromModel(); });
+                    [=](){ scheduleUpdate(); });
     cons << connect(model, &QAbstractItemModel::rowsRemoved,
-                    [=](){ updateFromModel(); });
+                    [=](){ scheduleUpdate(); });
     cons << connect(model, &QAbstractItemModel::headerDataChanged,
-                    [=](){ updateFromModel(); });
+                    [=](){ scheduleUpdate(); });
     cons << connect(model, &QAbstractItemModel::layoutChanged,
-                    [=](){ updateFromModel(); });
+                    [=](){ scheduleUpdate(); });
 }
 
 void TablePlotView::Private::updateCombos()
@@ -9,11 +9,17 @@
 */
 
 #include "MainWindow.h"
+#include "core/RenderProcessPool.h"
 #include <QApplication>
 
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
+
+    // child process of a RenderProcessPool
+    if (a.arguments().contains(RenderProcessPool::workerArgument()))
+        return RenderProcessPool::runWorker(a.arguments());
+
     MainWindow w;
     w.show();
 
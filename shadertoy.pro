@@ -4,7 +4,7 @@
 #
 #-------------------------------------------------
 
-QT       += core gui network multimedia
+QT       += core gui network multimedia concurrent
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
@@ -20,6 +20,14 @@ CONFIG(release, debug|release) {
 include(core.pri)
 include(gui.pri)
 
+# Counts heap allocations for the table benchmark by replacing malloc(),
+# only on request: qmake CONFIG+=alloc_counter
+alloc_counter {
+    DEFINES += ST_ALLOC_COUNTER
+    HEADERS += core/AllocationCounter.h
+    SOURCES += core/AllocationCounter.cpp
+}
+
 DISTFILES += \
     .gitignore \
     README.md \